@@ -58,6 +58,26 @@ public:
 	/// \return true, if the entry was found, false else
 	bool get( const char* key, NodeData& val) const;
 
+	/// \brief Get the address of the root node for walking the trie character by character
+	/// \return the address of the root node or 0 if the trie is empty
+	NodeAddress rootAddress() const
+	{
+		return m_rootaddr;
+	}
+	/// \brief Get the successor of a node reached by walking the trie character by character
+	/// \param[in] addr address of the node
+	/// \param[in] chr character of the successor
+	/// \return the address of the successor or 0 if there is none
+	NodeAddress successor( const NodeAddress& addr, unsigned char chr) const
+	{
+		return successorNodeAddress( addr, chr);
+	}
+	/// \brief Get the value of the key ending at a node reached by walking the trie character by character
+	/// \param[in] addr address of the node
+	/// \param[out] val the value assigned to the key
+	/// \return true, if a key ends at the node, false else
+	bool getNodeData( const NodeAddress& addr, NodeData& val) const;
+
 	/// \class const_iterator
 	/// \brief Read only iterator on the trie
 	class const_iterator
@@ -170,6 +170,11 @@ bool CompactNodeTrie::get( const char* key, NodeData& val) const
 		addr = successorNodeAddress( addr, *ki);
 		if (!addr) return false;
 	}
+	return getNodeData( addr, val);
+}
+
+bool CompactNodeTrie::getNodeData( const NodeAddress& addr, NodeData& val) const
+{
 	if (nodeClassId(addr) == NodeClass::NodeData)
 	{
 		val = m_datablock[ nodeIndex( addr)];
@@ -177,14 +182,14 @@ bool CompactNodeTrie::get( const char* key, NodeData& val) const
 	}
 	else
 	{
-		addr = successorNodeAddress( addr, 0xFF);
-		if (!addr) return false;
+		NodeAddress dataddr = successorNodeAddress( addr, 0xFF);
+		if (!dataddr) return false;
 
-		if (nodeClassId(addr) != NodeClass::NodeData)
+		if (nodeClassId(dataddr) != NodeClass::NodeData)
 		{
 			throw std::runtime_error( "currupt data (non UTF-8 string inserted)");
 		}
-		val = m_datablock[ nodeIndex( addr)];
+		val = m_datablock[ nodeIndex( dataddr)];
 		return true;
 	}
 }
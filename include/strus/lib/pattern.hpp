@@ -10,6 +10,8 @@
 #ifndef _STRUS_PATTERN_LIB_HPP_INCLUDED
 #define _STRUS_PATTERN_LIB_HPP_INCLUDED
 #include <cstdio>
+#include <cstddef>
+#include <string>
 
 /// \brief strus toplevel namespace
 namespace strus {
@@ -17,8 +19,20 @@ namespace strus {
 /// \brief Forward declaration
 class PatternLexerInterface;
 /// \brief Forward declaration
+class PatternLexerInstanceInterface;
+/// \brief Forward declaration
+class PatternLexerStreamContextInterface;
+/// \brief Forward declaration
+class PatternLexerSegmentContextInterface;
+/// \brief Forward declaration
 class PatternMatcherInterface;
 /// \brief Forward declaration
+class PatternMatcherInstanceInterface;
+/// \brief Forward declaration
+class PatternLexerMatcherContextInterface;
+/// \brief Forward declaration
+class PatternMatcherDocumentPoolInterface;
+/// \brief Forward declaration
 class TokenMarkupInstanceInterface;
 /// \brief Forward declaration
 class ErrorBufferInterface;
@@ -27,10 +41,86 @@ class ErrorBufferInterface;
 PatternLexerInterface* createPatternLexer_std(
 		ErrorBufferInterface* errorhnd);
 
+/// \brief Create a context for regular expression matching on a text passed chunk by chunk (hyperscan streaming mode)
+/// \param[in] lexer compiled lexer instance created by the interface returned by createPatternLexer_std with the option "STREAM" defined
+/// \param[in] errorhnd error buffer interface for reporting errors
+PatternLexerStreamContextInterface* createPatternLexerStreamContext_std(
+		const PatternLexerInstanceInterface* lexer,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Create a context for regular expression matching on all segments of a document with one call (hyperscan vectored mode)
+/// \param[in] lexer compiled lexer instance created by the interface returned by createPatternLexer_std with the option "VECTORED" defined
+/// \param[in] errorhnd error buffer interface for reporting errors
+PatternLexerSegmentContextInterface* createPatternLexerSegmentContext_std(
+		const PatternLexerInstanceInterface* lexer,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Write the compiled state of a lexer instance as image to a file
+/// \param[in] lexer compiled lexer instance created by the interface returned by createPatternLexer_std
+/// \param[in] filename path of the file to write
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return true on success, false on error
+/// \note The image contains the hyperscan databases, so it can only be loaded on hosts with the same hyperscan version and a compatible platform
+bool storePatternLexerImage_std(
+		const PatternLexerInstanceInterface* lexer,
+		const std::string& filename,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Create a compiled lexer instance from an image file written with storePatternLexerImage_std without compiling the expressions again
+/// \param[in] filename path of the file to load
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return the lexer instance ready for creating contexts
+PatternLexerInstanceInterface* loadPatternLexerImage_std(
+		const std::string& filename,
+		ErrorBufferInterface* errorhnd);
+
 /// \brief Create the interface for pattern matching on a regular language with tokens as alphabet
 PatternMatcherInterface* createPatternMatcher_std(
 		ErrorBufferInterface* errorhnd);
 
+/// \brief Write the compiled automaton of a pattern matcher instance as image to a file
+/// \param[in] matcher compiled pattern matcher instance created by the interface returned by createPatternMatcher_std
+/// \param[in] filename path of the file to write
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return true on success, false on error
+bool storePatternMatcherImage_std(
+		const PatternMatcherInstanceInterface* matcher,
+		const std::string& filename,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Create a compiled pattern matcher instance from an image file written with storePatternMatcherImage_std without compiling the patterns again
+/// \param[in] filename path of the file to load
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return the pattern matcher instance ready for creating contexts
+/// \note The image file is mapped read only into memory and the automaton tables are used in place, so processes loading the same image share its memory
+PatternMatcherInstanceInterface* loadPatternMatcherImage_std(
+		const std::string& filename,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Create a context running a lexer and feeding the lexems detected directly to a pattern matcher without building the list of lexems in between
+/// \param[in] lexer compiled lexer instance created by the interface returned by createPatternLexer_std
+/// \param[in] matcher compiled pattern matcher instance created by the interface returned by createPatternMatcher_std
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \note The instances passed have to be kept alive as long as the context is used
+PatternLexerMatcherContextInterface* createPatternLexerMatcherContext_std(
+		const PatternLexerInstanceInterface* lexer,
+		const PatternMatcherInstanceInterface* matcher,
+		ErrorBufferInterface* errorhnd);
+
+/// \brief Create a pool of threads running a lexer feeding a pattern matcher on many documents in parallel, every thread with its own lexer and pattern matcher context reused for all documents it processes
+/// \param[in] lexer compiled lexer instance created by the interface returned by createPatternLexer_std
+/// \param[in] matcher compiled pattern matcher instance created by the interface returned by createPatternMatcher_std
+/// \param[in] nofThreads number of threads of the pool
+/// \param[in] queueSize maximum number of documents waiting in the queue of one thread, the caller passing documents blocks until a queue has space
+/// \param[in] errorhnd error buffer interface for reporting errors, has to be created for at least nofThreads+1 threads
+/// \note The instances passed have to be kept alive as long as the pool is used
+PatternMatcherDocumentPoolInterface* createPatternMatcherDocumentPool_std(
+		const PatternLexerInstanceInterface* lexer,
+		const PatternMatcherInstanceInterface* matcher,
+		unsigned int nofThreads,
+		std::size_t queueSize,
+		ErrorBufferInterface* errorhnd);
+
 }//namespace
 #endif
 
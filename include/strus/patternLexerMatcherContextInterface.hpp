@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for the context of detecting patterns in a text with a lexer feeding a pattern matcher directly
+/// \file "patternLexerMatcherContextInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_MATCHER_CONTEXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_MATCHER_CONTEXT_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternMatcherResult.hpp"
+#include "strus/analyzer/patternMatcherStatistics.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting patterns in a text with a lexer feeding the lexems detected directly to a pattern matcher
+/// \note Equivalent to calling PatternLexerContextInterface::match and feeding the lexems returned one by one to PatternMatcherContextInterface::putInput, but without building the list of lexems
+class PatternLexerMatcherContextInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexerMatcherContextInterface(){}
+
+	/// \brief Run the lexer and the pattern matcher on a text
+	/// \param[in] src pointer to source to scan
+	/// \param[in] srclen length of src in bytes
+	/// \return the results of the pattern matcher on the text
+	/// \remark The context is reset after each call, so the next call starts on a new document
+	/// \remark The result values reference memory of the context, they are valid until the next call of this method
+	virtual std::vector<analyzer::PatternMatcherResult> match( const char* src, std::size_t srclen)=0;
+
+	/// \brief Get the statistics of the pattern matcher for the last call of match
+	virtual analyzer::PatternMatcherStatistics getStatistics() const=0;
+};
+
+} //namespace
+#endif
+
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for the context of detecting tokens defined as regular expressions in a document split into segments
+/// \file "patternLexerSegmentContextInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_SEGMENT_CONTEXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_SEGMENT_CONTEXT_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting tokens defined as regular expressions in all segments of a document with one call
+class PatternLexerSegmentContextInterface
+{
+public:
+	/// \brief One segment of a document as returned by a segmenter
+	struct Segment
+	{
+		std::size_t origseg;	///< original segment position as returned by the segmenter
+		const char* src;	///< pointer to the segment source
+		std::size_t srclen;	///< length of src in bytes
+
+		Segment()
+			:origseg(0),src(0),srclen(0){}
+		Segment( std::size_t origseg_, const char* src_, std::size_t srclen_)
+			:origseg(origseg_),src(src_),srclen(srclen_){}
+		Segment( const Segment& o)
+			:origseg(o.origseg),src(o.src),srclen(o.srclen){}
+	};
+
+	/// \brief Destructor
+	virtual ~PatternLexerSegmentContextInterface(){}
+
+	/// \brief Run the lexer on all segments of a document
+	/// \param[in] segar array of segments in ascending order of their position in the document
+	/// \param[in] segarsize number of elements in segar
+	/// \return list of the lexems (terms) detected with ordinal positions counted over all segments and the original position referring to the segment (origseg) and the byte offset in the segment
+	/// \remark Lexems spanning segment borders are not recognized, the segments are scanned as if they were separated by an end of line
+	virtual std::vector<analyzer::PatternLexem> matchSegments( const Segment* segar, std::size_t segarsize)=0;
+
+	/// \brief Reset the context to its initial state
+	virtual void reset()=0;
+};
+
+} //namespace
+#endif
+
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2016 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for the context of detecting tokens defined as regular expressions in a text fed chunk by chunk
+/// \file "patternLexerStreamContextInterface.hpp"
+#ifndef _STRUS_PATTERN_LEXER_STREAM_CONTEXT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXER_STREAM_CONTEXT_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting tokens defined as regular expressions in a text that is passed in successive chunks
+/// \note The positions (ordinal and original) of the lexems returned refer to the whole stream and not to the chunk passed
+class PatternLexerStreamContextInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternLexerStreamContextInterface(){}
+
+	/// \brief Feed the next chunk of the source to the lexer
+	/// \param[in] chunk pointer to the chunk of the source
+	/// \param[in] chunksize length of chunk in bytes
+	/// \return list of the lexems (terms) that cannot be affected by any further input anymore
+	/// \remark Lexems that still might get superseded by matches in following chunks are held back until a later call of putInput or close
+	virtual std::vector<analyzer::PatternLexem> putInput( const char* chunk, std::size_t chunksize)=0;
+
+	/// \brief Signal the end of the source
+	/// \return list of the lexems (terms) not yet returned by putInput
+	/// \remark After close the context is ready to process a new stream
+	virtual std::vector<analyzer::PatternLexem> close()=0;
+
+	/// \brief Reset the context to its initial state, dropping all data of the current stream
+	virtual void reset()=0;
+};
+
+} //namespace
+#endif
+
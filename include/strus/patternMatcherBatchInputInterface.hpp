@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for feeding a batch of terms to a pattern matcher context with one call
+/// \file "patternMatcherBatchInputInterface.hpp"
+#ifndef _STRUS_PATTERN_MATCHER_BATCH_INPUT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCHER_BATCH_INPUT_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for feeding a batch of terms to a pattern matcher context with one call
+/// \note The pattern matcher contexts created by the standard pattern matcher implement this interface in addition to PatternMatcherContextInterface, use dynamic_cast to get it
+class PatternMatcherBatchInputInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternMatcherBatchInputInterface(){}
+
+	/// \brief Feed the next input terms to process
+	/// \param[in] ar array of terms in ascending order of their ordinal position, all following the terms fed before
+	/// \param[in] arsize number of elements in ar
+	/// \remark The batch is validated before processing, if one term is not valid, none of the terms of the batch is processed
+	/// \remark Equivalent to calling PatternMatcherContextInterface::putInput for each term of the batch
+	virtual void putInputBatch( const analyzer::PatternLexem* ar, std::size_t arsize)=0;
+};
+
+} //namespace
+#endif
+
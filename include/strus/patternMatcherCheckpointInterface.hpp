@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for a snapshot of the state of a pattern matcher context
+/// \file "patternMatcherCheckpointInterface.hpp"
+#ifndef _STRUS_PATTERN_MATCHER_CHECKPOINT_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCHER_CHECKPOINT_INTERFACE_HPP_INCLUDED
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for a snapshot of the state of a pattern matcher context, created with PatternMatcherResumeInterface::createCheckpoint
+class PatternMatcherCheckpointInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternMatcherCheckpointInterface(){}
+
+	/// \brief Get the ordinal position of the last term fed to the context before the checkpoint was created
+	/// \return the ordinal position or 0 if no term was fed
+	/// \remark Terms fed to a context resumed from this checkpoint must have an ordinal position not smaller than this
+	virtual int position() const=0;
+};
+
+} //namespace
+#endif
+
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for detecting patterns in many documents in parallel with a pool of threads
+/// \file "patternMatcherDocumentPoolInterface.hpp"
+#ifndef _STRUS_PATTERN_MATCHER_DOCUMENT_POOL_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCHER_DOCUMENT_POOL_INTERFACE_HPP_INCLUDED
+#include "strus/analyzer/patternMatcherResult.hpp"
+#include <vector>
+#include <cstddef>
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Interface for detecting patterns in many documents in parallel with a pool of threads
+/// \note Every thread of the pool owns a lexer and a pattern matcher context, that are reused for all documents it processes
+class PatternMatcherDocumentPoolInterface
+{
+public:
+	/// \brief Source of a document to match
+	struct Document
+	{
+		const char* src;	///< pointer to the document source
+		std::size_t srclen;	///< length of src in bytes
+
+		Document()
+			:src(0),srclen(0){}
+		Document( const char* src_, std::size_t srclen_)
+			:src(src_),srclen(srclen_){}
+		Document( const Document& o)
+			:src(o.src),srclen(o.srclen){}
+	};
+
+	/// \brief Destructor
+	virtual ~PatternMatcherDocumentPoolInterface(){}
+
+	/// \brief Run the lexer and the pattern matcher on a list of documents
+	/// \param[in] docar array of documents
+	/// \param[in] docarsize number of elements in docar
+	/// \return the results of the pattern matcher for each document in the order of docar
+	/// \remark The result values reference memory of the contexts of the pool, they are valid until the next call of this method or the destruction of the pool
+	/// \remark Calls of this method from different threads are serialized
+	virtual std::vector<std::vector<analyzer::PatternMatcherResult> > matchDocuments( const Document* docar, std::size_t docarsize)=0;
+
+	/// \brief Get the number of threads of the pool
+	virtual unsigned int nofThreads() const=0;
+};
+
+} //namespace
+#endif
+
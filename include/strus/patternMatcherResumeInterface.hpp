@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Interface for creating checkpoints of the state of a pattern matcher context and resuming matching from them
+/// \file "patternMatcherResumeInterface.hpp"
+#ifndef _STRUS_PATTERN_MATCHER_RESUME_INTERFACE_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCHER_RESUME_INTERFACE_HPP_INCLUDED
+
+/// \brief strus toplevel namespace
+namespace strus
+{
+
+/// \brief Forward declaration
+class PatternMatcherCheckpointInterface;
+
+/// \brief Interface for creating checkpoints of the state of a pattern matcher context and resuming matching from them
+/// \note The pattern matcher contexts created by the standard pattern matcher implement this interface in addition to PatternMatcherContextInterface, use dynamic_cast to get it
+/// \note Used for matching only the changed tail of a document again, resuming from a checkpoint created at a segment boundary before the change
+class PatternMatcherResumeInterface
+{
+public:
+	/// \brief Destructor
+	virtual ~PatternMatcherResumeInterface(){}
+
+	/// \brief Create a snapshot of the current state of this context
+	/// \return the checkpoint (with ownership) or NULL on error
+	/// \remark The checkpoint shares the memory of the state with the context until one of them gets modified (copy on write),
+	///		so it has to be used and destroyed in the same thread as the context
+	/// \remark The checkpoint references the pattern matcher instance of the context, the instance has to be kept alive as long as the checkpoint exists
+	virtual PatternMatcherCheckpointInterface* createCheckpoint() const=0;
+
+	/// \brief Restore the state of this context from a checkpoint
+	/// \param[in] checkpoint checkpoint created by a context of the same pattern matcher instance
+	/// \remark The checkpoint stays valid and can be used for resuming again
+	/// \remark Equivalent to feeding a new context with all terms fed to the context of the checkpoint before its creation
+	virtual void resume( const PatternMatcherCheckpointInterface* checkpoint)=0;
+};
+
+} //namespace
+#endif
+
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Kernels for searching an event in an array of event identifiers, selected at runtime depending on the CPU
+/// \file "eventScan.cpp"
+#include "eventScan.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(_WIN32) && ((defined(__GNUC__) && __GNUC__ >= 5) || defined(__clang__))
+#include <immintrin.h>
+#define STRUS_USE_X86_SCAN_KERNELS
+#endif
+
+using namespace strus;
+
+static inline void scanRest( uint32_t* resultar, std::size_t& nofresults, uint32_t event, const uint32_t* eventar, std::size_t startidx, std::size_t arsize)
+{
+	std::size_t ii = startidx;
+	for (; ii < arsize; ++ii)
+	{
+		if (eventar[ ii] == event)
+		{
+			resultar[ nofresults++] = ii;
+		}
+	}
+}
+
+static std::size_t eventScan_scalar( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize)
+{
+	std::size_t nofresults = 0;
+	scanRest( resultar, nofresults, event, eventar, 0, arsize);
+	return nofresults;
+}
+
+#ifdef STRUS_USE_X86_SCAN_KERNELS
+static inline void appendMatches( uint32_t* resultar, std::size_t& nofresults, uint32_t base, uint64_t mask)
+{
+	while (mask)
+	{
+		// ... while there is a bit that points to a match, append the index of the match and clear the bit:
+		resultar[ nofresults++] = base + __builtin_ctzll( mask);
+		mask &= mask - 1;
+	}
+}
+
+///\note The SSE implementation was inspired by https://schani.wordpress.com/tag/c-optimization-linear-binary-search-sse2-simd
+///\note The kernels start scanning at startidx and handle the rest not filling a block with the next narrower kernel.
+///	The narrower kernels are inlined, so that they are encoded with the instruction set of the caller, avoiding transition penalties between SSE and AVX code
+__attribute__((target("sse2"),always_inline))
+static inline void scanFrom_sse2( uint32_t* resultar, std::size_t& nofresults, uint32_t event, const uint32_t* eventar, std::size_t startidx, std::size_t arsize)
+{
+	std::size_t ii = startidx;
+	std::size_t nn = startidx + ((arsize - startidx) & ~(std::size_t)15);	//... number of elements handled in blocks of 16
+	__m128i event4 = _mm_set1_epi32( event);
+
+	for (; ii < nn; ii += 16)
+	{
+		const __m128i* blk = (const __m128i*)(const void*)(eventar + ii);
+		// Compare 4 times 4 elements, each element of the result is 0xFFffFFff if equal, 0 else:
+		__m128i cmp0 = _mm_cmpeq_epi32( event4, _mm_loadu_si128( blk + 0));
+		__m128i cmp1 = _mm_cmpeq_epi32( event4, _mm_loadu_si128( blk + 1));
+		__m128i cmp2 = _mm_cmpeq_epi32( event4, _mm_loadu_si128( blk + 2));
+		__m128i cmp3 = _mm_cmpeq_epi32( event4, _mm_loadu_si128( blk + 3));
+		// Pack the results with sign into 16 bytes and get the most significant bit of each as mask:
+		__m128i pack01 = _mm_packs_epi32( cmp0, cmp1);
+		__m128i pack23 = _mm_packs_epi32( cmp2, cmp3);
+		uint32_t mask = _mm_movemask_epi8( _mm_packs_epi16( pack01, pack23));
+		appendMatches( resultar, nofresults, ii, mask);
+	}
+	scanRest( resultar, nofresults, event, eventar, ii, arsize);
+}
+
+__attribute__((target("avx2"),always_inline))
+static inline void scanFrom_avx2( uint32_t* resultar, std::size_t& nofresults, uint32_t event, const uint32_t* eventar, std::size_t startidx, std::size_t arsize)
+{
+	std::size_t ii = startidx;
+	std::size_t nn = startidx + ((arsize - startidx) & ~(std::size_t)31);	//... number of elements handled in blocks of 32
+	__m256i event8 = _mm256_set1_epi32( event);
+
+	for (; ii < nn; ii += 32)
+	{
+		const __m256i* blk = (const __m256i*)(const void*)(eventar + ii);
+		// Compare 4 times 8 elements and get the most significant bit of each element compared as mask:
+		uint32_t mask0 = _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( event8, _mm256_loadu_si256( blk + 0))));
+		uint32_t mask1 = _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( event8, _mm256_loadu_si256( blk + 1))));
+		uint32_t mask2 = _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( event8, _mm256_loadu_si256( blk + 2))));
+		uint32_t mask3 = _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpeq_epi32( event8, _mm256_loadu_si256( blk + 3))));
+		uint32_t mask = mask0 | (mask1 << 8) | (mask2 << 16) | (mask3 << 24);
+		appendMatches( resultar, nofresults, ii, mask);
+	}
+	scanFrom_sse2( resultar, nofresults, event, eventar, ii, arsize);
+}
+
+__attribute__((target("avx512f"),always_inline))
+static inline void scanFrom_avx512( uint32_t* resultar, std::size_t& nofresults, uint32_t event, const uint32_t* eventar, std::size_t startidx, std::size_t arsize)
+{
+	std::size_t ii = startidx;
+	std::size_t nn = startidx + ((arsize - startidx) & ~(std::size_t)63);	//... number of elements handled in blocks of 64
+	__m512i event16 = _mm512_set1_epi32( event);
+	__m512i index16 = _mm512_add_epi32( _mm512_set1_epi32( ii), _mm512_set_epi32( 15,14,13,12,11,10,9,8,7,6,5,4,3,2,1,0));
+	__m512i step16 = _mm512_set1_epi32( 16);
+	__m512i step64 = _mm512_set1_epi32( 64);
+
+	for (; ii < nn; ii += 64)
+	{
+		const uint32_t* blk = eventar + ii;
+		__mmask16 mask0 = _mm512_cmpeq_epi32_mask( event16, _mm512_loadu_si512( (const void*)(blk + 0)));
+		__mmask16 mask1 = _mm512_cmpeq_epi32_mask( event16, _mm512_loadu_si512( (const void*)(blk + 16)));
+		__mmask16 mask2 = _mm512_cmpeq_epi32_mask( event16, _mm512_loadu_si512( (const void*)(blk + 32)));
+		__mmask16 mask3 = _mm512_cmpeq_epi32_mask( event16, _mm512_loadu_si512( (const void*)(blk + 48)));
+		if ((mask0 | mask1 | mask2 | mask3) == 0)
+		{
+			index16 = _mm512_add_epi32( index16, step64);
+			continue;
+		}
+		// Write the indices of the matching elements with help of mask compress:
+		_mm512_mask_compressstoreu_epi32( (void*)(resultar + nofresults), mask0, index16);
+		nofresults += __builtin_popcount( mask0);
+		index16 = _mm512_add_epi32( index16, step16);
+		_mm512_mask_compressstoreu_epi32( (void*)(resultar + nofresults), mask1, index16);
+		nofresults += __builtin_popcount( mask1);
+		index16 = _mm512_add_epi32( index16, step16);
+		_mm512_mask_compressstoreu_epi32( (void*)(resultar + nofresults), mask2, index16);
+		nofresults += __builtin_popcount( mask2);
+		index16 = _mm512_add_epi32( index16, step16);
+		_mm512_mask_compressstoreu_epi32( (void*)(resultar + nofresults), mask3, index16);
+		nofresults += __builtin_popcount( mask3);
+		index16 = _mm512_add_epi32( index16, step16);
+	}
+	scanFrom_avx2( resultar, nofresults, event, eventar, ii, arsize);
+}
+
+__attribute__((target("sse2")))
+static std::size_t eventScan_sse2( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize)
+{
+	std::size_t nofresults = 0;
+	scanFrom_sse2( resultar, nofresults, event, eventar, 0, arsize);
+	return nofresults;
+}
+
+__attribute__((target("avx2")))
+static std::size_t eventScan_avx2( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize)
+{
+	std::size_t nofresults = 0;
+	scanFrom_avx2( resultar, nofresults, event, eventar, 0, arsize);
+	return nofresults;
+}
+
+__attribute__((target("avx512f")))
+static std::size_t eventScan_avx512( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize)
+{
+	std::size_t nofresults = 0;
+	scanFrom_avx512( resultar, nofresults, event, eventar, 0, arsize);
+	return nofresults;
+}
+#endif
+
+const char* strus::eventScanImplementationName( EventScanImplementation impl)
+{
+	static const char* ar[] = {"scalar","sse2","avx2","avx512"};
+	return ar[ impl];
+}
+
+bool strus::eventScanImplementationSupported( EventScanImplementation impl)
+{
+	switch (impl)
+	{
+		case EventScanScalar:
+			return true;
+#ifdef STRUS_USE_X86_SCAN_KERNELS
+		case EventScanSSE2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "sse2");
+		case EventScanAVX2:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "avx2");
+		case EventScanAVX512:
+			__builtin_cpu_init();
+			return __builtin_cpu_supports( "avx512f");
+#else
+		case EventScanSSE2:
+		case EventScanAVX2:
+		case EventScanAVX512:
+			return false;
+#endif
+	}
+	return false;
+}
+
+EventScanFunction strus::getEventScanFunction( EventScanImplementation impl)
+{
+	if (!eventScanImplementationSupported( impl)) return 0;
+	switch (impl)
+	{
+		case EventScanScalar:
+			return &eventScan_scalar;
+#ifdef STRUS_USE_X86_SCAN_KERNELS
+		case EventScanSSE2:
+			return &eventScan_sse2;
+		case EventScanAVX2:
+			return &eventScan_avx2;
+		case EventScanAVX512:
+			return &eventScan_avx512;
+#else
+		case EventScanSSE2:
+		case EventScanAVX2:
+		case EventScanAVX512:
+			return 0;
+#endif
+	}
+	return 0;
+}
+
+EventScanImplementation strus::bestEventScanImplementation()
+{
+	static const EventScanImplementation ar[] = {EventScanAVX512, EventScanAVX2, EventScanSSE2};
+	std::size_t ai = 0, ae = sizeof(ar)/sizeof(ar[0]);
+	for (; ai != ae; ++ai)
+	{
+		if (eventScanImplementationSupported( ar[ ai])) return ar[ ai];
+	}
+	return EventScanScalar;
+}
+
+std::size_t strus::eventScan( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize)
+{
+	static const EventScanFunction func = getEventScanFunction( bestEventScanImplementation());
+	return func( resultar, event, eventar, arsize);
+}
+
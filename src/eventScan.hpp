@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Kernels for searching an event in an array of event identifiers, selected at runtime depending on the CPU
+/// \file "eventScan.hpp"
+#ifndef _STRUS_PATTERN_EVENT_SCAN_HPP_INCLUDED
+#define _STRUS_PATTERN_EVENT_SCAN_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Function scanning an array of event identifiers for all occurrencies of one event
+/// \param[out] resultar where to write the indices of the matching elements in ascending order (must have space for arsize elements)
+/// \param[in] event event to search for
+/// \param[in] eventar array of event identifiers to scan
+/// \param[in] arsize number of elements in eventar
+/// \return the number of matches written to resultar
+typedef std::size_t (*EventScanFunction)( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize);
+
+/// \brief Implementations of the event scan
+enum EventScanImplementation
+{
+	EventScanScalar,	///< plain loop, available everywhere
+	EventScanSSE2,		///< 16 elements per iteration with SSE2
+	EventScanAVX2,		///< 32 elements per iteration with AVX2
+	EventScanAVX512		///< 64 elements per iteration with AVX-512 using mask compress
+};
+enum {NofEventScanImplementations=4};
+
+/// \brief Get the name of an event scan implementation
+const char* eventScanImplementationName( EventScanImplementation impl);
+
+/// \brief Test if an event scan implementation is compiled in and supported by the CPU the program is running on
+bool eventScanImplementationSupported( EventScanImplementation impl);
+
+/// \brief Get the function implementing the event scan with a specific implementation
+/// \return the function or NULL if the implementation is not available on this host
+EventScanFunction getEventScanFunction( EventScanImplementation impl);
+
+/// \brief Get the best event scan implementation available on this host, evaluated once with CPUID
+EventScanImplementation bestEventScanImplementation();
+
+/// \brief Event scan (see EventScanFunction) with the best implementation available on this host
+/// \note The implementation is selected on the first call and not during the initialization of static objects,
+///	so that the scan can be used from static initializers of other translation units
+std::size_t eventScan( uint32_t* resultar, uint32_t event, const uint32_t* eventar, std::size_t arsize);
+
+}//namespace
+#endif
+
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+///\brief Flat containers of event identifiers used for building the rule matcher automaton
+#ifndef _STRUS_PATTERN_FLAT_EVENT_MAP_HPP_INCLUDED
+#define _STRUS_PATTERN_FLAT_EVENT_MAP_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+namespace strus
+{
+
+/// \brief Map of event identifiers to values with open addressing in one array, without allocation of nodes
+/// \note The event 0 is stored apart, so that 0 can mark an empty slot
+template <typename ValueType>
+class FlatEventMap
+{
+public:
+	FlatEventMap()
+		:m_ar(),m_size(0),m_zeroValue(),m_hasZero(false){}
+
+	/// \brief Get the value of an event, insert a default value if it does not exist
+	ValueType& operator[]( uint32_t eventid)
+	{
+		if (!eventid)
+		{
+			if (!m_hasZero)
+			{
+				m_hasZero = true;
+				m_zeroValue = ValueType();
+				++m_size;
+			}
+			return m_zeroValue;
+		}
+		if ((m_size+1) * 2 > m_ar.size()) rehash();
+		std::size_t idx = slot( eventid);
+		if (!m_ar[ idx].eventid)
+		{
+			m_ar[ idx].eventid = eventid;
+			m_ar[ idx].value = ValueType();
+			++m_size;
+		}
+		return m_ar[ idx].value;
+	}
+
+	/// \brief Find the value of an event
+	/// \return a pointer to the value or NULL, if the event does not exist
+	const ValueType* find( uint32_t eventid) const
+	{
+		if (!eventid) return m_hasZero ? &m_zeroValue : 0;
+		if (m_ar.empty()) return 0;
+		const Element& elem = m_ar[ slot( eventid)];
+		return elem.eventid ? &elem.value : 0;
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+	void clear()
+	{
+		m_ar.clear();
+		m_size = 0;
+		m_hasZero = false;
+	}
+
+private:
+	struct Element
+	{
+		uint32_t eventid;
+		ValueType value;
+
+		Element()
+			:eventid(0),value(){}
+	};
+
+	static uint32_t hash( uint32_t a)
+	{
+		a *= 2654435761U;
+		return a ^ (a >> 16);
+	}
+
+	/// \brief Get the slot of an event or the empty slot where to insert it
+	std::size_t slot( uint32_t eventid) const
+	{
+		std::size_t mask = m_ar.size()-1;
+		std::size_t idx = hash( eventid) & mask;
+		while (m_ar[ idx].eventid && m_ar[ idx].eventid != eventid)
+		{
+			idx = (idx + 1) & mask;
+		}
+		return idx;
+	}
+
+	void rehash()
+	{
+		std::vector<Element> oldar;
+		oldar.swap( m_ar);
+		m_ar.resize( oldar.empty() ? 16 : oldar.size() * 2);
+		typename std::vector<Element>::const_iterator oi = oldar.begin(), oe = oldar.end();
+		for (; oi != oe; ++oi)
+		{
+			if (oi->eventid) m_ar[ slot( oi->eventid)] = *oi;
+		}
+	}
+
+private:
+	std::vector<Element> m_ar;		///< slots, size is zero or a power of 2, at least half of them empty
+	std::size_t m_size;			///< number of events including the event 0
+	ValueType m_zeroValue;			///< value of the event 0
+	bool m_hasZero;				///< true if the event 0 is defined
+};
+
+/// \brief Set of event identifiers as sorted array
+/// \note Expects a small number of elements or elements inserted mostly in ascending order, because an insert moves all bigger elements
+class FlatEventSet
+{
+public:
+	FlatEventSet()
+		:m_ar(){}
+
+	void insert( uint32_t eventid)
+	{
+		std::vector<uint32_t>::iterator ai = std::lower_bound( m_ar.begin(), m_ar.end(), eventid);
+		if (ai == m_ar.end() || *ai != eventid)
+		{
+			m_ar.insert( ai, eventid);
+		}
+	}
+
+	bool contains( uint32_t eventid) const
+	{
+		return std::binary_search( m_ar.begin(), m_ar.end(), eventid);
+	}
+
+	/// \brief Get the position of an event in ascending order starting with 1
+	/// \return the position or 0 if the event is not in the set
+	uint32_t index( uint32_t eventid) const
+	{
+		std::vector<uint32_t>::const_iterator ai = std::lower_bound( m_ar.begin(), m_ar.end(), eventid);
+		return (ai != m_ar.end() && *ai == eventid) ? (ai - m_ar.begin() + 1) : 0;
+	}
+
+	typedef std::vector<uint32_t>::const_iterator const_iterator;
+	const_iterator begin() const		{return m_ar.begin();}
+	const_iterator end() const		{return m_ar.end();}
+	std::size_t size() const		{return m_ar.size();}
+
+	void clear()
+	{
+		m_ar.clear();
+	}
+
+private:
+	std::vector<uint32_t> m_ar;
+};
+
+}//namespace
+#endif
+
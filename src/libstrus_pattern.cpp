@@ -11,6 +11,7 @@
 #include "strus/errorBufferInterface.hpp"
 #include "patternMatcher.hpp"
 #include "patternLexer.hpp"
+#include "patternMatcherDocumentPool.hpp"
 #include "strus/base/dll_tags.hpp"
 #include "internationalization.hpp"
 #include "errorUtils.hpp"
@@ -32,6 +33,34 @@ DLL_PUBLIC PatternMatcherInterface* strus::createPatternMatcher_std( ErrorBuffer
 	CATCH_ERROR_MAP_RETURN( _TXT("error creating token pattern match interface: %s"), *errorhnd, 0);
 }
 
+DLL_PUBLIC bool strus::storePatternMatcherImage_std( const PatternMatcherInstanceInterface* matcher, const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return storePatternMatcherImage( matcher, filename, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error storing token pattern match image: %s"), *errorhnd, false);
+}
+
+DLL_PUBLIC PatternMatcherInstanceInterface* strus::loadPatternMatcherImage_std( const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return loadPatternMatcherImage( filename, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error loading token pattern match image: %s"), *errorhnd, 0);
+}
+
 DLL_PUBLIC PatternLexerInterface* strus::createPatternLexer_std( ErrorBufferInterface* errorhnd)
 {
 	try
@@ -46,3 +75,87 @@ DLL_PUBLIC PatternLexerInterface* strus::createPatternLexer_std( ErrorBufferInte
 	CATCH_ERROR_MAP_RETURN( _TXT("error creating char regex match interface: %s"), *errorhnd, 0);
 }
 
+DLL_PUBLIC PatternLexerStreamContextInterface* strus::createPatternLexerStreamContext_std( const PatternLexerInstanceInterface* lexer, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return createPatternLexerStreamContext( lexer, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error creating char regex match stream context: %s"), *errorhnd, 0);
+}
+
+DLL_PUBLIC PatternLexerSegmentContextInterface* strus::createPatternLexerSegmentContext_std( const PatternLexerInstanceInterface* lexer, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return createPatternLexerSegmentContext( lexer, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error creating char regex match segment context: %s"), *errorhnd, 0);
+}
+
+DLL_PUBLIC bool strus::storePatternLexerImage_std( const PatternLexerInstanceInterface* lexer, const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return storePatternLexerImage( lexer, filename, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error storing char regex match image: %s"), *errorhnd, false);
+}
+
+DLL_PUBLIC PatternLexerInstanceInterface* strus::loadPatternLexerImage_std( const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return loadPatternLexerImage( filename, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error loading char regex match image: %s"), *errorhnd, 0);
+}
+
+DLL_PUBLIC PatternLexerMatcherContextInterface* strus::createPatternLexerMatcherContext_std( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* matcher, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return createPatternLexerMatcherContext( lexer, matcher, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error creating lexer pattern matcher context: %s"), *errorhnd, 0);
+}
+
+DLL_PUBLIC PatternMatcherDocumentPoolInterface* strus::createPatternMatcherDocumentPool_std( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* matcher, unsigned int nofThreads, std::size_t queueSize, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		if (!g_intl_initialized)
+		{
+			strus::initMessageTextDomain();
+			g_intl_initialized = true;
+		}
+		return createPatternMatcherDocumentPool( lexer, matcher, nofThreads, queueSize, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("error creating pattern matcher document pool: %s"), *errorhnd, 0);
+}
+
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Matching of the lexer patterns that are plain literals with a prefix trie, if hyperscan does not provide literal databases
+/// \file "literalTrie.cpp"
+#include "literalTrie.hpp"
+#include "serialization.hpp"
+#include "internationalization.hpp"
+#include "compactNodeTrie.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <new>
+#include <cstring>
+#include <cctype>
+
+using namespace strus;
+
+bool strus::parseLiteralAlternatives( std::vector<std::string>& res, const std::string& expression, bool caseless)
+{
+	static const char* metachars = ".^$|?*+()[]{}\\";
+	res.clear();
+	std::string literal;
+	char const* si = expression.c_str();
+	for (;;++si)
+	{
+		if (!*si || *si == '|')
+		{
+			//... empty alternatives match the empty string, they are left to the regular expression database
+			if (literal.empty()) return false;
+			res.push_back( literal);
+			literal.clear();
+			if (!*si) break;
+		}
+		else if (*si == '\\')
+		{
+			//... only escaped punctuation characters are literals, classes and character codes are not
+			++si;
+			if (!*si || (unsigned char)*si >= 128 || !std::ispunct( (unsigned char)*si)) return false;
+			literal.push_back( *si);
+		}
+		else if (std::strchr( metachars, *si))
+		{
+			return false;
+		}
+		else if (caseless && (unsigned char)*si >= 128)
+		{
+			//... caseless literal matching in hyperscan is defined for ASCII only
+			return false;
+		}
+		else
+		{
+			literal.push_back( *si);
+		}
+	}
+	return true;
+}
+
+static unsigned char asciiLower( unsigned char ch)
+{
+	return (ch >= 'A' && ch <= 'Z') ? (ch - 'A' + 'a') : ch;
+}
+
+LiteralTrie::LiteralTrie()
+	:m_trie(new conotrie::CompactNodeTrie()),m_literals(),m_literalids(),m_idlists(),m_caseless(false)
+{}
+
+LiteralTrie::~LiteralTrie()
+{
+	delete m_trie;
+}
+
+void LiteralTrie::add( const std::string& literal, unsigned int id, bool caseless)
+{
+	if (literal.empty() || literal.find( '\xFF') != std::string::npos)
+	{
+		throw std::runtime_error( _TXT("illegal literal for the literal trie of the lexer"));
+	}
+	if (m_idlists.empty())
+	{
+		m_caseless = caseless;
+	}
+	else if (m_caseless != caseless)
+	{
+		throw std::runtime_error( _TXT("literals with different case sensitivity in the literal trie of the lexer"));
+	}
+	std::string key( literal);
+	if (m_caseless)
+	{
+		std::string::iterator ki = key.begin(), ke = key.end();
+		for (; ki != ke; ++ki) *ki = asciiLower( (unsigned char)*ki);
+	}
+	conotrie::CompactNodeTrie::NodeData listidx;
+	if (m_trie->get( key.c_str(), listidx))
+	{
+		//... the same literal in more than one pattern or alternative, the identifiers are kept ascending without duplicates
+		std::vector<uint32_t>& idlist = m_idlists[ listidx-1];
+		std::vector<uint32_t>::iterator pi = std::lower_bound( idlist.begin(), idlist.end(), (uint32_t)id);
+		if (pi == idlist.end() || *pi != id) idlist.insert( pi, id);
+	}
+	else
+	{
+		if (m_idlists.size() >= (std::size_t)std::numeric_limits<uint32_t>::max()-1)
+		{
+			throw std::runtime_error( _TXT("too many literals in the literal trie of the lexer"));
+		}
+		m_idlists.push_back( std::vector<uint32_t>( 1, id));
+		if (!m_trie->set( key.c_str(), m_idlists.size()))
+		{
+			m_idlists.pop_back();
+			throw std::runtime_error( _TXT("too many literals in the literal trie of the lexer"));
+		}
+	}
+	m_literals.push_back( literal);
+	m_literalids.push_back( id);
+}
+
+void LiteralTrie::clear()
+{
+	m_trie->clear();
+	m_literals.clear();
+	m_literalids.clear();
+	m_idlists.clear();
+	m_caseless = false;
+}
+
+bool LiteralTrie::scan( const char* src, std::size_t srclen, MatchEventHandler handler, void* context) const
+{
+	conotrie::CompactNodeTrie::NodeAddress root = m_trie->rootAddress();
+	if (!root) return true;
+	const unsigned char* usrc = (const unsigned char*)src;
+	std::size_t start = 0;
+	for (; start < srclen; ++start)
+	{
+		// Walk the trie from every start position, reporting the literals ending on the way, the shortest first:
+		conotrie::CompactNodeTrie::NodeAddress addr = root;
+		std::size_t end = start;
+		while (end < srclen)
+		{
+			unsigned char ch = m_caseless ? asciiLower( usrc[ end]) : usrc[ end];
+			if (ch == 0xFF) break;
+			addr = m_trie->successor( addr, ch);
+			if (!addr) break;
+			++end;
+
+			conotrie::CompactNodeTrie::NodeData listidx;
+			if (m_trie->getNodeData( addr, listidx))
+			{
+				const std::vector<uint32_t>& idlist = m_idlists[ listidx-1];
+				std::vector<uint32_t>::const_iterator ii = idlist.begin(), ie = idlist.end();
+				for (; ii != ie; ++ii)
+				{
+					if (0!=handler( *ii, start, end, 0/*flags*/, context)) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+void LiteralTrie::storeImage( ImageWriter& out) const
+{
+	out.write<uint32_t>( m_caseless ? 1:0);
+	out.writeArray( m_literalids.empty() ? (const uint32_t*)0 : &m_literalids[0], m_literalids.size());
+	std::vector<std::string>::const_iterator li = m_literals.begin(), le = m_literals.end();
+	for (; li != le; ++li)
+	{
+		out.writeString( *li);
+	}
+}
+
+void LiteralTrie::loadImage( ImageReader& in, unsigned int maxid)
+{
+	clear();
+	uint32_t caseless = in.read<uint32_t>();
+	if (caseless > 1) throw std::runtime_error( _TXT("corrupt literal trie in lexer image"));
+	std::size_t arsize;
+	const uint32_t* idar = in.readArray<uint32_t>( arsize);
+	std::size_t ai = 0;
+	for (; ai < arsize; ++ai)
+	{
+		std::string literal = in.readString();
+		if (idar[ ai] == 0 || idar[ ai] > maxid || literal.empty() || literal.find( '\xFF') != std::string::npos)
+		{
+			throw std::runtime_error( _TXT("corrupt literal trie in lexer image"));
+		}
+		add( literal, idar[ ai], caseless != 0);
+	}
+}
+
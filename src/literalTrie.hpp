@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Matching of the lexer patterns that are plain literals with a prefix trie, if hyperscan does not provide literal databases
+/// \file "literalTrie.hpp"
+#ifndef _STRUS_PATTERN_LITERAL_TRIE_HPP_INCLUDED
+#define _STRUS_PATTERN_LITERAL_TRIE_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/// \brief Forward declaration
+namespace conotrie {
+class CompactNodeTrie;
+}
+
+namespace strus {
+
+/// \brief Forward declaration
+class ImageWriter;
+/// \brief Forward declaration
+class ImageReader;
+
+/// \brief Parse a regular expression that is a plain literal or an alternation of plain literals
+/// \param[out] res the literals, one for each alternative, escaped punctuation characters resolved
+/// \param[in] expression regular expression to parse
+/// \param[in] caseless true if the expression is matched case insensitive
+/// \return true, if the expression is a literal alternation, false else
+bool parseLiteralAlternatives( std::vector<std::string>& res, const std::string& expression, bool caseless);
+
+/// \brief Set of literals matched with a prefix trie (conotrie::CompactNodeTrie) reporting the same events as a hyperscan literal database
+/// \note Used for the literal patterns with versions of hyperscan before 5.2, that do not provide 'hs_compile_lit_multi'
+class LiteralTrie
+{
+public:
+	/// \brief Match event handler with the signature of the one of hyperscan
+	/// \return 0 to continue, any other value to terminate the scan
+	typedef int (*MatchEventHandler)( unsigned int id, unsigned long long from, unsigned long long to, unsigned int flags, void* context);
+
+	LiteralTrie();
+	~LiteralTrie();
+
+	/// \brief Add a literal
+	/// \param[in] literal the literal, must not be empty or contain the byte 0xFF (not valid in UTF-8 and used by the trie as end marker)
+	/// \param[in] id identifier of the pattern reported with the matches of the literal
+	/// \param[in] caseless true if the literal is matched case insensitive (ASCII only as in hyperscan)
+	/// \remark All literals of a trie must be added with the same value of caseless
+	void add( const std::string& literal, unsigned int id, bool caseless);
+
+	/// \brief Evaluate if the trie has no literals
+	bool empty() const
+	{
+		return m_idlists.empty();
+	}
+
+	/// \brief Remove all literals
+	void clear();
+
+	/// \brief Report the matches of all literals in a source to a handler
+	/// \param[in] src pointer to source to scan
+	/// \param[in] srclen length of src in bytes
+	/// \param[in] handler function called for every match, with the matches of the same start ordered by end
+	/// \param[in] context context passed to the handler
+	/// \return true on success, false if the handler terminated the scan
+	bool scan( const char* src, std::size_t srclen, MatchEventHandler handler, void* context) const;
+
+	/// \brief Write the literals to an image, the trie is rebuilt when loading it
+	void storeImage( ImageWriter& out) const;
+	/// \brief Load the literals from an image written with storeImage
+	/// \param[in] maxid maximum identifier of a pattern allowed
+	void loadImage( ImageReader& in, unsigned int maxid);
+
+private:
+#if __cplusplus >= 201103L
+	LiteralTrie( const LiteralTrie&) = delete;
+	void operator=( const LiteralTrie&) = delete;
+#else
+	LiteralTrie( const LiteralTrie&){}
+	void operator=( const LiteralTrie&){}
+#endif
+
+private:
+	conotrie::CompactNodeTrie* m_trie;			///< map of the literals to the index of their list of identifiers plus 1
+	std::vector<std::string> m_literals;			///< literals in the order of their insertion (for the image)
+	std::vector<uint32_t> m_literalids;			///< identifiers of the patterns of m_literals (for the image)
+	std::vector<std::vector<uint32_t> > m_idlists;		///< identifiers of the patterns of each literal, ascending
+	bool m_caseless;					///< true if the literals are matched case insensitive
+};
+
+}//namespace
+#endif
+
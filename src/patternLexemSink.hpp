@@ -0,0 +1,30 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Receiver of the lexems produced by a lexer, for passing them to a consumer without building a list of lexems
+/// \file "patternLexemSink.hpp"
+#ifndef _STRUS_PATTERN_LEXEM_SINK_HPP_INCLUDED
+#define _STRUS_PATTERN_LEXEM_SINK_HPP_INCLUDED
+#include "strus/analyzer/patternLexem.hpp"
+
+namespace strus {
+
+/// \brief Receiver of the lexems produced by a lexer in ascending order of their ordinal position
+/// \note The method is called push_back, so that the code producing lexems can be a template for both, a sink and an std::vector
+class PatternLexemSink
+{
+public:
+	virtual ~PatternLexemSink(){}
+
+	/// \brief Consume the next lexem
+	/// \param[in] lexem lexem with an ordinal position not smaller than the one of the previous lexem pushed
+	virtual void push_back( const analyzer::PatternLexem& lexem)=0;
+};
+
+}//namespace
+#endif
+
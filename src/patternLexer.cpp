@@ -8,30 +8,39 @@
 /// \brief Implementation of detecting tokens defined as regular expressions on text
 /// \file "patternLexer.hpp"
 #include "patternLexer.hpp"
+#include "patternLexemSink.hpp"
 #include "unicodeUtils.hpp"
 #include "strus/analyzer/patternLexem.hpp"
 #include "strus/analyzer/positionBind.hpp"
 #include "strus/patternLexerInstanceInterface.hpp"
 #include "strus/patternLexerContextInterface.hpp"
+#include "strus/patternLexerStreamContextInterface.hpp"
+#include "strus/patternLexerSegmentContextInterface.hpp"
 #include "strus/errorBufferInterface.hpp"
 #include "strus/reference.hpp"
 #include "strus/base/stdint.h"
 #include "strus/base/symbolTable.hpp"
 #include "strus/base/string_conv.hpp"
+#include "strus/base/thread.hpp"
 #include "strus/debugTraceInterface.hpp"
 #include "compactNodeTrie.hpp"
 #include "errorUtils.hpp"
 #include "internationalization.hpp"
 #include "hyperscanErrorCode.hpp"
+#include "serialization.hpp"
+#include "symbolPerfectHash.hpp"
+#include "literalTrie.hpp"
 #include "hs_compile.h"
 #include "hs.h"
 #include <vector>
 #include <string>
 #include <cstring>
+#include <cctype>
 #include <stdexcept>
 #include <limits>
 #include <iostream>
 #include <map>
+#include <algorithm>
 #undef TRE_USE_SYSTEM_REGEX_H
 #include <tre/tre.h>
 
@@ -49,6 +58,7 @@ public:
 		:m_expression()
 		,m_expression_onebyte()
 		,m_subexpref(0)
+		,m_mappedSubexpref(0)
 		,m_id(0)
 		,m_posbind(analyzer::BindContent)
 		,m_level(0)
@@ -66,6 +76,7 @@ public:
 		:m_expression(expression_)
 		,m_expression_onebyte()
 		,m_subexpref(subexpref_)
+		,m_mappedSubexpref(0)
 		,m_id(id_)
 		,m_posbind(posbind_)
 		,m_level(level_)
@@ -102,6 +113,7 @@ public:
 		:m_expression(o.m_expression)
 		,m_expression_onebyte(o.m_expression_onebyte)
 		,m_subexpref(o.m_subexpref)
+		,m_mappedSubexpref(o.m_mappedSubexpref)
 		,m_id(o.m_id)
 		,m_posbind(o.m_posbind)
 		,m_level(o.m_level)
@@ -113,6 +125,10 @@ public:
 	{
 		return m_subexpref;
 	}
+	unsigned int mappedSubexpref() const
+	{
+		return m_mappedSubexpref;
+	}
 	unsigned int id() const
 	{
 		return m_id;
@@ -163,11 +179,16 @@ public:
 	{
 		m_subexpref = subexpref_;
 	}
+	void setMappedSubExpressionRef( unsigned int subexpref_)
+	{
+		m_mappedSubexpref = subexpref_;
+	}
 
 private:
 	std::string m_expression;		///< regular expression string
 	std::string m_expression_onebyte;	///< regular expression string mapped down to one byte character set for prematching
 	uint32_t m_subexpref;			///< index of sub expression in sub expression table, for 2nd matching to get the sub expression match
+	uint32_t m_mappedSubexpref;		///< index of sub expression in sub expression table, for 2nd matching of a match found on the one byte character map of the source
 	uint32_t m_id;				///< id of the lexem as defined by definedLexem
 	uint8_t m_posbind;			///< analyzer position bind specificaction
 	uint8_t m_level;			///< priority level (bigger => higher priority)
@@ -227,12 +248,223 @@ public:
 	}
 };
 
+/// \brief Patterns of a HsPatternTable not separated for the literal database, referencing the elements of the table
+class HsPatternSelection
+{
+public:
+	std::vector<const char*> patternar;
+	std::vector<unsigned int> idar;
+	std::vector<unsigned int> flagar;
+	std::vector<const hs_expr_ext_t*> extar;
+
+	/// \param[in] hspt table to select from
+	/// \param[in] excluded flags for each pattern index (idar element minus one) telling if it is left out
+	HsPatternSelection( const HsPatternTable& hspt, const std::vector<bool>& excluded)
+	{
+		std::size_t ai = 0, ae = hspt.arsize;
+		for (; ai != ae; ++ai)
+		{
+			if (excluded[ hspt.idar[ ai]-1]) continue;
+			patternar.push_back( hspt.patternar[ ai]);
+			idar.push_back( hspt.idar[ ai]);
+			flagar.push_back( hspt.flagar[ ai]);
+			extar.push_back( hspt.extar[ ai]);
+		}
+	}
+};
+
+/// \brief Table of the patterns that are plain literals or alternations of plain literals, compiled as literals into a separate database
+class HsLiteralTable
+{
+public:
+	std::vector<std::string> literalar;	///< literals, one for each alternative
+	std::vector<unsigned int> idar;		///< index of the pattern of the literal starting with 1, the same as in the HsPatternTable
+	std::vector<unsigned int> flagar;	///< flags for compiling the literal
+
+	bool empty() const
+	{
+		return literalar.empty();
+	}
+};
+
+#if defined(HS_MAJOR) && (HS_MAJOR > 5 || (HS_MAJOR == 5 && HS_MINOR >= 2))
+/// \brief Hyperscan provides 'hs_compile_lit_multi' for compiling databases of pure literals
+#define STRUS_HS_LITERAL_API
+#endif
+
+/// \brief Skip a character class in a regular expression
+/// \param[in] si pointer to the opening '[' of the class
+/// \param[in] se end of the expression
+/// \return pointer to the character after the closing ']' or NULL if the class is not terminated
+static char const* skipCharClass( char const* si, const char* se)
+{
+	++si;
+	if (si != se && *si == '^') ++si;
+	if (si != se && *si == ']') ++si;
+	for (; si != se && *si != ']'; ++si)
+	{
+		if (*si == '\\' && si+1 != se) ++si;
+	}
+	return si == se ? 0 : si+1;
+}
+
+/// \brief Get the number of bytes of a character matched by an escape sequence in a regular expression, if it is fixed
+/// \param[in] ch character following the backslash
+/// \param[in] options options to stear matching
+/// \return the number of bytes or -1 if not fixed
+static int fixedEscapeWidth( char ch, unsigned int options)
+{
+	if (ch == 'd' || ch == 's' || ch == 'w')
+	{
+		//... character classes are ASCII only without unicode properties
+		return (options & HS_FLAG_UCP) ? -1 : 1;
+	}
+	if (ch == 't' || ch == 'n' || ch == 'r' || ch == 'f' || ch == 'v')
+	{
+		return 1;
+	}
+	return ((unsigned char)ch < 128 && std::ispunct( (unsigned char)ch)) ? 1 : -1;
+}
+
+/// \brief Get the number of bytes matched by a part of a regular expression without groups and alternatives, if it is fixed
+/// \param[in] si start of the part of the expression
+/// \param[in] se end of the part of the expression
+/// \param[in] options options to stear matching
+/// \return the number of bytes or -1 if not fixed or not decidable
+/// \note Rejects everything that might match a different number of bytes, e.g. caseless letters that have multibyte unicode case variants
+static int fixedMatchWidth( char const* si, const char* se, unsigned int options)
+{
+	bool caseless = 0!=(options & HS_FLAG_CASELESS);
+	int rt = 0;
+	while (si != se)
+	{
+		int width = 1;
+		if (*si == '\\')
+		{
+			++si;
+			if (si == se) return -1;
+			if (*si == 'b' || *si == 'B')
+			{
+				//... word boundary assertion with zero width, no quantifier allowed
+				++si;
+				if (si != se && std::strchr( "*+?{", *si)) return -1;
+				continue;
+			}
+			width = fixedEscapeWidth( *si, options);
+			if (width < 0) return -1;
+			++si;
+		}
+		else if (*si == '[')
+		{
+			char const* ce = skipCharClass( si, se);
+			if (!ce || si[1] == '^') return -1;
+			for (++si; si != ce-1; ++si)
+			{
+				if (*si == '\\')
+				{
+					++si;
+					if (fixedEscapeWidth( *si, options) < 0) return -1;
+				}
+				else if ((unsigned char)*si >= 128 || *si == '[' || (caseless && std::isalpha( (unsigned char)*si)))
+				{
+					return -1;
+				}
+			}
+			si = ce;
+		}
+		else if (*si == '^' || *si == '$')
+		{
+			++si;
+			if (si != se && std::strchr( "*+?{", *si)) return -1;
+			continue;
+		}
+		else if (std::strchr( ".()|*+?{}", *si))
+		{
+			return -1;
+		}
+		else if ((unsigned char)*si >= 128)
+		{
+			if (caseless) return -1;
+			//... UTF-8 multibyte character matched as a whole
+			for (++si; si != se && ((unsigned char)*si & 0xC0) == 0x80; ++si,++width){}
+		}
+		else
+		{
+			if (caseless && std::isalpha( (unsigned char)*si)) return -1;
+			++si;
+		}
+		if (si != se && *si == '{')
+		{
+			//... only a quantifier with an exact number of repetitions keeps the width fixed
+			int count = 0;
+			for (++si; si != se && *si >= '0' && *si <= '9'; ++si)
+			{
+				count = count * 10 + (*si - '0');
+				if (count > 1000) return -1;
+			}
+			if (si == se || *si != '}') return -1;
+			++si;
+			width *= count;
+		}
+		else if (si != se && std::strchr( "*+?", *si))
+		{
+			return -1;
+		}
+		rt += width;
+	}
+	return rt;
+}
+
+/// \brief Analyze a regular expression of the form prefix(capture)suffix with a fixed number of bytes matched by prefix and suffix
+/// \param[in] expression regular expression to analyze
+/// \param[in] resultidx index of the subexpression selected
+/// \param[in] options options to stear matching
+/// \param[out] prefixlen number of bytes matched by the prefix
+/// \param[out] suffixlen number of bytes matched by the suffix
+/// \return true, if the subexpression boundaries can be calculated from the boundaries of the whole match, false else
+static bool analyzeFixedCaptureBounds( const std::string& expression, unsigned int resultidx, unsigned int options, int& prefixlen, int& suffixlen)
+{
+	if (resultidx != 1) return false;
+	char const* si = expression.c_str();
+	const char* se = si + expression.size();
+	char const* open = si;
+	for (; open != se && *open != '('; ++open)
+	{
+		if (*open == '\\' && open+1 != se) ++open;
+		else if (*open == '[')
+		{
+			open = skipCharClass( open, se);
+			if (!open) return false;
+			--open;
+		}
+	}
+	if (open == se || open+1 == se || open[1] == '?') return false;
+	char const* close = open+1;
+	int depth = 1;
+	for (; close != se; ++close)
+	{
+		if (*close == '\\' && close+1 != se) ++close;
+		else if (*close == '[')
+		{
+			close = skipCharClass( close, se);
+			if (!close) return false;
+			--close;
+		}
+		else if (*close == '(') ++depth;
+		else if (*close == ')' && --depth == 0) break;
+	}
+	if (close == se) return false;
+	prefixlen = fixedMatchWidth( si, open, options);
+	suffixlen = fixedMatchWidth( close+1, se, options);
+	return prefixlen >= 0 && suffixlen >= 0;
+}
+
 
 class PatternTable
 {
 public:
 	explicit PatternTable( ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_debugtrace(0),m_withOneByteCharMap(false)
+		:m_errorhnd(errorhnd_),m_debugtrace(0),m_withOneByteCharMap(false),m_withApproxPatterns(false),m_withVectorOneByteCharMap(false)
 	{
 		DebugTraceInterface* debugtrace = m_errorhnd->debugTrace();
 		if (debugtrace) m_debugtrace = debugtrace->createTraceContext( "pattern");
@@ -282,6 +514,10 @@ public:
 			symtabref = yi->second;
 		}
 		PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
+		if (!pst.symtab.get())
+		{
+			throw std::runtime_error( _TXT("define symbol after building the symbol table"));
+		}
 		uint32_t symidx = pst.symtab->getOrCreate( name);
 		if (symidx != pst.idmap.size()+1)
 		{
@@ -304,7 +540,7 @@ public:
 		{
 			symtabref = yi->second;
 			const PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
-			uint32_t symidx = pst.symtab->get( name);
+			uint32_t symidx = pst.hash.built() ? pst.hash.get( name.c_str(), name.size()) : pst.symtab->get( name);
 			return symidx?pst.idmap[ symidx-1]:0;
 		}
 	}
@@ -312,7 +548,7 @@ public:
 	unsigned int symbolId( uint8_t symtabref, const char* keystr, std::size_t keylen) const
 	{
 		const PatternSymbolTable& pst = m_symtabmap[ symtabref-1];
-		uint32_t symidx = pst.symtab->get( keystr, keylen);
+		uint32_t symidx = pst.hash.get( keystr, keylen);
 		return symidx?pst.idmap[ symidx-1]:0;
 	}
 
@@ -321,6 +557,12 @@ public:
 		return m_defar[ id-1];
 	}
 
+	/// \brief Get the number of patterns defined, the maximum identifier of a pattern
+	unsigned int nofPatterns() const
+	{
+		return m_defar.size();
+	}
+
 	hs_expr_ext_t* createPatternExprExtFlags( unsigned int edit_distance)
 	{
 		hs_expr_ext_t* rt = (hs_expr_ext_t*)std::calloc( 1, sizeof( hs_expr_ext_t));
@@ -329,113 +571,335 @@ public:
 		rt->edit_distance = edit_distance;
 		return rt;
 	}
+
+	/// \brief Set an element of a table of patterns to compile
+	/// \param[in] mapped true if the pattern is scanned on the one byte character map of the source
+	void setPatternTableElement( HsPatternTable& tab, std::size_t tidx, PatternDef& def, std::size_t didx, bool mapped, unsigned int options)
+	{
+		if (mapped)
+		{
+			if (def.expression_onebyte().empty()) def.setExpressionOneByteCharMap();
+			tab.patternar[ tidx] = def.expression_onebyte().c_str();
+		}
+		else
+		{
+			tab.patternar[ tidx] = def.expression().c_str();
+		}
+		tab.idar[ tidx] = didx+1;
+		if (def.editdist())
+		{
+			tab.flagar[ tidx] = options | HS_FLAG_SOM_LEFTMOST;
+			tab.extar[ tidx] = createPatternExprExtFlags( def.editdist());
+		}
+		else if (mapped)
+		{
+			tab.flagar[ tidx] = options | HS_FLAG_SOM_LEFTMOST;
+			tab.extar[ tidx] = 0;
+		}
+		else
+		{
+			tab.flagar[ tidx] = options | HS_FLAG_UTF8 | HS_FLAG_SOM_LEFTMOST;
+			tab.extar[ tidx] = 0;
+		}
+	}
+	///\param[out] hspt table of the patterns scanned on the source or on its one byte character map, if used for all patterns
+	///\param[out] approxhspt table of the patterns with an edit distance scanned on the one byte character map of the source, if separated
+	///\param[out] vectorhspt table of all patterns for the database in vectored mode or NULL, scanned on the one byte character map if there are patterns with an edit distance
 	///\param[in] options options to stear matching
-	void complete( HsPatternTable& hspt, unsigned int options)
+	///\note The patterns with an edit distance are always separated for the database in block mode, so that the other patterns can be scanned on the source
+	void complete( HsPatternTable& hspt, HsPatternTable& approxhspt, HsPatternTable* vectorhspt, unsigned int options)
 	{
 		{
-			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			for (; di != de; ++di)
+			std::vector<PatternSymbolTable>::iterator ti = m_symtabmap.begin(), te = m_symtabmap.end();
+			for (; ti != te; ++ti)
 			{
-				if (di->editdist()) break;
+				if (ti->hash.built()) continue;
+				std::size_t si = 0, se = ti->idmap.size();
+				for (; si != se; ++si)
+				{
+					const char* key = ti->symtab->key( si+1);
+					ti->hash.addKey( key, std::strlen( key));
+				}
+				ti->hash.build();
+				//... the perfect hash has its own copy of the keys, the symbol table is not needed anymore
+				ti->symtab.reset();
 			}
-			m_withOneByteCharMap |= (di != de);
 		}
-		if (m_withOneByteCharMap)
+		std::size_t nofApprox = 0;
 		{
-			//... always do rematch expression in case of using edit dist because a match is only a hint:
 			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
 			for (; di != de; ++di)
 			{
-				SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), true/*wchar matching*/));
-				m_subexprmap.push_back( ref);
-				di->setSubExpressionRef( m_subexprmap.size());
+				if (di->editdist()) ++nofApprox;
 			}
+			m_withApproxPatterns = (nofApprox && !m_withOneByteCharMap);
+			//... the segments in vectored mode are scanned with one database, so all patterns are scanned on the one byte character map there
+			m_withVectorOneByteCharMap = vectorhspt && (nofApprox || m_withOneByteCharMap);
+			if (!m_withApproxPatterns) nofApprox = 0;
 		}
-		else
 		{
-			//... do rematch expression that select a subexpression:
 			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
 			for (; di != de; ++di)
 			{
+				if (m_withOneByteCharMap || di->editdist())
+				{
+					//... always do rematch expression in case of using edit dist because a match is only a hint:
+					SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), true/*wchar matching*/));
+					m_subexprmap.push_back( ref);
+					di->setSubExpressionRef( m_subexprmap.size());
+					di->setMappedSubExpressionRef( m_subexprmap.size());
+					continue;
+				}
 				if (di->resultidx() != 0)
 				{
-					SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), false/*byte matching*/));
+					//... do rematch expression that select a subexpression,
+					// the subexpression is calculated from the match without rematching, if the parts before and after it have a fixed size
+					int prefixlen = -1, suffixlen = -1;
+					SubExpressionReference ref;
+					if (analyzeFixedCaptureBounds( di->expression(), di->resultidx(), options, prefixlen, suffixlen))
+					{
+						if (m_debugtrace) m_debugtrace->event( "subexpression", "expr='%s' prefix=%d suffix=%d", di->expression().c_str(), prefixlen, suffixlen);
+						ref.reset( new SubExpressionDef( di->expression(), di->resultidx(), prefixlen, suffixlen));
+					}
+					else
+					{
+						ref.reset( new SubExpressionDef( di->expression(), di->resultidx(), di->editdist(), false/*byte matching*/));
+					}
 					m_subexprmap.push_back( ref);
 					di->setSubExpressionRef( m_subexprmap.size());
 				}
+				if (m_withVectorOneByteCharMap)
+				{
+					//... a match on the one byte character map in vectored mode is a hint that has to be rematched on the source:
+					SubExpressionReference ref( new SubExpressionDef( di->expression(), di->resultidx(), (unsigned int)0/*editdist*/, true/*wchar matching*/));
+					m_subexprmap.push_back( ref);
+					di->setMappedSubExpressionRef( m_subexprmap.size());
+				}
 			}
 		}
 		{
 			std::vector<PatternDef>::iterator di = m_defar.begin(), de = m_defar.end();
-			hspt.init( m_defar.size());
-			di = m_defar.begin();
+			hspt.init( m_defar.size() - nofApprox);
+			approxhspt.init( nofApprox);
+			if (vectorhspt) vectorhspt->init( m_defar.size());
+			std::size_t hidx = 0, aidx = 0;
 			for (std::size_t didx=0; di != de; ++di,++didx)
 			{
-				const char* expr;
-				if (m_withOneByteCharMap)
-				{
-					di->setExpressionOneByteCharMap();
-					expr = di->expression_onebyte().c_str();
-				}
-				else
-				{
-					expr = di->expression().c_str();
-				}
 				IdSymTabMap::const_iterator ti = m_idsymtabmap.find( di->id());
 				if (ti != m_idsymtabmap.end())
 				{
 					di->setSymtabref( ti->second);
 				}
-				hspt.patternar[ didx] = expr;
-				hspt.idar[ didx] = didx+1;
-				if (di->editdist())
+				if (m_withApproxPatterns && di->editdist())
 				{
-					hspt.flagar[ didx] = options | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = createPatternExprExtFlags( di->editdist());
+					setPatternTableElement( approxhspt, aidx++, *di, didx, true/*mapped*/, options);
 				}
-				else if (m_withOneByteCharMap)
+				else
 				{
-					hspt.flagar[ didx] = options | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = 0;
+					setPatternTableElement( hspt, hidx++, *di, didx, m_withOneByteCharMap, options);
 				}
-				else
+				if (vectorhspt)
 				{
-					hspt.flagar[ didx] = options | HS_FLAG_UTF8 | HS_FLAG_SOM_LEFTMOST;
-					hspt.extar[ didx] = 0;
+					setPatternTableElement( *vectorhspt, didx, *di, didx, m_withVectorOneByteCharMap, options);
 				}
 			}
 		}
-		hspt.patternar[ m_defar.size()] = 0;
-		hspt.idar[ m_defar.size()] = 0;
-		hspt.flagar[ m_defar.size()] = 0;
-		hspt.extar[ m_defar.size()] = 0;
+		//... the tables are terminated by the zero elements allocated by init
+	}
+
+	/// \brief Collect the patterns that are plain literals or alternations of plain literals for a separate literal database
+	/// \param[out] litt table of literals, empty if there are no literal patterns or if literals cannot be separated
+	/// \param[in] options options to stear matching
+	/// \remark Expects complete to be called before
+	/// \note Without literal databases in hyperscan (before 5.2) the literals are matched with a LiteralTrie
+	void completeLiterals( HsLiteralTable& litt, unsigned int options) const
+	{
+		if (m_withOneByteCharMap) return;
+		std::vector<std::string> alternatives;
+		std::vector<PatternDef>::const_iterator di = m_defar.begin(), de = m_defar.end();
+		for (std::size_t didx=0; di != de; ++di,++didx)
+		{
+			if (di->subexpref() || di->editdist()) continue;
+			if (!parseLiteralAlternatives( alternatives, di->expression(), 0!=(options & HS_FLAG_CASELESS))) continue;
+#ifndef STRUS_HS_LITERAL_API
+			//... the byte 0xFF is the end marker of the trie, literals containing it are left to the regular expression database
+			std::vector<std::string>::const_iterator xi = alternatives.begin(), xe = alternatives.end();
+			for (; xi != xe && xi->find( '\xFF') == std::string::npos; ++xi){}
+			if (xi != xe) continue;
+#endif
+
+			if (m_debugtrace) m_debugtrace->event( "literal", "idx=%d alternatives=%d", (int)(didx+1), (int)alternatives.size());
+			std::vector<std::string>::const_iterator ai = alternatives.begin(), ae = alternatives.end();
+			for (; ai != ae; ++ai)
+			{
+				litt.literalar.push_back( *ai);
+				litt.idar.push_back( didx+1);
+				litt.flagar.push_back( (options & HS_FLAG_CASELESS) | HS_FLAG_SOM_LEFTMOST);
+			}
+		}
 	}
 
-	bool matchSubExpression( uint32_t subexpref, const char* src, unsigned_long_long& from, unsigned_long_long& to) const
+	bool matchSubExpression( uint32_t subexpref, const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to) const
 	{
 		const SubExpressionDef& subedef = *m_subexprmap[ subexpref-1];
 		if (subedef.editdist)
 		{
 			int cost = 0;
-			return subedef.approx_match( src, from, to, cost);
+			return subedef.approx_match( src, srcsize, from, to, cost);
 		}
 		else
 		{
-			return subedef.match( src, from, to);
+			return subedef.match( src, srcsize, from, to);
 		}
 	}
 
-	/// \brief Check, if there exists a pattern with edit distance match
+	/// \brief Check, if all patterns are scanned on the source mapped to a one byte character set
 	bool withOneByteCharMap() const
 	{
 		return m_withOneByteCharMap;
 	}
+	/// \brief Check, if the patterns with edit distance match are separated and scanned on the source mapped to a one byte character set
+	bool withApproxPatterns() const
+	{
+		return m_withApproxPatterns;
+	}
+	/// \brief Check, if all patterns are scanned on the source mapped to a one byte character set in vectored mode
+	bool withVectorOneByteCharMap() const
+	{
+		return m_withVectorOneByteCharMap;
+	}
 	/// \brief Force mapping to a virtual character set of one byte characters used as hash and post filtering
 	void forceOneByteCharMap()
 	{
 		m_withOneByteCharMap = true;
 	}
 
+	/// \brief Write the completed table to an image
+	void storeImage( ImageWriter& out) const
+	{
+		out.write<uint32_t>( m_withOneByteCharMap ? 1:0);
+		out.write<uint32_t>( m_withApproxPatterns ? 1:0);
+		out.write<uint32_t>( m_withVectorOneByteCharMap ? 1:0);
+		out.write<uint64_t>( m_defar.size());
+		std::vector<PatternDef>::const_iterator di = m_defar.begin(), de = m_defar.end();
+		for (; di != de; ++di)
+		{
+			out.writeString( di->expression());
+			out.write<uint32_t>( di->subexpref());
+			out.write<uint32_t>( di->mappedSubexpref());
+			out.write<uint32_t>( di->id());
+			out.write<uint32_t>( di->posbind());
+			out.write<uint32_t>( di->level());
+			out.write<uint32_t>( di->resultidx());
+			out.write<uint32_t>( di->editdist());
+			out.write<uint32_t>( di->symtabref());
+		}
+		out.write<uint64_t>( m_symtabmap.size());
+		std::vector<PatternSymbolTable>::const_iterator ti = m_symtabmap.begin(), te = m_symtabmap.end();
+		for (; ti != te; ++ti)
+		{
+			std::vector<uint32_t> idmap( ti->idmap.begin(), ti->idmap.end());
+			out.writeArray( idmap.empty() ? (const uint32_t*)0 : &idmap[0], idmap.size());
+			ti->hash.storeImage( out);
+		}
+		out.write<uint64_t>( m_idsymtabmap.size());
+		IdSymTabMap::const_iterator yi = m_idsymtabmap.begin(), ye = m_idsymtabmap.end();
+		for (; yi != ye; ++yi)
+		{
+			out.write<uint32_t>( yi->first);
+			out.write<uint32_t>( yi->second);
+		}
+		out.write<uint64_t>( m_subexprmap.size());
+		std::vector<SubExpressionReference>::const_iterator xi = m_subexprmap.begin(), xe = m_subexprmap.end();
+		for (; xi != xe; ++xi)
+		{
+			out.writeString( (*xi)->expression);
+			out.write<uint32_t>( (*xi)->index);
+			out.write<uint32_t>( (*xi)->editdist);
+			out.write<uint32_t>( (*xi)->usewchar ? 1:0);
+			out.write<int32_t>( (*xi)->prefixlen);
+			out.write<int32_t>( (*xi)->suffixlen);
+		}
+	}
+
+	/// \brief Restore a completed table from an image written with storeImage
+	void loadImage( ImageReader& in)
+	{
+		m_withOneByteCharMap = (0!=in.read<uint32_t>());
+		m_withApproxPatterns = (0!=in.read<uint32_t>());
+		m_withVectorOneByteCharMap = (0!=in.read<uint32_t>());
+		std::size_t di = 0, de = in.read<uint64_t>();
+		m_defar.clear();
+		m_defar.reserve( de);
+		for (; di != de; ++di)
+		{
+			std::string expression = in.readString();
+			unsigned int subexpref = in.read<uint32_t>();
+			unsigned int mappedSubexpref = in.read<uint32_t>();
+			unsigned int id = in.read<uint32_t>();
+			analyzer::PositionBind posbind = (analyzer::PositionBind)in.read<uint32_t>();
+			unsigned int level = in.read<uint32_t>();
+			unsigned int resultidx = in.read<uint32_t>();
+			unsigned int editdist = in.read<uint32_t>();
+			unsigned int symtabref = in.read<uint32_t>();
+			m_defar.push_back( PatternDef( expression, subexpref, id, posbind, level, resultidx, editdist, symtabref));
+			m_defar.back().setMappedSubExpressionRef( mappedSubexpref);
+		}
+		std::size_t ti = 0, te = in.read<uint64_t>();
+		m_symtabmap.clear();
+		for (; ti != te; ++ti)
+		{
+			m_symtabmap.push_back( PatternSymbolTable());
+			PatternSymbolTable& pst = m_symtabmap.back();
+			std::size_t idmapsize;
+			const uint32_t* idmap = in.readArray<uint32_t>( idmapsize);
+			pst.idmap.assign( idmap, idmap + idmapsize);
+			pst.hash.loadImage( in);
+			if (pst.hash.size() != idmapsize)
+			{
+				throw std::runtime_error( _TXT("corrupt symbol table in lexer image"));
+			}
+		}
+		std::size_t yi = 0, ye = in.read<uint64_t>();
+		m_idsymtabmap.clear();
+		for (; yi != ye; ++yi)
+		{
+			uint32_t patternid = in.read<uint32_t>();
+			uint32_t symtabref = in.read<uint32_t>();
+			if (symtabref == 0 || symtabref > m_symtabmap.size())
+			{
+				throw std::runtime_error( _TXT("corrupt symbol table reference in lexer image"));
+			}
+			m_idsymtabmap[ patternid] = symtabref;
+		}
+		std::size_t xi = 0, xe = in.read<uint64_t>();
+		m_subexprmap.clear();
+		for (; xi != xe; ++xi)
+		{
+			std::string expression = in.readString();
+			std::size_t index = in.read<uint32_t>();
+			unsigned int editdist = in.read<uint32_t>();
+			bool usewchar = (0!=in.read<uint32_t>());
+			int prefixlen = in.read<int32_t>();
+			int suffixlen = in.read<int32_t>();
+			if (prefixlen >= 0 && suffixlen >= 0)
+			{
+				m_subexprmap.push_back( SubExpressionReference( new SubExpressionDef( expression, index, prefixlen, suffixlen)));
+			}
+			else
+			{
+				m_subexprmap.push_back( SubExpressionReference( new SubExpressionDef( expression, index, editdist, usewchar)));
+			}
+		}
+		for (di=0; di != de; ++di)
+		{
+			if (m_defar[ di].subexpref() > m_subexprmap.size() || m_defar[ di].mappedSubexpref() > m_subexprmap.size() || m_defar[ di].symtabref() > m_symtabmap.size())
+			{
+				throw std::runtime_error( _TXT("corrupt pattern definition in lexer image"));
+			}
+		}
+	}
+
 private:
 	uint8_t createSymbolTable()
 	{
@@ -450,13 +914,22 @@ private:
 	struct SubExpressionDef
 	{
 		regex_t regex;
+		std::string expression;
 		std::size_t index;
 		unsigned int editdist;
 		bool usewchar;
+		int prefixlen;		///< number of bytes of the match before the subexpression, -1 if the subexpression is found by rematching with TRE
+		int suffixlen;		///< number of bytes of the match after the subexpression, -1 if the subexpression is found by rematching with TRE
 		enum {MaxSubexpressionIndex=99};
 
-		SubExpressionDef( const std::string& expression, std::size_t index_, unsigned int editdist_, bool usewchar_)
-			:index(index_),editdist(editdist_),usewchar(usewchar_)
+		/// \brief Constructor for a subexpression calculated from the boundaries of the match, the expression is not compiled
+		SubExpressionDef( const std::string& expression_, std::size_t index_, int prefixlen_, int suffixlen_)
+			:expression(expression_),index(index_),editdist(0),usewchar(false),prefixlen(prefixlen_),suffixlen(suffixlen_)
+		{}
+
+		/// \brief Constructor for a subexpression found by rematching the expression with TRE
+		SubExpressionDef( const std::string& expression_, std::size_t index_, unsigned int editdist_, bool usewchar_)
+			:expression(expression_),index(index_),editdist(editdist_),usewchar(usewchar_),prefixlen(-1),suffixlen(-1)
 		{
 			if (index > MaxSubexpressionIndex+1)
 			{
@@ -482,14 +955,21 @@ private:
 		}
 		~SubExpressionDef()
 		{
-			tre_regfree( &regex);
+			if (prefixlen < 0) tre_regfree( &regex);
 		}
 
-		bool match( const char* src, unsigned_long_long& from, unsigned_long_long& to) const
+		bool match( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to) const
 		{
+			if (prefixlen >= 0)
+			{
+				if (to - from < (unsigned_long_long)(prefixlen + suffixlen)) return false;
+				from += prefixlen;
+				to -= suffixlen;
+				return true;
+			}
 			const char* start = src + from;
 			regmatch_t pmatch[ MaxSubexpressionIndex+1];
-			int errcode = tre_regexec( &regex, start, index+1, pmatch, REG_NOTBOL | REG_NOTEOL);
+			int errcode = tre_regnexec( &regex, start, srcsize - from, index+1, pmatch, REG_NOTBOL | REG_NOTEOL);
 			if (errcode)
 			{
 				if (errcode == REG_NOMATCH) return false;
@@ -506,20 +986,20 @@ private:
 			return true;
 		}
 
-		bool approx_match( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
+		bool approx_match( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
 		{
 			if (usewchar)
 			{
-				return approx_match_wchar( src, from, to, cost);
+				return approx_match_wchar( src, srcsize, from, to, cost);
 			}
 			else
 			{
-				return approx_match_utf8( src, from, to, cost);
+				return approx_match_utf8( src, srcsize, from, to, cost);
 			}
 		}
 		
 private:
-		bool approx_match_utf8( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
+		bool approx_match_utf8( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
 		{
 			const char* start = src + from;
 			regaparams_t params;
@@ -537,7 +1017,7 @@ private:
 			std::memset( &amatch, 0, sizeof(amatch));
 			amatch.nmatch = index+1;
 			amatch.pmatch = pmatch;
-			int errcode = tre_regaexec( &regex, start, &amatch, params, REG_NOTBOL | REG_NOTEOL);
+			int errcode = tre_reganexec( &regex, start, srcsize - from, &amatch, params, REG_NOTBOL | REG_NOTEOL);
 			if (errcode)
 			{
 				if (errcode == REG_NOMATCH) return false;
@@ -555,9 +1035,11 @@ private:
 			return true;
 		}
 
-		bool approx_match_wchar( const char* src, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
+		bool approx_match_wchar( const char* src, std::size_t srcsize, unsigned_long_long& from, unsigned_long_long& to, int& cost) const
 		{
-			WCharString wsrc( src + from, to - from + editdist * sizeof(wchar_t));
+			unsigned_long_long wsrcsize = to - from + editdist * sizeof(wchar_t);
+			if (wsrcsize > srcsize - from) wsrcsize = srcsize - from;
+			WCharString wsrc( src + from, wsrcsize);
 			const wchar_t* wstart = wsrc.str();
 
 			regaparams_t params;
@@ -628,13 +1110,16 @@ private:
 private:
 	struct PatternSymbolTable
 	{
-		Reference<SymbolTable> symtab;
+		Reference<SymbolTable> symtab;		///< symbols defined, released when the hash is built and empty for a table loaded from an image
 		std::vector<unsigned int> idmap;
+		SymbolPerfectHash hash;			///< immutable dictionary of the symbols built on compile, used for the lookup when matching
 
+		PatternSymbolTable()
+			:symtab(),idmap(),hash(){}
 		explicit PatternSymbolTable( ErrorBufferInterface* errorhnd)
-			:symtab( new SymbolTable(errorhnd)),idmap(){}
+			:symtab( new SymbolTable(errorhnd)),idmap(),hash(){}
 		PatternSymbolTable( const PatternSymbolTable& o)
-			:symtab(o.symtab),idmap(o.idmap){}
+			:symtab(o.symtab),idmap(o.idmap),hash(o.hash){}
 	};
 
 	ErrorBufferInterface* m_errorhnd;
@@ -646,19 +1131,136 @@ private:
 	typedef Reference<SubExpressionDef> SubExpressionReference;
 	std::vector<SubExpressionReference> m_subexprmap;	///< single regular expression patterns for extracting subexpressions if they are referenced.
 	bool m_withOneByteCharMap;				///< true if the automaton has to be mapped down to a one byte character set serving as hash
+	bool m_withApproxPatterns;				///< true if the patterns with edit distance are in a separate automaton mapped down to a one byte character set
+	bool m_withVectorOneByteCharMap;			///< true if the automaton in vectored mode has to be mapped down to a one byte character set
 };
 
 
+/// \brief Pool of hyperscan scratch spaces for one database, shared by the contexts of a lexer instance
+/// \note The scratch spaces are cloned from a prototype allocated with the first request and taken back when a context is destroyed,
+///	so that creating a short living context does not allocate a scratch space
+class ScratchPool
+{
+public:
+	ScratchPool()
+		:m_mutex(),m_prototype(0),m_free(){}
+	~ScratchPool()
+	{
+		clear();
+	}
+
+	/// \brief Get a scratch space for scanning with a database
+	/// \param[in] db database or NULL, the same for all calls until the next clear
+	/// \param[in] db2 second database scanned with the same scratch space or NULL, the same for all calls until the next clear
+	/// \param[in] db3 third database scanned with the same scratch space or NULL, the same for all calls until the next clear
+	/// \return the scratch space, to be given back with put
+	hs_scratch_t* get( const hs_database_t* db, const hs_database_t* db2=0, const hs_database_t* db3=0) const
+	{
+		{
+			strus::scoped_lock lock( m_mutex);
+			if (!m_free.empty())
+			{
+				hs_scratch_t* rt = m_free.back();
+				m_free.pop_back();
+				return rt;
+			}
+			if (!m_prototype)
+			{
+				// ... a scratch space allocated for more than one database is usable for scanning with each of them
+				if ((db && HS_SUCCESS != hs_alloc_scratch( db, &m_prototype))
+				||  (db2 && HS_SUCCESS != hs_alloc_scratch( db2, &m_prototype))
+				||  (db3 && HS_SUCCESS != hs_alloc_scratch( db3, &m_prototype)))
+				{
+					if (m_prototype) hs_free_scratch( m_prototype);
+					m_prototype = 0;
+					throw std::bad_alloc();
+				}
+			}
+		}
+		// ... the prototype is never used for scanning, so it can be cloned without holding the lock
+		hs_scratch_t* rt = 0;
+		if (HS_SUCCESS != hs_clone_scratch( m_prototype, &rt))
+		{
+			throw std::bad_alloc();
+		}
+		return rt;
+	}
+
+	/// \brief Give back a scratch space got with get
+	void put( hs_scratch_t* scratch) const
+	{
+		if (!scratch) return;
+		try
+		{
+			strus::scoped_lock lock( m_mutex);
+			m_free.push_back( scratch);
+		}
+		catch (const std::bad_alloc&)
+		{
+			hs_free_scratch( scratch);
+		}
+	}
+
+	/// \brief Free all scratch spaces, called when the database is replaced
+	/// \remark Expects that no context using the pool exists
+	void clear()
+	{
+		std::vector<hs_scratch_t*>::const_iterator fi = m_free.begin(), fe = m_free.end();
+		for (; fi != fe; ++fi)
+		{
+			hs_free_scratch( *fi);
+		}
+		m_free.clear();
+		if (m_prototype) hs_free_scratch( m_prototype);
+		m_prototype = 0;
+	}
+
+private:
+#if __cplusplus >= 201103L
+	ScratchPool( const ScratchPool&) = delete;
+	void operator=( const ScratchPool&) = delete;
+#else
+	ScratchPool( const ScratchPool&){}
+	void operator=( const ScratchPool&){}
+#endif
+
+private:
+	mutable strus::mutex m_mutex;
+	mutable hs_scratch_t* m_prototype;			///< scratch allocated for the database, only used for cloning
+	mutable std::vector<hs_scratch_t*> m_free;		///< scratch spaces given back by contexts destroyed
+};
+
 struct TermMatchData
 {
 	PatternTable patternTable;
-	hs_database_t* patterndb;
+	hs_database_t* patterndb;		///< database of the patterns that are not literals in block mode, NULL if all patterns are in the literaldb or the literalTrie
+	hs_database_t* literaldb;		///< database of the patterns that are literal alternations in block mode, NULL if not separated
+	LiteralTrie literalTrie;		///< trie of the patterns that are literal alternations in block mode, used instead of literaldb if hyperscan does not provide literal databases (before 5.2)
+	hs_database_t* approxdb;		///< database of the patterns with edit distance scanned on the one byte character map in block mode, NULL if not separated
+	hs_database_t* streamdb;		///< database compiled in streaming mode, only defined with option STREAM set
+	hs_database_t* vectordb;		///< database compiled in vectored mode, only defined with option VECTORED set
+	ScratchPool patternScratchPool;		///< pool of scratch spaces for patterndb, literaldb and approxdb
+	ScratchPool streamScratchPool;		///< pool of scratch spaces for streamdb
+	ScratchPool vectorScratchPool;		///< pool of scratch spaces for vectordb
 
 	explicit TermMatchData( ErrorBufferInterface* errorhnd_)
-		:patternTable( errorhnd_),patterndb(0){}
+		:patternTable( errorhnd_),patterndb(0),literaldb(0),literalTrie(),approxdb(0),streamdb(0),vectordb(0)
+		,patternScratchPool(),streamScratchPool(),vectorScratchPool(){}
 	~TermMatchData()
 	{
+		clearScratchPools();
 		if (patterndb) hs_free_database(patterndb);
+		if (literaldb) hs_free_database(literaldb);
+		if (approxdb) hs_free_database(approxdb);
+		if (streamdb) hs_free_database(streamdb);
+		if (vectordb) hs_free_database(vectordb);
+	}
+
+	void clearScratchPools()
+	{
+		patternScratchPool.clear();
+		streamScratchPool.clear();
+		vectorScratchPool.clear();
 	}
 };
 
@@ -678,148 +1280,376 @@ struct MatchEvent
 		:id(o.id),level(o.level),posbind(o.posbind),origsize(o.origsize),origpos(o.origpos){}
 };
 
-class PatternLexerContext
-	:public PatternLexerContextInterface
+/// \brief Collection of the match events reported by hyperscan
+/// \note The events are appended in the order they are reported. Sorting by origpos and the superseding of elements
+///	by elements with a higher level is done in one pass, when the events before a position are final.
+///	Inserting the events reported into a sorted list directly leads to quadratic behaviour on inputs with many overlapping lexems.
+class MatchEventCollector
 {
 public:
-	PatternLexerContext( const TermMatchData* data_, ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_data(data_),m_hs_scratch(0),m_src(0),m_matchEventAr(),m_charmap()
+	MatchEventCollector()
+		:m_ar(),m_nofSorted(0),m_seqno(0),m_groupidxar(),m_deleted()
 	{
-		hs_error_t err = hs_alloc_scratch( m_data->patterndb, &m_hs_scratch);
-		if (err != HS_SUCCESS)
+		std::memset( m_coverEnd, 0, sizeof(m_coverEnd));
+	}
+
+	/// \brief Reserve memory for a number of events expected
+	void reserve( std::size_t nofEvents)
+	{
+		m_ar.reserve( nofEvents);
+	}
+
+	/// \brief Add a match event reported
+	/// \param[in] event match event with the id of the pattern
+	/// \param[in] symid identifier of the symbol matched or 0, if the event is not a symbol
+	void push( const MatchEvent& event, uint32_t symid)
+	{
+		m_ar.push_back( Element( event, symid, m_seqno++));
+	}
+
+	/// \brief Get all events with an origpos before a position, sorted by origpos and with the superseded elements removed
+	/// \param[in,out] res where to append the events to
+	/// \param[in] finalpos position before that all events are reported and therefore final
+	/// \remark Events reported later must not have an origpos smaller than finalpos
+	void fetch( std::vector<MatchEvent>& res, uint32_t finalpos)
+	{
+		// Sort the events added since the last call and merge them with the remaining events of the last call:
+		std::vector<Element>::iterator sortedEnd = m_ar.begin() + m_nofSorted;
+		std::sort( sortedEnd, m_ar.end());
+		std::inplace_merge( m_ar.begin(), sortedEnd, m_ar.end());
+		m_nofSorted = m_ar.size();
+
+		// Sweep through the groups of elements with the same origpos:
+		std::size_t gi = 0, ge = m_ar.size();
+		while (gi != ge && m_ar[ gi].event.origpos < finalpos)
 		{
-			throw std::bad_alloc();
+			std::size_t gn = gi+1;
+			for (; gn != ge && m_ar[ gn].event.origpos == m_ar[ gi].event.origpos; ++gn){}
+			sweepGroup( res, gi, gn);
+			gi = gn;
 		}
+		m_ar.erase( m_ar.begin(), m_ar.begin() + gi);
+		m_nofSorted -= gi;
 	}
 
-	virtual ~PatternLexerContext()
+	/// \brief Get all events, sorted by origpos and with the superseded elements removed
+	/// \param[in,out] res where to append the events to
+	void fetchAll( std::vector<MatchEvent>& res)
 	{
-		hs_free_scratch( m_hs_scratch);
+		fetch( res, std::numeric_limits<uint32_t>::max());
+		clear();
 	}
 
-	virtual void reset()
+	/// \brief Reset to the initial state
+	void clear()
 	{
-		try
+		m_ar.clear();
+		m_nofSorted = 0;
+		m_seqno = 0;
+		std::memset( m_coverEnd, 0, sizeof(m_coverEnd));
+	}
+
+private:
+	struct Element
+	{
+		MatchEvent event;	///< event with the id of the pattern
+		uint32_t symid;		///< identifier of the symbol matched or 0
+		uint32_t seqno;		///< sequence number of the event reported
+
+		Element( const MatchEvent& event_, uint32_t symid_, uint32_t seqno_)
+			:event(event_),symid(symid_),seqno(seqno_){}
+		Element( const Element& o)
+			:event(o.event),symid(o.symid),seqno(o.seqno){}
+
+		/// \note Hyperscan reports the events of one scan ordered by their end, elements with the same origpos are ordered by end too,
+		///	so that the events of the scans of the pattern and of the literal database are in the same order as if scanned together
+		bool operator < (const Element& o) const
 		{
-			hs_scratch_t* new_scratch = 0;
-			hs_error_t err = hs_alloc_scratch( m_data->patterndb, &m_hs_scratch);
-			if (err != HS_SUCCESS)
-			{
-				throw std::bad_alloc();
-			}
-			hs_free_scratch( m_hs_scratch);
-			m_hs_scratch = new_scratch;
-			m_src = 0;
+			if (event.origpos != o.event.origpos) return event.origpos < o.event.origpos;
+			if (event.origsize != o.event.origsize) return event.origsize < o.event.origsize;
+			return seqno < o.seqno;
 		}
-		CATCH_ERROR_MAP( _TXT("error calling hyperscan lexer reset: %s"), *m_errorhnd);
-	}
-	
-	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+		uint32_t end() const
+		{
+			return event.origpos + event.origsize;
+		}
+	};
+
+	/// \brief Order of elements to find duplicates, events of the same pattern on the same position and level
+	struct DuplicateOrder
 	{
-		PatternLexerContext* THIS = (PatternLexerContext*)context;
-		try
+		const std::vector<Element>* ar;
+
+		explicit DuplicateOrder( const std::vector<Element>* ar_)
+			:ar(ar_){}
+		bool operator()( std::size_t aa, std::size_t bb) const
+		{
+			const Element& ea = (*ar)[ aa];
+			const Element& eb = (*ar)[ bb];
+			if (ea.event.id != eb.event.id) return ea.event.id < eb.event.id;
+			if (ea.event.level != eb.event.level) return ea.event.level < eb.event.level;
+			return ea.seqno < eb.seqno;
+		}
+	};
+
+	/// \brief Apply the superseding rules on a group of elements with the same origpos and append the remaining to the result
+	/// \note Rules: of the events of the same pattern on the same position and level only the last one reported is kept,
+	///	an event completely covered by an event with a higher level is removed
+	void sweepGroup( std::vector<MatchEvent>& res, std::size_t gi, std::size_t ge)
+	{
+		// Update the maximum end of the elements covering all levels lower with the elements of the group:
+		std::size_t ei = gi;
+		for (; ei != ge; ++ei)
 		{
-			if (THIS->m_data->patternTable.withOneByteCharMap())
+			const Element& elem = m_ar[ ei];
+			uint32_t coverEnd = elem.end() + 1;
+			unsigned int li = 0;
+			for (; li < elem.event.level; ++li)
 			{
-				from = THIS->m_charmap.posar[ from];
-				to = THIS->m_charmap.posar[ to];
+				if (m_coverEnd[ li] < coverEnd) m_coverEnd[ li] = coverEnd;
 			}
-			if (to - from >= std::numeric_limits<uint16_t>::max())
-			{
-				throw strus::runtime_error( "size of matched term out of range");
-			}
-			const PatternDef& patternDef = THIS->m_data->patternTable.patternDef( patternIdx);
-			if (patternDef.subexpref())
+		}
+		if (ge - gi == 1)
+		{
+			//... fast path for the most common case of a group with one element
+			appendElement( res, m_ar[ gi]);
+			return;
+		}
+		// Mark the duplicates, all but the last reported of the elements with the same pattern and level:
+		m_groupidxar.clear();
+		for (ei = gi; ei != ge; ++ei)
+		{
+			m_groupidxar.push_back( ei);
+		}
+		std::sort( m_groupidxar.begin(), m_groupidxar.end(), DuplicateOrder( &m_ar));
+		m_deleted.assign( ge - gi, false);
+		std::size_t di = 1, de = m_groupidxar.size();
+		for (; di != de; ++di)
+		{
+			const Element& prev = m_ar[ m_groupidxar[ di-1]];
+			const Element& elem = m_ar[ m_groupidxar[ di]];
+			if (prev.event.id == elem.event.id && prev.event.level == elem.event.level)
 			{
-				if (!THIS->m_data->patternTable.matchSubExpression( patternDef.subexpref(), THIS->m_src, from, to))
-				{
-					return 0;
-				}
+				m_deleted[ m_groupidxar[ di-1] - gi] = true;
 			}
-			unsigned int patternid = patternDef.id();
-			if (patternDef.symtabref())
+		}
+		for (ei = gi; ei != ge; ++ei)
+		{
+			if (!m_deleted[ ei - gi])
 			{
-				unsigned int symid = THIS->m_data->patternTable.symbolId( patternDef.symtabref(), THIS->m_src + from, (uint32_t)(to-from));
-				if (symid) patternid = symid;
+				appendElement( res, m_ar[ ei]);
 			}
-			MatchEvent matchEvent( patternDef.id(), patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from));
-			if (THIS->m_matchEventAr.empty())
+		}
+	}
+
+	void appendElement( std::vector<MatchEvent>& res, const Element& elem)
+	{
+		if (m_coverEnd[ elem.event.level] > elem.end())
+		{
+			//... the element is completely covered by an element with a higher level
+			return;
+		}
+		res.push_back( elem.event);
+		if (elem.symid)
+		{
+			res.push_back( MatchEvent( elem.symid, elem.event.level, elem.event.posbind, elem.event.origpos, elem.event.origsize));
+		}
+	}
+
+private:
+	std::vector<Element> m_ar;			///< events not yet fetched
+	std::size_t m_nofSorted;			///< number of elements at the start of m_ar sorted
+	uint32_t m_seqno;				///< counter for the sequence number of the elements
+	uint32_t m_coverEnd[ 256];			///< maximum end plus one of all elements fetched or in the current group with a level higher than the index
+	std::vector<std::size_t> m_groupidxar;		///< buffer for the indices of the elements of a group
+	std::vector<bool> m_deleted;			///< buffer for the marking of the deleted elements of a group
+};
+
+/// \brief Add a match event reported by hyperscan to a collection of match events
+/// \param[in,out] collector collection of match events
+/// \param[in] patternTable table with the pattern definitions
+/// \param[in] patternIdx index of the pattern matched
+/// \param[in] from start of the match in the source
+/// \param[in] to end of the match in the source
+/// \param[in] src pointer to the source
+/// \param[in] srcsize size of src in bytes
+/// \param[in] srcofs position of the first character of src in the source
+/// \param[in] mapped true if the match was found on the one byte character map of the source
+/// \note Matches longer than the maximum size of a lexem are dropped, the matches of the same pattern ending earlier are still collected
+static void collectMatchEvent( MatchEventCollector& collector, const PatternTable& patternTable, unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, const char* src, std::size_t srcsize, unsigned_long_long srcofs, bool mapped)
+{
+	if (to - from >= std::numeric_limits<uint16_t>::max())
+	{
+		//... a pattern without an upper bound for the size of its matches (e.g. [a-z]+) must not fail the whole document
+		return;
+	}
+	const PatternDef& patternDef = patternTable.patternDef( patternIdx);
+	unsigned int subexpref = mapped ? patternDef.mappedSubexpref() : patternDef.subexpref();
+	if (subexpref)
+	{
+		unsigned_long_long relfrom = from - srcofs;
+		unsigned_long_long relto = to - srcofs;
+		if (!patternTable.matchSubExpression( subexpref, src, srcsize, relfrom, relto))
+		{
+			return;
+		}
+		from = relfrom + srcofs;
+		to = relto + srcofs;
+	}
+	uint32_t symid = 0;
+	if (patternDef.symtabref())
+	{
+		symid = patternTable.symbolId( patternDef.symtabref(), src + (from - srcofs), (uint32_t)(to-from));
+		if (symid == patternDef.id()) symid = 0;
+	}
+	collector.push( MatchEvent( patternDef.id(), patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from)), symid);
+}
+
+/// \brief Calculation of the ordinal positions of lexems from the list of match events sorted by origpos
+/// \note Works incrementally, so that the match events do not have to be available all at once
+class LexemOrdinalPositionAssignment
+{
+public:
+	LexemOrdinalPositionAssignment()
+		:m_ordpos(0),m_origpos(0),m_lastposbind((uint8_t)analyzer::BindContent),m_pending(){}
+
+	/// \brief Assign the ordinal position to the next match event and append the resulting lexem to a list
+	/// \param[in,out] rt where to append the lexem to (std::vector or PatternLexemSink)
+	/// \param[in] ev match event with an origpos not smaller than the one of the previous event pushed
+	template <class LexemList>
+	void push( LexemList& rt, const MatchEvent& ev)
+	{
+		push( rt, ev, analyzer::Position( 0/*origseg*/, ev.origpos));
+	}
+
+	/// \brief Assign the ordinal position to the next match event and append the resulting lexem to a list
+	/// \param[in,out] rt where to append the lexem to (std::vector or PatternLexemSink)
+	/// \param[in] ev match event with an origpos not smaller than the one of the previous event pushed
+	/// \param[in] pos original position of the lexem to return
+	template <class LexemList>
+	void push( LexemList& rt, const MatchEvent& ev, const analyzer::Position& pos)
+	{
+		if (m_ordpos == 0)
+		{
+			//... we are still before the first content element
+			m_lastposbind = ev.posbind;
+			switch ((analyzer::PositionBind)ev.posbind)
 			{
-				THIS->m_matchEventAr.push_back( matchEvent);
-				if (patternid != patternDef.id())
-				{
-					THIS->m_matchEventAr.push_back( MatchEvent( patternid, patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from)));
-				}
+				case analyzer::BindUnique:
+				case analyzer::BindContent:
+					m_ordpos = 1;
+					m_origpos = ev.origpos;
+					flushPending( rt);
+					rt.push_back( analyzer::PatternLexem( ev.id, 1, pos, ev.origsize));
+					break;
+				case analyzer::BindSuccessor:
+					//... successors before the first content element are only part of the result if there exists a content element at all
+					m_pending.push_back( analyzer::PatternLexem( ev.id, 1, pos, ev.origsize));
+					break;
+				case analyzer::BindPredecessor:
+					break;
 			}
-			else
-			{
-				// Handle superseeding of elements by elements with higher level:
-				std::size_t nofDeletes = 0;
-				uint32_t matchLastPos = matchEvent.origpos + matchEvent.origsize;
-				std::vector<MatchEvent>::reverse_iterator
-					mi = THIS->m_matchEventAr.rbegin(),
-					me = THIS->m_matchEventAr.rend();
-				for (; mi != me && mi->origpos >= matchEvent.origpos; ++mi)
-				{
-					if ((matchEvent.id == mi->id && mi->origpos == matchEvent.origpos && mi->level == matchEvent.level)
-					|| (mi->level < matchEvent.level && mi->origpos + mi->origsize <= matchLastPos))
-					{
-						// ... an old element is overwritten because it is completely covered by one element with a higher level already in the list
-						std::vector<MatchEvent>::iterator oi = mi.base()-1;
-						std::vector<MatchEvent>::iterator prev_oi = oi++;
-						for (; oi != THIS->m_matchEventAr.end(); prev_oi = oi++)
-						{
-							*prev_oi = *oi;
-						}
-						++nofDeletes;
-					}
-				}
-				THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size()-nofDeletes);
-				if (!nofDeletes)
-				{
-					// ... if we had delete then there cannot exist an element covering the
-					//     new element. Otherwise deletes would have happened before
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					for (; mi != me && mi->origpos + mi->origsize >= matchLastPos; ++mi)
-					{
-						if (mi->level > matchEvent.level && mi->origpos <= matchEvent.origpos)
-						{
-							// ... the new element is ignored because it is completely covered by one element with a higher level already in the list
-							return 0;
-						}
-					}
-				}
-				// Insert the new element with ascending order of origpos
-				if (patternid == patternDef.id())
-				{
-					THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size() + 1);
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					std::vector<MatchEvent>::reverse_iterator prev_mi = mi;
-					for (++mi; mi != me && mi->origpos > matchEvent.origpos; prev_mi=mi++)
-					{
-						*prev_mi = *mi;
-					}
-					--mi;
-					*mi = matchEvent;
-				}
-				else
+			return;
+		}
+		switch ((analyzer::PositionBind)ev.posbind)
+		{
+			case analyzer::BindUnique:
+				if (m_lastposbind == (uint8_t)analyzer::BindUnique) break;
+			case analyzer::BindContent:
+				if (ev.origpos > m_origpos)
 				{
-					THIS->m_matchEventAr.resize( THIS->m_matchEventAr.size() + 2);
-					mi = THIS->m_matchEventAr.rbegin();
-					me = THIS->m_matchEventAr.rend();
-					std::vector<MatchEvent>::reverse_iterator prev_mi = mi;
-					for (mi+=2; mi != me && mi->origpos > matchEvent.origpos; prev_mi=mi++)
-					{
-						*prev_mi = *mi;
-					}
-					--mi;
-					*mi = matchEvent;
-					--mi;
-					*mi = MatchEvent( patternid, patternDef.level(), patternDef.posbind(), (uint32_t)from, (uint32_t)(to-from));
+					m_origpos = ev.origpos;
+					++m_ordpos;
 				}
+				rt.push_back( analyzer::PatternLexem( ev.id, m_ordpos, pos, ev.origsize));
+				break;
+			case analyzer::BindSuccessor:
+				rt.push_back( analyzer::PatternLexem( ev.id, m_ordpos+1, pos, ev.origsize));
+				break;
+			case analyzer::BindPredecessor:
+				rt.push_back( analyzer::PatternLexem( ev.id, m_ordpos, pos, ev.origsize));
+				break;
+		}
+		m_lastposbind = ev.posbind;
+	}
+
+	/// \brief Reset to the initial state
+	void clear()
+	{
+		m_ordpos = 0;
+		m_origpos = 0;
+		m_lastposbind = (uint8_t)analyzer::BindContent;
+		m_pending.clear();
+	}
+
+private:
+	template <class LexemList>
+	void flushPending( LexemList& rt)
+	{
+		std::vector<analyzer::PatternLexem>::const_iterator pi = m_pending.begin(), pe = m_pending.end();
+		for (; pi != pe; ++pi)
+		{
+			rt.push_back( *pi);
+		}
+		m_pending.clear();
+	}
+
+private:
+	uint32_t m_ordpos;					///< current ordinal position, 0 if no content element seen yet
+	uint32_t m_origpos;					///< origpos of the last content element
+	uint8_t m_lastposbind;					///< position bind of the last element
+	std::vector<analyzer::PatternLexem> m_pending;		///< successor elements preceding the first content element
+};
+
+class PatternLexerContext
+	:public PatternLexerContextInterface
+{
+public:
+	PatternLexerContext( const TermMatchData* data_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_data(data_),m_hs_scratch(0),m_src(0),m_srclen(0),m_matchEventCollector(),m_matchEventAr(),m_charmap(),m_charmapUsed(false)
+	{
+		if (m_data->patterndb || m_data->literaldb || m_data->approxdb)
+		{
+			//... no scratch space needed if all patterns are matched with the literal trie
+			m_hs_scratch = m_data->patternScratchPool.get( m_data->patterndb, m_data->literaldb, m_data->approxdb);
+		}
+	}
+
+	virtual ~PatternLexerContext()
+	{
+		m_data->patternScratchPool.put( m_hs_scratch);
+	}
+
+	virtual void reset()
+	{
+		// ... the scratch space is kept, it stays valid as long as the database does not change
+		m_src = 0;
+		m_srclen = 0;
+	}
+	
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerContext* THIS = (PatternLexerContext*)context;
+		try
+		{
+			collectMatchEvent( THIS->m_matchEventCollector, THIS->m_data->patternTable, patternIdx, from, to, THIS->m_src, THIS->m_srclen, 0, false/*mapped*/);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	/// \brief Match event handler for scanning the source mapped to the one byte character set
+	static int match_mapped_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerContext* THIS = (PatternLexerContext*)context;
+		try
+		{
+			if (THIS->m_charmapUsed)
+			{
+				from = THIS->m_charmap.origpos( from);
+				to = THIS->m_charmap.origpos( to);
 			}
+			collectMatchEvent( THIS->m_matchEventCollector, THIS->m_data->patternTable, patternIdx, from, to, THIS->m_src, THIS->m_srclen, 0, true/*mapped*/);
 			return 0;
 		}
 		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan match event handler: %s"), *THIS->m_errorhnd, -1);
@@ -860,102 +1690,449 @@ public:
 		try
 		{
 			std::vector<analyzer::PatternLexem> rt;
-			unsigned int nofExpectedTokens = srclen / 4 + 10;
-			m_matchEventAr.reserve( nofExpectedTokens);
-			m_src = src;
-			if (srclen >= (std::size_t)std::numeric_limits<uint32_t>::max())
+			scan( src, srclen);
+			rt.reserve( m_matchEventAr.size());
+			assignOrdinalPositions( rt);
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+	/// \brief Run the lexer on a source and pass the lexems detected directly to a sink instead of returning them as list
+	/// \note Throws on error
+	void match( const char* src, std::size_t srclen, PatternLexemSink& sink)
+	{
+		scan( src, srclen);
+		assignOrdinalPositions( sink);
+	}
+
+private:
+	/// \brief Collect all match events of a source in m_matchEventAr
+	void scan( const char* src, std::size_t srclen)
+	{
+		unsigned int nofExpectedTokens = srclen / 4 + 10;
+		m_matchEventCollector.reserve( nofExpectedTokens);
+		m_matchEventAr.reserve( nofExpectedTokens);
+		m_src = src;
+		m_srclen = srclen;
+		if (srclen >= (std::size_t)std::numeric_limits<uint32_t>::max())
+		{
+			throw strus::runtime_error( "size of string to scan out of range");
+		}
+		// Collect all matches calling the Hyperscan engine:
+		hs_error_t err = HS_SUCCESS;
+		if (m_data->patternTable.withOneByteCharMap())
+		{
+			std::size_t mappedlen;
+			const char* mapped = mapSource( src, srclen, mappedlen);
+			err = hs_scan( m_data->patterndb, mapped, mappedlen, 0/*reserved*/, m_hs_scratch, match_mapped_event_handler, this);
+		}
+		else
+		{
+			// ... the match events of all databases are collected together, the collector orders them by position
+			if (m_data->patterndb)
 			{
-				throw strus::runtime_error( "size of string to scan out of range");
+				err = hs_scan( m_data->patterndb, src, srclen, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
 			}
-			// Collect all matches calling the Hyperscan engine:
-			hs_error_t err;
-			if (m_data->patternTable.withOneByteCharMap())
+			if (err == HS_SUCCESS && m_data->literaldb)
 			{
-				m_charmap.init( src, srclen);
-				err = hs_scan( m_data->patterndb, m_charmap.value.c_str(), m_charmap.value.size(), 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				err = hs_scan( m_data->literaldb, src, srclen, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
 			}
-			else
+			if (err == HS_SUCCESS && !m_data->literalTrie.empty())
 			{
-				err = hs_scan( m_data->patterndb, src, srclen, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+				if (!m_data->literalTrie.scan( src, srclen, match_event_handler, this)) err = HS_SCAN_TERMINATED;
+			}
+			if (err == HS_SUCCESS && m_data->approxdb)
+			{
+				std::size_t mappedlen;
+				const char* mapped = mapSource( src, srclen, mappedlen);
+				err = hs_scan( m_data->approxdb, mapped, mappedlen, 0/*reserved*/, m_hs_scratch, match_mapped_event_handler, this);
+			}
+		}
+		m_src = 0;
+		m_srclen = 0;
+		if (err != HS_SUCCESS)
+		{
+			char srcbuf[ 128];
+			if (srclen > sizeof(srcbuf)-1) srclen = sizeof(srcbuf)-1;
+			std::memcpy( srcbuf, src, srclen);
+			srcbuf[ srclen] = 0;
+			m_matchEventCollector.clear();
+			m_matchEventAr.clear();
+			throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) on '%s'"), hsErrorName(err), srcbuf);
+		}
+		m_matchEventCollector.fetchAll( m_matchEventAr);
+	}
+
+	/// \brief Get the source mapped to the one byte character set for scanning
+	/// \note A source with ASCII characters only is mapped to itself, the character map is only built for sources with non ASCII characters
+	/// \remark This is only a shortcut for the ASCII prefix, the map is not restricted to candidate regions of the approximate patterns:
+	///	one non ASCII character near the start of a source makes the whole rest of the source decoded and mapped on every scan
+	const char* mapSource( const char* src, std::size_t srclen, std::size_t& mappedlen)
+	{
+		if (OneByteCharMap::asciiPrefixSize( src, srclen) == srclen)
+		{
+			m_charmapUsed = false;
+			mappedlen = srclen;
+			return src;
+		}
+		m_charmap.init( src, srclen);
+		m_charmapUsed = true;
+		mappedlen = m_charmap.value.size();
+		return m_charmap.value.c_str();
+	}
+
+	/// \brief Build the result terms from the match events collected, calculate ordinal positions of the result terms
+	template <class LexemList>
+	void assignOrdinalPositions( LexemList& rt)
+	{
+		LexemOrdinalPositionAssignment ordposAssignment;
+		std::vector<MatchEvent>::const_iterator
+			mi = m_matchEventAr.begin(), me = m_matchEventAr.end();
+		try
+		{
+			for (; mi != me; ++mi)
+			{
+				ordposAssignment.push( rt, *mi);
+			}
+		}
+		catch (...)
+		{
+			m_matchEventAr.clear();
+			throw;
+		}
+		m_matchEventAr.clear();
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const TermMatchData* m_data;
+	hs_scratch_t* m_hs_scratch;
+	const char* m_src;
+	std::size_t m_srclen;
+	MatchEventCollector m_matchEventCollector;
+	std::vector<MatchEvent> m_matchEventAr;
+	OneByteCharMap m_charmap;
+	bool m_charmapUsed;		///< true if the source scanned last is mapped with m_charmap, false if it is scanned as it is
+};
+
+class PatternLexerStreamContext
+	:public PatternLexerStreamContextInterface
+{
+public:
+	/// \brief Maximum size of a lexem, determines the size of the source window kept from preceding chunks
+	enum {MaxLexemSize=std::numeric_limits<uint16_t>::max()};
+
+	PatternLexerStreamContext( const TermMatchData* data_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_data(data_),m_hs_scratch(0),m_hs_stream(0)
+		,m_window(),m_windowpos(0),m_streampos(0),m_matchEventCollector(),m_matchEventAr(),m_ordposAssignment()
+	{
+		m_hs_scratch = m_data->streamScratchPool.get( m_data->streamdb);
+	}
+
+	virtual ~PatternLexerStreamContext()
+	{
+		if (m_hs_stream) hs_close_stream( m_hs_stream, m_hs_scratch, 0, 0);
+		m_data->streamScratchPool.put( m_hs_scratch);
+	}
+
+	virtual void reset()
+	{
+		try
+		{
+			if (m_hs_stream)
+			{
+				hs_error_t err = hs_reset_stream( m_hs_stream, 0/*reserved*/, m_hs_scratch, 0/*no match handler*/, 0);
+				if (err != HS_SUCCESS)
+				{
+					throw strus::runtime_error(_TXT("error resetting stream (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+				}
+			}
+			clear();
+		}
+		CATCH_ERROR_MAP( _TXT("error calling hyperscan stream lexer reset: %s"), *m_errorhnd);
+	}
+
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerStreamContext* THIS = (PatternLexerStreamContext*)context;
+		try
+		{
+			if (from < THIS->m_windowpos)
+			{
+				//... the match is longer than MaxLexemSize, dropped as in block mode (see collectMatchEvent)
+				return 0;
+			}
+			collectMatchEvent( THIS->m_matchEventCollector, THIS->m_data->patternTable, patternIdx, from, to, THIS->m_window.c_str(), THIS->m_window.size(), THIS->m_windowpos, false/*mapped*/);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan stream match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	virtual std::vector<analyzer::PatternLexem> putInput( const char* chunk, std::size_t chunksize)
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			if (m_streampos + chunksize >= (unsigned_long_long)std::numeric_limits<uint32_t>::max())
+			{
+				throw strus::runtime_error( "size of stream to scan out of range");
+			}
+			if (!m_hs_stream)
+			{
+				hs_error_t err = hs_open_stream( m_data->streamdb, 0/*reserved*/, &m_hs_stream);
+				if (err != HS_SUCCESS)
+				{
+					throw strus::runtime_error(_TXT("error opening stream (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+				}
 			}
-			m_src = 0;
+			m_window.append( chunk, chunksize);
+			hs_error_t err = hs_scan_stream( m_hs_stream, chunk, chunksize, 0/*reserved*/, m_hs_scratch, match_event_handler, this);
 			if (err != HS_SUCCESS)
 			{
-				char srcbuf[ 128];
-				if (srclen > sizeof(srcbuf)-1) srclen = sizeof(srcbuf)-1;
-				std::memcpy( srcbuf, src, srclen);
-				srcbuf[ srclen] = 0;
+				clear();
+				throw strus::runtime_error(_TXT("error matching pattern on stream (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+			}
+			m_streampos += chunksize;
+
+			// Matches not reported yet cannot start before the end of the stream minus the maximum lexem size,
+			// so events before are final and elements of the window before are not referenced anymore:
+			if (m_streampos > (unsigned_long_long)MaxLexemSize)
+			{
+				unsigned_long_long finalpos = m_streampos - MaxLexemSize;
+				m_matchEventCollector.fetch( m_matchEventAr, finalpos);
+				std::vector<MatchEvent>::const_iterator
+					mi = m_matchEventAr.begin(), me = m_matchEventAr.end();
+				for (; mi != me; ++mi)
+				{
+					m_ordposAssignment.push( rt, *mi);
+				}
 				m_matchEventAr.clear();
-				throw strus::runtime_error(_TXT("error matching pattern (hyperscan error %s) on '%s'"), hsErrorName(err), srcbuf);
+				if (finalpos > m_windowpos)
+				{
+					m_window.erase( 0, finalpos - m_windowpos);
+					m_windowpos = finalpos;
+				}
 			}
-			rt.reserve( m_matchEventAr.size());
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions on stream: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
 
-			// Build the result term array, calculate ordinal positions of the result terms:
+	virtual std::vector<analyzer::PatternLexem> close()
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			if (m_hs_stream)
+			{
+				//... matches anchored at the end of data are reported when closing the stream
+				hs_error_t err = hs_close_stream( m_hs_stream, m_hs_scratch, match_event_handler, this);
+				m_hs_stream = 0;
+				if (err != HS_SUCCESS)
+				{
+					clear();
+					throw strus::runtime_error(_TXT("error closing stream (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+				}
+			}
+			m_matchEventCollector.fetchAll( m_matchEventAr);
 			std::vector<MatchEvent>::const_iterator
 				mi = m_matchEventAr.begin(), me = m_matchEventAr.end();
-			uint32_t ordpos = 0;
-			uint32_t origpos = 0;
-			uint8_t lastposbind = (uint8_t)analyzer::BindContent;
 			for (; mi != me; ++mi)
 			{
-				lastposbind = mi->posbind;
-				switch ((analyzer::PositionBind)mi->posbind)
+				m_ordposAssignment.push( rt, *mi);
+			}
+			clear();
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to close pattern matching terms with regular expressions on stream: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+private:
+	void clear()
+	{
+		m_window.clear();
+		m_windowpos = 0;
+		m_streampos = 0;
+		m_matchEventCollector.clear();
+		m_matchEventAr.clear();
+		m_ordposAssignment.clear();
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const TermMatchData* m_data;
+	hs_scratch_t* m_hs_scratch;
+	hs_stream_t* m_hs_stream;
+	std::string m_window;					///< source of the last chunks not yet finally processed
+	unsigned_long_long m_windowpos;				///< position of the first byte of m_window in the stream
+	unsigned_long_long m_streampos;				///< number of bytes of the stream scanned
+	MatchEventCollector m_matchEventCollector;		///< match events not yet final
+	std::vector<MatchEvent> m_matchEventAr;			///< buffer for the match events final
+	LexemOrdinalPositionAssignment m_ordposAssignment;	///< state of the ordinal position calculation
+};
+
+class PatternLexerSegmentContext
+	:public PatternLexerSegmentContextInterface
+{
+public:
+	PatternLexerSegmentContext( const TermMatchData* data_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_data(data_),m_hs_scratch(0),m_segar(0),m_scanposar(),m_origposar(),m_matchEventCollector(),m_matchEventAr(),m_charmapar()
+	{
+		m_hs_scratch = m_data->vectorScratchPool.get( m_data->vectordb);
+	}
+
+	virtual ~PatternLexerSegmentContext()
+	{
+		m_data->vectorScratchPool.put( m_hs_scratch);
+	}
+
+	virtual void reset()
+	{
+		try
+		{
+			clear();
+		}
+		CATCH_ERROR_MAP( _TXT("error calling hyperscan segment lexer reset: %s"), *m_errorhnd);
+	}
+
+	static int match_event_handler( unsigned int patternIdx, unsigned_long_long from, unsigned_long_long to, unsigned int, void *context)
+	{
+		PatternLexerSegmentContext* THIS = (PatternLexerSegmentContext*)context;
+		try
+		{
+			// Find the segment of the match, matches spanning segment borders are dropped:
+			std::size_t segidx = std::upper_bound( THIS->m_scanposar.begin(), THIS->m_scanposar.end(), (uint32_t)from) - THIS->m_scanposar.begin() - 1;
+			const Segment& seg = THIS->m_segar[ segidx];
+			unsigned_long_long scanpos = THIS->m_scanposar[ segidx];
+			unsigned_long_long relfrom = from - scanpos;
+			unsigned_long_long relto = to - scanpos;
+			bool mapped = THIS->m_data->patternTable.withVectorOneByteCharMap();
+			if (mapped)
+			{
+				const OneByteCharMap& charmap = THIS->m_charmapar[ segidx];
+				if (relto > charmap.value.size()) return 0;
+				relfrom = charmap.origpos( relfrom);
+				relto = charmap.origpos( relto);
+			}
+			else if (relto > seg.srclen)
+			{
+				return 0;
+			}
+			unsigned_long_long origpos = THIS->m_origposar[ segidx];
+			collectMatchEvent( THIS->m_matchEventCollector, THIS->m_data->patternTable, patternIdx, origpos + relfrom, origpos + relto, seg.src, seg.srclen, origpos, mapped);
+			return 0;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("error calling hyperscan vectored match event handler: %s"), *THIS->m_errorhnd, -1);
+	}
+
+	virtual std::vector<analyzer::PatternLexem> matchSegments( const Segment* segar, std::size_t segarsize)
+	{
+		try
+		{
+			std::vector<analyzer::PatternLexem> rt;
+			if (segarsize == 0) return rt;
+			if (segarsize >= (std::size_t)std::numeric_limits<unsigned int>::max() / 2)
+			{
+				throw strus::runtime_error( "number of segments to scan out of range");
+			}
+			// Build the vector of blocks to scan with a separator between the segments:
+			static const char* separator = "\n";
+			std::vector<const char*> blockar;
+			std::vector<unsigned int> blocksizear;
+			blockar.reserve( 2*segarsize);
+			blocksizear.reserve( 2*segarsize);
+			m_scanposar.clear();
+			m_origposar.clear();
+			if (m_data->patternTable.withVectorOneByteCharMap() && m_charmapar.size() < segarsize)
+			{
+				m_charmapar.resize( segarsize);
+			}
+			unsigned_long_long scanpos = 0;
+			unsigned_long_long origpos = 0;
+			std::size_t si = 0;
+			for (; si != segarsize; ++si)
+			{
+				if (si)
+				{
+					blockar.push_back( separator);
+					blocksizear.push_back( 1);
+					++scanpos;
+					++origpos;
+				}
+				m_scanposar.push_back( scanpos);
+				m_origposar.push_back( origpos);
+				if (m_data->patternTable.withVectorOneByteCharMap())
+				{
+					OneByteCharMap& charmap = m_charmapar[ si];
+					charmap.init( segar[si].src, segar[si].srclen);
+					blockar.push_back( charmap.value.c_str());
+					blocksizear.push_back( charmap.value.size());
+					scanpos += charmap.value.size();
+				}
+				else
+				{
+					blockar.push_back( segar[si].src);
+					blocksizear.push_back( segar[si].srclen);
+					scanpos += segar[si].srclen;
+				}
+				origpos += segar[si].srclen;
+				if (origpos >= (unsigned_long_long)std::numeric_limits<uint32_t>::max())
 				{
-					case analyzer::BindUnique:
-					case analyzer::BindContent:
-						ordpos = 1;
-						origpos = mi->origpos;
-						rt.push_back( analyzer::PatternLexem( mi->id, 1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						++mi;
-						goto EXITLOOP;
-					case analyzer::BindSuccessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, 1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindPredecessor:
-						break;
+					throw strus::runtime_error( "size of segments to scan out of range");
 				}
 			}
-			EXITLOOP:
-			if (ordpos == 0)
+			m_matchEventCollector.reserve( origpos / 4 + 10);
+			m_matchEventAr.reserve( origpos / 4 + 10);
+			m_segar = segar;
+
+			// Collect all matches calling the Hyperscan engine:
+			hs_error_t err = hs_scan_vector( m_data->vectordb, &blockar[0], &blocksizear[0], blockar.size(), 0/*reserved*/, m_hs_scratch, match_event_handler, this);
+			m_segar = 0;
+			if (err != HS_SUCCESS)
 			{
-				rt.clear();
+				m_matchEventCollector.clear();
+				throw strus::runtime_error(_TXT("error matching pattern on segments (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
 			}
+			m_matchEventCollector.fetchAll( m_matchEventAr);
+			rt.reserve( m_matchEventAr.size());
+
+			// Build the result term array, calculate ordinal positions of the result terms and map the positions back to the segments:
+			LexemOrdinalPositionAssignment ordposAssignment;
+			std::size_t segidx = 0;
+			std::vector<MatchEvent>::const_iterator
+				mi = m_matchEventAr.begin(), me = m_matchEventAr.end();
 			for (; mi != me; ++mi)
 			{
-				switch ((analyzer::PositionBind)mi->posbind)
-				{
-					case analyzer::BindUnique:
-						if (lastposbind == (uint8_t)analyzer::BindUnique) break;
-					case analyzer::BindContent:
-						if (mi->origpos > origpos)
-						{
-							origpos = mi->origpos;
-							++ordpos;
-						}
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindSuccessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos+1, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-					case analyzer::BindPredecessor:
-						rt.push_back( analyzer::PatternLexem( mi->id, ordpos, analyzer::Position(0/*origseg*/, mi->origpos), mi->origsize));
-						break;
-				}
-				lastposbind = mi->posbind;
+				while (segidx+1 < segarsize && m_origposar[ segidx+1] <= mi->origpos) ++segidx;
+				ordposAssignment.push( rt, *mi, analyzer::Position( segar[ segidx].origseg, mi->origpos - m_origposar[ segidx]));
 			}
 			m_matchEventAr.clear();
 			return rt;
 		}
-		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run pattern matching terms with regular expressions on segments: %s"), *m_errorhnd, std::vector<analyzer::PatternLexem>());
+	}
+
+private:
+	void clear()
+	{
+		m_segar = 0;
+		m_scanposar.clear();
+		m_origposar.clear();
+		m_matchEventCollector.clear();
+		m_matchEventAr.clear();
 	}
 
 private:
 	ErrorBufferInterface* m_errorhnd;
 	const TermMatchData* m_data;
 	hs_scratch_t* m_hs_scratch;
-	const char* m_src;
+	const Segment* m_segar;				///< segments currently scanned
+	std::vector<uint32_t> m_scanposar;		///< start positions of the segments in the data scanned
+	std::vector<uint32_t> m_origposar;		///< start positions of the segments in the virtual concatenation of all segments
+	MatchEventCollector m_matchEventCollector;
 	std::vector<MatchEvent> m_matchEventAr;
-	OneByteCharMap m_charmap;
+	std::vector<OneByteCharMap> m_charmapar;	///< one byte character maps of the segments, if used
 };
 
 class PatternLexerInstance
@@ -963,7 +2140,7 @@ class PatternLexerInstance
 {
 public:
 	explicit PatternLexerInstance( ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_data(errorhnd_),m_state(DefinitionPhase),m_flags(0),m_idnamemap(),m_idnamestrings()
+		:m_errorhnd(errorhnd_),m_data(errorhnd_),m_state(DefinitionPhase),m_flags(0),m_streamMode(false),m_vectoredMode(false),m_platform(),m_idnamemap(),m_idnamestrings()
 	{}
 
 	virtual ~PatternLexerInstance(){}
@@ -1056,6 +2233,24 @@ public:
 			{
 				m_data.patternTable.forceOneByteCharMap();
 			}
+			else if (strus::caseInsensitiveEquals( name, "STREAM"))
+			{
+				m_streamMode = true;
+			}
+			else if (strus::caseInsensitiveEquals( name, "VECTORED"))
+			{
+				m_vectoredMode = true;
+			}
+			else if (strus::caseInsensitiveEquals( name, "HOST"))
+			{
+				hs_error_t err = hs_populate_platform( &m_platform);
+				if (err != HS_SUCCESS)
+				{
+					throw strus::runtime_error(_TXT("failed to get the platform of the host (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+				}
+			}
+			else if (definePlatformOption( name))
+			{}
 			else
 			{
 				throw strus::runtime_error(_TXT("unknown option '%s'"), name.c_str());
@@ -1069,47 +2264,92 @@ public:
 	{
 		try
 		{
+			m_data.clearScratchPools();
 			if (m_data.patterndb) hs_free_database( m_data.patterndb);
 			m_data.patterndb = 0;
+			if (m_data.literaldb) hs_free_database( m_data.literaldb);
+			m_data.literaldb = 0;
+			m_data.literalTrie.clear();
+			if (m_data.approxdb) hs_free_database( m_data.approxdb);
+			m_data.approxdb = 0;
+			if (m_data.streamdb) hs_free_database( m_data.streamdb);
+			m_data.streamdb = 0;
+			if (m_data.vectordb) hs_free_database( m_data.vectordb);
+			m_data.vectordb = 0;
 
 			HsPatternTable hspt;
-			m_data.patternTable.complete( hspt, m_flags);
-
-			hs_platform_info_t platform;
-			std::memset( &platform, 0, sizeof(platform));
-			platform.cpu_features = HS_TUNE_FAMILY_GENERIC;
-			hs_compile_error_t* compile_err = 0;
-
-			hs_error_t err =
-				hs_compile_ext_multi(
-					hspt.patternar, hspt.flagar, hspt.idar, hspt.extar, hspt.arsize, HS_MODE_BLOCK, &platform,
-					&m_data.patterndb, &compile_err);
-			if (err != HS_SUCCESS)
+			HsPatternTable approxhspt;
+			HsPatternTable vectorhspt;
+			//... the patterns with edit distance are only separated in block mode, in vectored mode all patterns are scanned on the one byte character map
+			m_data.patternTable.complete( hspt, approxhspt, m_vectoredMode ? &vectorhspt : 0, m_flags);
+			HsLiteralTable litt;
+			m_data.patternTable.completeLiterals( litt, m_flags);
+
+			if (m_streamMode && (m_data.patternTable.withOneByteCharMap() || m_data.patternTable.withApproxPatterns()))
+			{
+				throw std::runtime_error( _TXT("option STREAM cannot be used with patterns with an edit distance or option BYTECHAR"));
+			}
+			if (litt.empty())
 			{
-				if (compile_err)
+				if (hspt.arsize || !approxhspt.arsize)
 				{
-					const char* error_pattern = compile_err->expression < 0 ?0:hspt.patternar[ compile_err->expression];
-					if (error_pattern)
+					if (!compileDatabase( hspt, HS_MODE_BLOCK, &m_data.patterndb))
 					{
-						m_errorhnd->report(
-							hyperscanErrorCode( err),
-							_TXT( "failed to compile pattern \"%s\": %s\n"), error_pattern, compile_err->message);
+						return false;
 					}
-					else
+				}
+			}
+			else
+			{
+				//... the literal patterns are only separated in block mode, the databases for streaming and vectored mode contain all patterns
+#ifdef STRUS_HS_LITERAL_API
+				if (!compileLiteralDatabase( litt, HS_MODE_BLOCK, &m_data.literaldb))
+				{
+					return false;
+				}
+#else
+				std::size_t ti = 0, te = litt.literalar.size();
+				for (; ti != te; ++ti)
+				{
+					m_data.literalTrie.add( litt.literalar[ ti], litt.idar[ ti], 0!=(litt.flagar[ ti] & HS_FLAG_CASELESS));
+				}
+#endif
+				std::vector<bool> excluded( hspt.arsize + approxhspt.arsize, false);
+				std::vector<unsigned int>::const_iterator li = litt.idar.begin(), le = litt.idar.end();
+				for (; li != le; ++li)
+				{
+					excluded[ *li-1] = true;
+				}
+				HsPatternSelection selection( hspt, excluded);
+				if (!selection.patternar.empty())
+				{
+					if (!compileDatabase( &selection.patternar[0], &selection.flagar[0], &selection.idar[0], &selection.extar[0], selection.patternar.size(), HS_MODE_BLOCK, &m_data.patterndb))
 					{
-						m_errorhnd->report(
-							hyperscanErrorCode( err),
-							_TXT( "failed to build automaton from expressions: %s\n"), compile_err->message);
+						return false;
 					}
-					hs_free_compile_error( compile_err);
 				}
-				else
+			}
+			if (approxhspt.arsize)
+			{
+				if (!compileDatabase( approxhspt, HS_MODE_BLOCK, &m_data.approxdb))
 				{
-					m_errorhnd->report(
-						hyperscanErrorCode( err),
-						_TXT( "unknown errpr building automaton from expressions\n"));
+					return false;
+				}
+			}
+			if (m_streamMode)
+			{
+				//... the patterns are compiled with HS_FLAG_SOM_LEFTMOST that requires a SOM horizon in streaming mode
+				if (!compileDatabase( hspt, HS_MODE_STREAM | HS_MODE_SOM_HORIZON_LARGE, &m_data.streamdb))
+				{
+					return false;
+				}
+			}
+			if (m_vectoredMode)
+			{
+				if (!compileDatabase( vectorhspt, HS_MODE_VECTORED, &m_data.vectordb))
+				{
+					return false;
 				}
-				return false;
 			}
 			m_state = MatchPhase;
 			return true;
@@ -1130,30 +2370,350 @@ public:
 		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match context: %s"), *m_errorhnd, 0);
 	}
 
+	PatternLexerStreamContextInterface* createStreamContext() const
+	{
+		try
+		{
+			if (m_state != MatchPhase)
+			{
+				throw std::runtime_error( _TXT("called create stream context without calling 'compile'"));
+			}
+			if (!m_data.streamdb)
+			{
+				throw std::runtime_error( _TXT("called create stream context without option STREAM set"));
+			}
+			return new PatternLexerStreamContext( &m_data, m_errorhnd);
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match stream context: %s"), *m_errorhnd, 0);
+	}
+
+	PatternLexerSegmentContextInterface* createSegmentContext() const
+	{
+		try
+		{
+			if (m_state != MatchPhase)
+			{
+				throw std::runtime_error( _TXT("called create segment context without calling 'compile'"));
+			}
+			if (!m_data.vectordb)
+			{
+				throw std::runtime_error( _TXT("called create segment context without option VECTORED set"));
+			}
+			return new PatternLexerSegmentContext( &m_data, m_errorhnd);
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match segment context: %s"), *m_errorhnd, 0);
+	}
+
 	virtual analyzer::FunctionView view() const
 	{
 		return analyzer::FunctionView();
 	}
 
+	/// \brief Write the compiled lexer as image to a file
+	void storeImage( const std::string& filename) const
+	{
+		if (m_state != MatchPhase)
+		{
+			throw std::runtime_error( _TXT("called store image without calling 'compile'"));
+		}
+		ImageWriter out;
+		out.writeHeader( ImageMagic, ImageVersion);
+		out.write<uint32_t>( m_flags);
+		out.write<uint32_t>( m_streamMode ? 1:0);
+		out.write<uint32_t>( m_vectoredMode ? 1:0);
+		out.write<uint32_t>( m_platform.tune);
+		out.write<uint64_t>( m_platform.cpu_features);
+		out.write<uint64_t>( m_idnamemap.size());
+		std::map<unsigned int,std::size_t>::const_iterator ni = m_idnamemap.begin(), ne = m_idnamemap.end();
+		for (; ni != ne; ++ni)
+		{
+			out.write<uint32_t>( ni->first);
+			out.write<uint64_t>( ni->second);
+		}
+		out.writeString( m_idnamestrings);
+		m_data.patternTable.storeImage( out);
+		storeDatabase( out, m_data.patterndb);
+		storeDatabase( out, m_data.streamdb);
+		storeDatabase( out, m_data.vectordb);
+		storeDatabase( out, m_data.literaldb);
+		storeDatabase( out, m_data.approxdb);
+		m_data.literalTrie.storeImage( out);
+		writeImageFile( filename, out.content());
+	}
+
+	/// \brief Load the compiled lexer from an image file written with storeImage
+	void loadImage( const std::string& filename)
+	{
+		if (m_state != DefinitionPhase)
+		{
+			throw std::runtime_error( _TXT("called load image after calling 'compile'"));
+		}
+		MappedFile file;
+		file.open( filename);
+		ImageReader in( file.ptr(), file.size());
+		in.readHeader( ImageMagic, ImageVersion);
+		m_flags = in.read<uint32_t>();
+		m_streamMode = (0!=in.read<uint32_t>());
+		m_vectoredMode = (0!=in.read<uint32_t>());
+		m_platform.tune = in.read<uint32_t>();
+		m_platform.cpu_features = in.read<uint64_t>();
+		checkHostPlatform( m_platform);
+		std::size_t ni = 0, ne = in.read<uint64_t>();
+		for (; ni != ne; ++ni)
+		{
+			unsigned int id = in.read<uint32_t>();
+			m_idnamemap[ id] = in.read<uint64_t>();
+		}
+		m_idnamestrings = in.readString();
+		m_data.patternTable.loadImage( in);
+		m_data.patterndb = loadDatabase( in);
+		m_data.streamdb = loadDatabase( in);
+		m_data.vectordb = loadDatabase( in);
+		m_data.literaldb = loadDatabase( in);
+		m_data.approxdb = loadDatabase( in);
+		m_data.literalTrie.loadImage( in, m_data.patternTable.nofPatterns());
+		if ((!m_data.patterndb && !m_data.literaldb && !m_data.approxdb && m_data.literalTrie.empty()) || !in.eof())
+		{
+			throw std::runtime_error( _TXT("corrupt lexer image"));
+		}
+		m_state = MatchPhase;
+	}
+
+private:
+	static void storeDatabase( ImageWriter& out, const hs_database_t* db)
+	{
+		if (!db)
+		{
+			out.writeBlob( 0, 0);
+			return;
+		}
+		char* bytes = 0;
+		std::size_t length = 0;
+		hs_error_t err = hs_serialize_database( db, &bytes, &length);
+		if (err != HS_SUCCESS)
+		{
+			throw strus::runtime_error(_TXT("failed to serialize automaton (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+		}
+		try
+		{
+			out.writeBlob( bytes, length);
+		}
+		catch (...)
+		{
+			std::free( bytes);
+			throw;
+		}
+		std::free( bytes);
+	}
+
+	static hs_database_t* loadDatabase( ImageReader& in)
+	{
+		std::size_t length;
+		const char* bytes = (const char*)in.readBlob( length);
+		if (!length) return 0;
+		//... the hyperscan database has to be copied, because it is not position independent and has to be aligned
+		hs_database_t* rt = 0;
+		hs_error_t err = hs_deserialize_database( bytes, length, &rt);
+		if (err != HS_SUCCESS)
+		{
+			throw strus::runtime_error(_TXT("failed to load automaton from image (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+		}
+		return rt;
+	}
+
+public:
+	struct PlatformOptionDef
+	{
+		const char* name;
+		unsigned int tune;
+		unsigned long long cpu_features;
+	};
+
+	/// \brief Get the definitions of the options selecting a tuning family or adding a CPU feature to the target platform of the databases compiled
+	static const PlatformOptionDef* platformOptionDefs()
+	{
+		static const PlatformOptionDef ar[] = {
+			{"TUNE_GENERIC", HS_TUNE_FAMILY_GENERIC, 0},
+			{"TUNE_SNB", HS_TUNE_FAMILY_SNB, 0},
+			{"TUNE_IVB", HS_TUNE_FAMILY_IVB, 0},
+			{"TUNE_HSW", HS_TUNE_FAMILY_HSW, 0},
+			{"TUNE_SLM", HS_TUNE_FAMILY_SLM, 0},
+			{"TUNE_BDW", HS_TUNE_FAMILY_BDW, 0},
+			{"TUNE_SKL", HS_TUNE_FAMILY_SKL, 0},
+			{"TUNE_SKX", HS_TUNE_FAMILY_SKX, 0},
+			{"TUNE_GLM", HS_TUNE_FAMILY_GLM, 0},
+#ifdef HS_TUNE_FAMILY_ICL
+			{"TUNE_ICL", HS_TUNE_FAMILY_ICL, 0},
+#endif
+#ifdef HS_TUNE_FAMILY_ICX
+			{"TUNE_ICX", HS_TUNE_FAMILY_ICX, 0},
+#endif
+			{"AVX2", 0, HS_CPU_FEATURES_AVX2},
+			{"AVX512", 0, HS_CPU_FEATURES_AVX512},
+#ifdef HS_CPU_FEATURES_AVX512VBMI
+			{"AVX512VBMI", 0, HS_CPU_FEATURES_AVX512VBMI},
+#endif
+			{0, 0, 0}
+		};
+		return ar;
+	}
+
+private:
+	/// \brief Define a tuning family (TUNE_<family>) or add a CPU feature to the target platform of the databases compiled
+	/// \return false if the name is not a platform option
+	bool definePlatformOption( const std::string& name)
+	{
+		const PlatformOptionDef* ar = platformOptionDefs();
+		std::size_t ai = 0;
+		for (; ar[ ai].name; ++ai)
+		{
+			if (strus::caseInsensitiveEquals( name, ar[ ai].name))
+			{
+				if (ar[ ai].cpu_features)
+				{
+					m_platform.cpu_features |= ar[ ai].cpu_features;
+				}
+				else
+				{
+					m_platform.tune = ar[ ai].tune;
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/// \brief Check that the host supports the CPU features of the platform the databases of an image were compiled for
+	static void checkHostPlatform( const hs_platform_info_t& platform)
+	{
+		if (!platform.cpu_features) return;
+		hs_platform_info_t host;
+		hs_error_t err = hs_populate_platform( &host);
+		if (err != HS_SUCCESS)
+		{
+			throw strus::runtime_error(_TXT("failed to get the platform of the host (hyperscan error %s)"), PatternLexerContext::hsErrorName(err));
+		}
+		unsigned long long missing = platform.cpu_features & ~host.cpu_features;
+		if (missing)
+		{
+			std::string missingNames;
+			const PlatformOptionDef* ar = platformOptionDefs();
+			std::size_t ai = 0;
+			for (; ar[ ai].name; ++ai)
+			{
+				if (ar[ ai].cpu_features & missing)
+				{
+					if (!missingNames.empty()) missingNames.push_back(' ');
+					missingNames.append( ar[ ai].name);
+				}
+			}
+			throw strus::runtime_error(_TXT("lexer image compiled for CPU features not supported by this host (%s), the lexer has to be compiled again for this host or stored with a generic target"), missingNames.c_str());
+		}
+	}
+
+	bool compileDatabase( const HsPatternTable& hspt, unsigned int mode, hs_database_t** db)
+	{
+		return compileDatabase( hspt.patternar, hspt.flagar, hspt.idar, hspt.extar, hspt.arsize, mode, db);
+	}
+
+	bool compileLiteralDatabase( const HsLiteralTable& litt, unsigned int mode, hs_database_t** db)
+	{
+#ifdef STRUS_HS_LITERAL_API
+		std::vector<const char*> literalar;
+		std::vector<std::size_t> lenar;
+		std::vector<std::string>::const_iterator li = litt.literalar.begin(), le = litt.literalar.end();
+		for (; li != le; ++li)
+		{
+			literalar.push_back( li->c_str());
+			lenar.push_back( li->size());
+		}
+		hs_compile_error_t* compile_err = 0;
+		hs_error_t err =
+			hs_compile_lit_multi(
+				&literalar[0], &litt.flagar[0], &litt.idar[0], &lenar[0], literalar.size(), mode, &m_platform,
+				db, &compile_err);
+		return checkCompileResult( err, compile_err, &literalar[0]);
+#else
+		throw std::runtime_error( _TXT("literal databases are not supported by this version of hyperscan"));
+#endif
+	}
+
+	bool compileDatabase( const char* const* patternar, const unsigned int* flagar, const unsigned int* idar, const hs_expr_ext_t* const* extar, std::size_t arsize, unsigned int mode, hs_database_t** db)
+	{
+		hs_compile_error_t* compile_err = 0;
+
+		hs_error_t err =
+			hs_compile_ext_multi(
+				patternar, flagar, idar, extar, arsize, mode, &m_platform,
+				db, &compile_err);
+		return checkCompileResult( err, compile_err, patternar);
+	}
+
+	bool checkCompileResult( hs_error_t err, hs_compile_error_t* compile_err, const char* const* patternar)
+	{
+		if (err != HS_SUCCESS)
+		{
+			if (compile_err)
+			{
+				const char* error_pattern = compile_err->expression < 0 ?0:patternar[ compile_err->expression];
+				if (error_pattern)
+				{
+					m_errorhnd->report(
+						hyperscanErrorCode( err),
+						_TXT( "failed to compile pattern \"%s\": %s\n"), error_pattern, compile_err->message);
+				}
+				else
+				{
+					m_errorhnd->report(
+						hyperscanErrorCode( err),
+						_TXT( "failed to build automaton from expressions: %s\n"), compile_err->message);
+				}
+				hs_free_compile_error( compile_err);
+			}
+			else
+			{
+				m_errorhnd->report(
+					hyperscanErrorCode( err),
+					_TXT( "unknown errpr building automaton from expressions\n"));
+			}
+			return false;
+		}
+		return true;
+	}
+
 private:
+	static const char* ImageMagic;
+	enum {ImageVersion=8};
+
 	ErrorBufferInterface* m_errorhnd;
 	TermMatchData m_data;
 	enum State {DefinitionPhase,MatchPhase};
 	State m_state;
 	unsigned int m_flags;
+	bool m_streamMode;
+	bool m_vectoredMode;
+	hs_platform_info_t m_platform;				///< target platform of the databases compiled, generic if not defined with the options HOST, TUNE_<family> or a CPU feature
 	std::map<unsigned int,std::size_t> m_idnamemap;
 	std::string m_idnamestrings;
 };
 
+const char* PatternLexerInstance::ImageMagic = "strus lexer";
+
 
 std::vector<std::string> PatternLexer::getCompileOptionNames() const
 {
 	std::vector<std::string> rt;
-	static const char* ar[] = {"CASELESS", "DOTALL", "MULTILINE", "ALLOWEMPTY", "UCP", 0};
+	static const char* ar[] = {"CASELESS", "DOTALL", "MULTILINE", "ALLOWEMPTY", "UCP", "STREAM", "VECTORED", "HOST", 0};
 	for (std::size_t ai=0; ar[ai]; ++ai)
 	{
 		rt.push_back( ar[ ai]);
 	}
+	// ... the platform options are taken from their definitions, so that the list contains the ones supported by the hyperscan version used
+	const PatternLexerInstance::PlatformOptionDef* pdef = PatternLexerInstance::platformOptionDefs();
+	for (std::size_t pi=0; pdef[pi].name; ++pi)
+	{
+		rt.push_back( pdef[ pi].name);
+	}
 	return rt;
 }
 
@@ -1166,6 +2726,78 @@ PatternLexerInstanceInterface* PatternLexer::createInstance() const
 	CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match instance: %s"), *m_errorhnd, 0);
 }
 
+PatternLexerStreamContextInterface* strus::createPatternLexerStreamContext( const PatternLexerInstanceInterface* instance, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		const PatternLexerInstance* lexer = dynamic_cast<const PatternLexerInstance*>( instance);
+		if (!lexer)
+		{
+			throw std::runtime_error( _TXT("lexer instance passed is not an instance of the standard pattern lexer"));
+		}
+		return lexer->createStreamContext();
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match stream context: %s"), *errorhnd, 0);
+}
+
+PatternLexerSegmentContextInterface* strus::createPatternLexerSegmentContext( const PatternLexerInstanceInterface* instance, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		const PatternLexerInstance* lexer = dynamic_cast<const PatternLexerInstance*>( instance);
+		if (!lexer)
+		{
+			throw std::runtime_error( _TXT("lexer instance passed is not an instance of the standard pattern lexer"));
+		}
+		return lexer->createSegmentContext();
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to create term match segment context: %s"), *errorhnd, 0);
+}
+
+void strus::matchPatternLexerContext( PatternLexerContextInterface* context, const char* src, std::size_t srclen, PatternLexemSink& sink)
+{
+	PatternLexerContext* lexer = dynamic_cast<PatternLexerContext*>( context);
+	if (!lexer)
+	{
+		throw std::runtime_error( _TXT("lexer context passed is not a context of the standard pattern lexer"));
+	}
+	lexer->match( src, srclen, sink);
+}
+
+bool strus::storePatternLexerImage( const PatternLexerInstanceInterface* instance, const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		const PatternLexerInstance* lexer = dynamic_cast<const PatternLexerInstance*>( instance);
+		if (!lexer)
+		{
+			throw std::runtime_error( _TXT("lexer instance passed is not an instance of the standard pattern lexer"));
+		}
+		lexer->storeImage( filename);
+		return true;
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to store lexer image: %s"), *errorhnd, false);
+}
+
+PatternLexerInstanceInterface* strus::loadPatternLexerImage( const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		PatternLexerInstance* rt = new PatternLexerInstance( errorhnd);
+		try
+		{
+			rt->loadImage( filename);
+		}
+		catch (...)
+		{
+			delete rt;
+			throw;
+		}
+		return rt;
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to load lexer image: %s"), *errorhnd, 0);
+}
+
 const char* PatternLexer::getDescription() const
 {
 	return _TXT( "pattern lexer based the Intel hyperscan library");
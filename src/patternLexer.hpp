@@ -10,11 +10,23 @@
 #ifndef _STRUS_PATTERN_PATTERN_LEXER_IMPLEMENTATION_HPP_INCLUDED
 #define _STRUS_PATTERN_PATTERN_LEXER_IMPLEMENTATION_HPP_INCLUDED
 #include "strus/patternLexerInterface.hpp"
+#include <string>
+#include <cstddef>
 
 namespace strus {
 
 ///\brief Forward declaration
 class ErrorBufferInterface;
+///\brief Forward declaration
+class PatternLexerInstanceInterface;
+///\brief Forward declaration
+class PatternLexerStreamContextInterface;
+///\brief Forward declaration
+class PatternLexerSegmentContextInterface;
+///\brief Forward declaration
+class PatternLexerContextInterface;
+///\brief Forward declaration
+class PatternLexemSink;
 
 /// \brief Object for creating an automaton for detecting tokens defined as regular expressions in text
 /// \note Based on the Intel hyperscan library as backend.
@@ -36,6 +48,37 @@ private:
 	ErrorBufferInterface* m_errorhnd;
 };
 
+/// \brief Create a context for lexing a source passed chunk by chunk
+/// \param[in] instance lexer instance created by PatternLexer compiled with option STREAM
+/// \param[in] errorhnd error buffer interface for reporting errors
+PatternLexerStreamContextInterface* createPatternLexerStreamContext( const PatternLexerInstanceInterface* instance, ErrorBufferInterface* errorhnd);
+
+/// \brief Create a context for lexing all segments of a document with one call
+/// \param[in] instance lexer instance created by PatternLexer compiled with option VECTORED
+/// \param[in] errorhnd error buffer interface for reporting errors
+PatternLexerSegmentContextInterface* createPatternLexerSegmentContext( const PatternLexerInstanceInterface* instance, ErrorBufferInterface* errorhnd);
+
+/// \brief Run a lexer context on a source and pass the lexems detected directly to a sink without building a list of lexems
+/// \param[in] context lexer context created by an instance of PatternLexer
+/// \param[in] src pointer to source to scan
+/// \param[in] srclen length of src in bytes
+/// \param[in,out] sink where to pass the lexems detected to in ascending order of their ordinal position
+/// \note Throws on error
+void matchPatternLexerContext( PatternLexerContextInterface* context, const char* src, std::size_t srclen, PatternLexemSink& sink);
+
+/// \brief Write the compiled state of a lexer instance as image to a file
+/// \param[in] instance compiled lexer instance created by PatternLexer
+/// \param[in] filename path of the file to write
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return true on success, false on error
+bool storePatternLexerImage( const PatternLexerInstanceInterface* instance, const std::string& filename, ErrorBufferInterface* errorhnd);
+
+/// \brief Create a compiled lexer instance from an image file written with storePatternLexerImage
+/// \param[in] filename path of the file to load
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return the lexer instance ready for creating contexts
+PatternLexerInstanceInterface* loadPatternLexerImage( const std::string& filename, ErrorBufferInterface* errorhnd);
+
 }//namespace
 #endif
 
@@ -8,19 +8,29 @@
 /// \brief Implementation of an automaton for detecting patterns of tokens in a document stream
 /// \file "patternMatcher.cpp"
 #include "patternMatcher.hpp"
+#include "patternLexer.hpp"
+#include "patternLexemSink.hpp"
 #include "errorUtils.hpp"
 #include "internationalization.hpp"
 #include "strus/analyzer/patternMatcherResultItem.hpp"
 #include "strus/analyzer/patternMatcherResult.hpp"
 #include "strus/patternMatcherInstanceInterface.hpp"
 #include "strus/patternMatcherContextInterface.hpp"
+#include "strus/patternMatcherBatchInputInterface.hpp"
+#include "strus/patternMatcherResumeInterface.hpp"
+#include "strus/patternMatcherCheckpointInterface.hpp"
+#include "strus/patternLexerMatcherContextInterface.hpp"
+#include "strus/patternLexerInstanceInterface.hpp"
+#include "strus/patternLexerContextInterface.hpp"
 #include "strus/errorBufferInterface.hpp"
 #include "strus/debugTraceInterface.hpp"
 #include "strus/base/symbolTable.hpp"
 #include "strus/base/string_conv.hpp"
+#include "strus/base/thread.hpp"
 #include "strus/reference.hpp"
 #include "strus/lib/pattern_resultformat.hpp"
 #include "ruleMatcherAutomaton.hpp"
+#include "serialization.hpp"
 #include <map>
 #include <limits>
 #include <vector>
@@ -64,27 +74,115 @@ public:
 };
 
 
+/// \brief Read only map of symbol identifiers to names, referencing the strings in a mapped image
+class ImageNameTable
+{
+public:
+	ImageNameTable()
+		:m_offsetar(0),m_size(0),m_strings(0),m_stringssize(0),m_defined(false){}
+
+	/// \brief Write the names of a symbol table in the order of their identifiers to an image
+	static void storeImage( ImageWriter& out, const SymbolTable& symtab)
+	{
+		std::vector<uint64_t> offsetar;
+		std::string strings;
+		std::size_t si = 0, se = symtab.size();
+		offsetar.reserve( se);
+		for (; si != se; ++si)
+		{
+			offsetar.push_back( strings.size());
+			strings.append( symtab.key( si+1));
+			strings.push_back( '\0');
+		}
+		out.writeArray( offsetar.empty() ? (const uint64_t*)0 : &offsetar[0], offsetar.size());
+		out.writeBlob( strings.c_str(), strings.size());
+	}
+
+	/// \brief Reference the names in an image written with storeImage
+	void loadImage( ImageReader& in)
+	{
+		m_offsetar = in.readArray<uint64_t>( m_size);
+		m_strings = (const char*)in.readBlob( m_stringssize);
+		if (m_size && (m_stringssize == 0 || m_strings[ m_stringssize-1] != '\0'))
+		{
+			throw std::runtime_error( _TXT("corrupt name table in pattern matcher image"));
+		}
+		std::size_t si = 0, se = m_size;
+		for (; si != se; ++si)
+		{
+			if (m_offsetar[ si] >= m_stringssize)
+			{
+				throw std::runtime_error( _TXT("corrupt name table in pattern matcher image"));
+			}
+		}
+		m_defined = true;
+	}
+
+	bool defined() const
+	{
+		return m_defined;
+	}
+
+	std::size_t size() const
+	{
+		return m_size;
+	}
+
+	const char* key( uint32_t id) const
+	{
+		if (id == 0 || id > m_size) return 0;
+		return m_strings + m_offsetar[ id-1];
+	}
+
+private:
+	const uint64_t* m_offsetar;
+	std::size_t m_size;
+	const char* m_strings;
+	std::size_t m_stringssize;
+	bool m_defined;
+};
+
 struct PatternMatcherData
 {
 	explicit PatternMatcherData( ErrorBufferInterface* errorhnd)
-		:variableMap(errorhnd)
+		:image()
+		,variableMap(errorhnd)
 		,patternMap(errorhnd)
+		,patternNameTable()
 		,programTable()
 		,resultFormatTable(0)
 		,resultFormatHandles()
+		,resultFormatStrings()
 		,exclusive(false)
 		,maxResultSize(100)
+		,triggerHashIndex(false)
+		,resetTrimSize(0)
+		,nofShards(0)
+		,shards()
 	{
 		resultFormatTable = new PatternResultFormatTable( &variableMap, errorhnd);
 	}
 
+	/// \brief Get the name of a pattern by its handle
+	const char* patternName( uint32_t id) const
+	{
+		return patternNameTable.defined() ? patternNameTable.key( id) : patternMap.key( id);
+	}
+
+	MappedFile image;					///< image the data is loaded from, referenced by the program table and the pattern names
 	VariableMap variableMap;
 	SymbolTable patternMap;
+	ImageNameTable patternNameTable;			///< pattern names if the data is loaded from an image
 	ProgramTable programTable;
 	PatternResultFormatTable* resultFormatTable;
 	std::vector<const PatternResultFormat*> resultFormatHandles;
+	std::vector<std::string> resultFormatStrings;		///< source of the result formats for storing them in an image
 	bool exclusive;
 	unsigned int maxResultSize;
+	bool triggerHashIndex;					///< true, if the triggers of a context are indexed by event with a hash table instead of a fixed number of buckets
+	unsigned int resetTrimSize;				///< maximum number of elements per pool of a context kept allocated on reset, 0 for keeping all memory allocated
+	unsigned int nofShards;					///< maximum number of shards the programs are partitioned into for matching a document in parallel, 0 or 1 for no partitioning
+	std::vector<ProgramTableShard> shards;			///< partition of the programs, empty if a context matches with all programs in one state machine
 
 private:
 #if __cplusplus >= 201103L
@@ -102,12 +200,133 @@ static uint32_t eventHandle( PatternEventType type_, uint32_t idx)
 	if (idx >= (1<<29)) throw strus::runtime_error( "%s",  _TXT("event handle out of range"));
 	return idx | ((uint32_t)type_ << 29);
 }
+/// \brief Mask of the event handle bits marking events issued by programs (ExpressionEvent,ReferenceEvent)
+static const uint32_t DerivedEventMask = (uint32_t)3 << 29;
+
+static void checkInputTerm( const analyzer::PatternLexem& term)
+{
+	if (term.origsize() >= std::numeric_limits<int32_t>::max())
+	{
+		throw std::runtime_error( _TXT("term event orig size out of range"));
+	}
+	if (term.origpos().seg() >= std::numeric_limits<int32_t>::max())
+	{
+		throw std::runtime_error( _TXT("term event orig segment number out of range"));
+	}
+	if (term.origpos().ofs() >= std::numeric_limits<int32_t>::max())
+	{
+		throw std::runtime_error( _TXT("term event orig segment byte position out of range"));
+	}
+	eventHandle( TermEvent, term.id());
+}
+
+static uint64_t positionKey( uint32_t origseg, uint32_t origpos)
+{
+	return ((uint64_t)origseg << 32) | origpos;
+}
+
+/// \brief Order of results for the elimination of covered results: ascending by start and descending by end position
+struct CoverOrder
+{
+	const std::vector<const Result*>* results;
+
+	explicit CoverOrder( const std::vector<const Result*>* results_)
+		:results(results_){}
+	bool operator()( std::size_t aa, std::size_t bb) const
+	{
+		const Result& ra = *(*results)[ aa];
+		const Result& rb = *(*results)[ bb];
+		uint64_t startA = positionKey( ra.start_origseg, ra.start_origpos);
+		uint64_t startB = positionKey( rb.start_origseg, rb.start_origpos);
+		if (startA != startB) return startA < startB;
+		uint64_t endA = positionKey( ra.end_origseg, ra.end_origpos);
+		uint64_t endB = positionKey( rb.end_origseg, rb.end_origpos);
+		if (endA != endB) return endA > endB;
+		return aa < bb;
+	}
+};
+
+/// \brief Get the flags marking the results covered by another result with a different start or end position
+/// \note Positions are compared as pairs (origseg,origpos). The results are sorted by start ascending and end descending,
+///	so that all results possibly covering a result precede it. A result is covered, if the maximum end of the results
+///	preceding the group of results with its span is not smaller than its end.
+static std::vector<bool> getCoveredFlags( const std::vector<const Result*>& results)
+{
+	std::vector<bool> rt( results.size(), false);
+	std::vector<std::size_t> order;
+	order.reserve( results.size());
+	std::size_t ai = 0, ae = results.size();
+	for (; ai != ae; ++ai)
+	{
+		order.push_back( ai);
+	}
+	std::sort( order.begin(), order.end(), CoverOrder( &results));
+
+	bool hasMaxEnd = false;
+	uint64_t maxEnd = 0;
+	std::size_t oi = 0, oe = order.size();
+	while (oi != oe)
+	{
+		const Result& result = *results[ order[ oi]];
+		uint64_t start = positionKey( result.start_origseg, result.start_origpos);
+		uint64_t end = positionKey( result.end_origseg, result.end_origpos);
+		std::size_t on = oi+1;
+		for (; on != oe; ++on)
+		{
+			const Result& next = *results[ order[ on]];
+			if (start != positionKey( next.start_origseg, next.start_origpos)
+			||  end != positionKey( next.end_origseg, next.end_origpos)) break;
+		}
+		if (hasMaxEnd && maxEnd >= end)
+		{
+			// ... the results of the group are covered by a preceding result starting before or ending after them
+			for (; oi != on; ++oi)
+			{
+				rt[ order[ oi]] = true;
+			}
+		}
+		else
+		{
+			maxEnd = end;
+			hasMaxEnd = true;
+		}
+		oi = on;
+	}
+	return rt;
+}
+
+/// \brief Snapshot of the state of a pattern matcher context
+class PatternMatcherCheckpoint
+	:public PatternMatcherCheckpointInterface
+{
+public:
+	PatternMatcherCheckpoint( const PatternMatcherData* data_, const StateMachine& statemachine_, unsigned int nofEvents_, int curPosition_)
+		:m_data(data_),m_statemachine(statemachine_,0/*debugtrace*/),m_nofEvents(nofEvents_),m_curPosition(curPosition_){}
+	virtual ~PatternMatcherCheckpoint(){}
+
+	virtual int position() const
+	{
+		return m_curPosition;
+	}
+
+	const PatternMatcherData* data() const		{return m_data;}
+	const StateMachine& statemachine() const	{return m_statemachine;}
+	unsigned int nofEvents() const			{return m_nofEvents;}
+
+private:
+	const PatternMatcherData* m_data;
+	StateMachine m_statemachine;
+	unsigned int m_nofEvents;
+	int m_curPosition;
+};
 
 class PatternMatcherContext
 	:public PatternMatcherContextInterface
+	,public PatternMatcherBatchInputInterface
+	,public PatternMatcherResumeInterface
 {
 public:
-	PatternMatcherContext( const PatternMatcherData* data_, ErrorBufferInterface* errorhnd_)
+	PatternMatcherContext( const PatternMatcherData* data_, ErrorBufferInterface* errorhnd_, const ProgramTableShard* shard_=0)
 		:m_errorhnd(errorhnd_)
 		,m_debugtrace(0)
 		,m_data(data_)
@@ -118,7 +337,7 @@ public:
 	{
 		DebugTraceInterface* dbgi = m_errorhnd->debugTrace();
 		if (dbgi) m_debugtrace = dbgi->createTraceContext( STRUS_DBGTRACE_COMPONENT_NAME);
-		m_statemachine = new StateMachine( &data_->programTable, m_debugtrace);
+		m_statemachine = new StateMachine( &data_->programTable, data_->triggerHashIndex, m_debugtrace, shard_);
 	}
 
 	virtual ~PatternMatcherContext()
@@ -160,6 +379,47 @@ public:
 		CATCH_ERROR_MAP( _TXT("failed to feed input to pattern matcher: %s"), *m_errorhnd);
 	}
 
+	virtual void putInputBatch( const analyzer::PatternLexem* ar, std::size_t arsize)
+	{
+		try
+		{
+			DEBUG_EVENT2( "input", "batch size=%u ordpos=%u", (unsigned int)arsize, arsize ? (unsigned int)ar[0].ordpos() : 0U)
+			// Validate the batch once before processing it:
+			int pos = m_curPosition;
+			std::size_t ai = 0;
+			for (; ai != arsize; ++ai)
+			{
+				const analyzer::PatternLexem& term = ar[ ai];
+				if (pos > term.ordpos())
+				{
+					throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), pos, term.ordpos());
+				}
+				checkInputTerm( term);
+				pos = term.ordpos();
+			}
+			// Process all transitions with the buffers for the state machine allocated once:
+			StateMachine::TransitionBuffers buffers;
+			for (ai = 0; ai != arsize; ++ai)
+			{
+				doTermTransition( ar[ ai], buffers);
+			}
+		}
+		CATCH_ERROR_MAP( _TXT("failed to feed input batch to pattern matcher: %s"), *m_errorhnd);
+	}
+
+	/// \brief Feed the next input term with the buffers for the state machine passed by the caller
+	/// \note Throws on error, used for feeding lexems directly from a lexer
+	void putInput( const analyzer::PatternLexem& term, StateMachine::TransitionBuffers& buffers)
+	{
+		if (m_curPosition > term.ordpos())
+		{
+			throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), m_curPosition, term.ordpos());
+		}
+		checkInputTerm( term);
+		doTermTransition( term, buffers);
+	}
+
+
 	void gatherResultItems( std::vector<PatternMatcherResultItem>& resitemlist, uint32_t dataref)
 	{
 		uint32_t itemList = m_statemachine->getEventDataItemListIdx( dataref);
@@ -188,65 +448,9 @@ public:
 		}
 	}
 
-	std::vector<bool> getCoveredFlags( const StateMachine::ResultList& results) const
-	{
-		std::vector<bool> rt( results.size(), false);
-		std::size_t ai = 0, ae = results.size();
-		for (; ai != ae; ++ai)
-		{
-			const Result& result = results[ ai];
-			std::size_t ni = ai;
-			for (; ni != ae; ++ni)
-			{
-				const Result& follow_result = results[ ni];
-				if (follow_result.start_origseg > result.end_origseg
-				||  follow_result.start_origpos >= result.end_origpos + m_data->maxResultSize)
-				{
-					// ... follow_result is not overlapping with end 
-					// of the result plus a maximum result length distance,
-					// so there are no more left to check for result.
-					break;
-				}
-				if (follow_result.start_origseg <= result.start_origseg
-				&&  follow_result.start_origpos <= result.start_origpos
-				&&  follow_result.end_origseg >= result.end_origseg
-				&&  follow_result.end_origpos >= result.end_origpos)
-				{
-					// ... result is covered by follow_result
-					if (follow_result.end_origseg != result.end_origseg
-					||  follow_result.end_origpos != result.end_origpos
-					||  follow_result.start_origseg != result.start_origseg
-					||  follow_result.start_origpos != result.start_origpos)
-					{
-						// ... and not equal, so result is 
-						// marked to be eliminated
-						rt[ ai] = true;
-					}
-				}
-				if (follow_result.start_origseg >= result.start_origseg
-				&&  follow_result.start_origpos >= result.start_origpos
-				&&  follow_result.end_origseg <= result.end_origseg
-				&&  follow_result.end_origpos <= result.end_origpos)
-				{
-					// ... follow_result is covered by result
-					if (follow_result.end_origseg != result.end_origseg
-					||  follow_result.end_origpos != result.end_origpos
-					||  follow_result.start_origseg != result.start_origseg
-					||  follow_result.start_origpos != result.start_origpos)
-					{
-						// ... and not equal, so follow_result is 
-						// marked to be eliminated
-						rt[ ni] = true;
-					}
-				}
-			}
-		}
-		return rt;
-	}
-
 	void pushResult( std::vector<analyzer::PatternMatcherResult>& res, const Result& result)
 	{
-		const char* resultName = m_data->patternMap.key( result.resultHandle);
+		const char* resultName = m_data->patternName( result.resultHandle);
 		std::vector<PatternMatcherResultItem> rtitemlist;
 		const char* resultValue = 0;
 		if (result.formatHandle)
@@ -276,7 +480,14 @@ public:
 			rt.reserve( results.size());
 			if (m_data->exclusive)
 			{
-				std::vector<bool> eliminate( getCoveredFlags( results));
+				std::vector<const Result*> resultrefs;
+				resultrefs.reserve( results.size());
+				std::size_t ri = 0, re = results.size();
+				for (; ri != re; ++ri)
+				{
+					resultrefs.push_back( &results[ ri]);
+				}
+				std::vector<bool> eliminate( getCoveredFlags( resultrefs));
 				std::size_t ai = 0, ae = results.size();
 				for (; ai != ae; ++ai)
 				{
@@ -320,15 +531,61 @@ public:
 	{
 		try
 		{
-			StateMachine* new_statemachine = new StateMachine( &m_data->programTable, m_debugtrace);
-			delete m_statemachine;
-			m_statemachine = new_statemachine;
+			m_statemachine->reset( m_data->resetTrimSize);
 			m_nofEvents = 0;
 			m_curPosition = 0;
 		}
 		CATCH_ERROR_MAP( _TXT("failed to get reset pattern matcher context: %s"), *m_errorhnd);
 	}
 
+	/// \brief Release the memory of the values of all results fetched, they are not reset with the state machine (reset)
+	void resetResultValues()
+	{
+		m_resultFormatContext.reset();
+	}
+
+	virtual PatternMatcherCheckpointInterface* createCheckpoint() const
+	{
+		try
+		{
+			return new PatternMatcherCheckpoint( m_data, *m_statemachine, m_nofEvents, m_curPosition);
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to create checkpoint of pattern matcher context: %s"), *m_errorhnd, 0);
+	}
+
+	virtual void resume( const PatternMatcherCheckpointInterface* checkpoint)
+	{
+		try
+		{
+			const PatternMatcherCheckpoint* cp = dynamic_cast<const PatternMatcherCheckpoint*>( checkpoint);
+			if (!cp) throw std::runtime_error( _TXT("checkpoint passed is not an instance of the standard pattern matcher"));
+			if (cp->data() != m_data) throw std::runtime_error( _TXT("checkpoint passed was not created by a context of the same pattern matcher instance"));
+
+			StateMachine* new_statemachine = new StateMachine( cp->statemachine(), m_debugtrace);
+			delete m_statemachine;
+			m_statemachine = new_statemachine;
+			m_nofEvents = cp->nofEvents();
+			m_curPosition = cp->position();
+		}
+		CATCH_ERROR_MAP( _TXT("failed to resume pattern matcher context from checkpoint: %s"), *m_errorhnd);
+	}
+
+	const StateMachine& statemachine() const	{return *m_statemachine;}
+	unsigned int nofEvents() const			{return m_nofEvents;}
+
+private:
+	void doTermTransition( const analyzer::PatternLexem& term, StateMachine::TransitionBuffers& buffers)
+	{
+		if (m_curPosition < term.ordpos())
+		{
+			m_statemachine->setCurrentPos( m_curPosition = term.ordpos());
+		}
+		uint32_t eventid = eventHandle( TermEvent, term.id());
+		EventData data( term.origpos().seg(), term.origpos().ofs(), term.origpos().seg(), term.origpos().ofs() + term.origsize(), term.ordpos(), term.ordpos()+1, 0/*subdataref*/, 0/*formathandle*/);
+		m_statemachine->doTransition( eventid, data, buffers);
+		++m_nofEvents;
+	}
+
 private:
 	ErrorBufferInterface* m_errorhnd;
 	DebugTraceContextInterface* m_debugtrace;
@@ -340,13 +597,394 @@ private:
 };
 
 
+/// \brief Context matching a document with one state machine per shard of the programs, the shards fed in parallel with the same input
+/// \note The input is buffered and fed to the shards when the results are fetched.
+///	The first shard is fed in the calling thread, the others by threads of the context started once with it, waiting for the input of the next call
+class PatternMatcherShardedContext
+	:public PatternMatcherContextInterface
+	,public PatternMatcherBatchInputInterface
+{
+public:
+	PatternMatcherShardedContext( const PatternMatcherData* data_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_)
+		,m_data(data_)
+		,m_shards()
+		,m_input()
+		,m_curPosition(0)
+		,m_workers()
+		,m_threads()
+		,m_terminate(false)
+		,m_round(0)
+		,m_nofOpenTasks(0)
+		,m_errors()
+	{
+		std::vector<ProgramTableShard>::const_iterator hi = m_data->shards.begin(), he = m_data->shards.end();
+		for (; hi != he; ++hi)
+		{
+			m_shards.push_back( strus::Reference<PatternMatcherContext>( new PatternMatcherContext( m_data, m_errorhnd, &*hi)));
+		}
+		m_errors.resize( m_shards.size());
+		std::size_t si = 1, se = m_shards.size();
+		for (; si < se; ++si)
+		{
+			m_workers.push_back( strus::Reference<ShardWorker>( new ShardWorker( this, si)));
+		}
+		try
+		{
+			std::vector<strus::Reference<ShardWorker> >::iterator wi = m_workers.begin(), we = m_workers.end();
+			for (; wi != we; ++wi)
+			{
+				m_threads.push_back( strus::Reference<strus::thread>( new strus::thread( &ShardWorker::run, wi->get())));
+			}
+		}
+		catch (const std::exception&)
+		{
+			// ... the shards without a thread are fed in the calling thread
+		}
+	}
+
+	virtual ~PatternMatcherShardedContext()
+	{
+		terminate();
+	}
+
+	virtual void putInput( const analyzer::PatternLexem& term)
+	{
+		try
+		{
+			if (m_curPosition > term.ordpos())
+			{
+				throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), m_curPosition, term.ordpos());
+			}
+			checkInputTerm( term);
+			m_input.push_back( term);
+			m_curPosition = term.ordpos();
+		}
+		CATCH_ERROR_MAP( _TXT("failed to feed input to pattern matcher: %s"), *m_errorhnd);
+	}
+
+	virtual void putInputBatch( const analyzer::PatternLexem* ar, std::size_t arsize)
+	{
+		try
+		{
+			int pos = m_curPosition;
+			std::size_t ai = 0;
+			for (; ai != arsize; ++ai)
+			{
+				const analyzer::PatternLexem& term = ar[ ai];
+				if (pos > term.ordpos())
+				{
+					throw strus::runtime_error(_TXT("term events not fed in ascending order (%u > %u)"), pos, term.ordpos());
+				}
+				checkInputTerm( term);
+				pos = term.ordpos();
+			}
+			m_input.insert( m_input.end(), ar, ar + arsize);
+			m_curPosition = pos;
+		}
+		CATCH_ERROR_MAP( _TXT("failed to feed input batch to pattern matcher: %s"), *m_errorhnd);
+	}
+
+	virtual std::vector<analyzer::PatternMatcherResult> fetchResults()
+	{
+		try
+		{
+			feedShards();
+
+			// Merge the results of the shards in the order of the results of a context without shards:
+			std::vector<const StateMachine*> statemachines;
+			std::size_t si = 0, se = m_shards.size();
+			for (; si != se; ++si)
+			{
+				statemachines.push_back( &m_shards[ si]->statemachine());
+			}
+			std::vector<ShardResultRef> resultrefs;
+			StateMachine::mergeShardResults( resultrefs, statemachines.data(), statemachines.size());
+
+			std::vector<analyzer::PatternMatcherResult> rt;
+			rt.reserve( resultrefs.size());
+			std::vector<bool> eliminate;
+			if (m_data->exclusive)
+			{
+				std::vector<const Result*> results;
+				results.reserve( resultrefs.size());
+				std::vector<ShardResultRef>::const_iterator ri = resultrefs.begin(), re = resultrefs.end();
+				for (; ri != re; ++ri)
+				{
+					results.push_back( ri->result);
+				}
+				eliminate = getCoveredFlags( results);
+			}
+			std::size_t ri = 0, re = resultrefs.size();
+			for (; ri != re; ++ri)
+			{
+				if (eliminate.empty() || !eliminate[ ri])
+				{
+					m_shards[ resultrefs[ ri].shardidx]->pushResult( rt, *resultrefs[ ri].result);
+				}
+			}
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to fetch pattern match result: %s"), *m_errorhnd, std::vector<analyzer::PatternMatcherResult>());
+	}
+
+	virtual analyzer::PatternMatcherStatistics getStatistics() const
+	{
+		try
+		{
+			PatternMatcherStatistics stats;
+			unsigned int nofProgramsInstalled = 0;
+			unsigned int nofAltKeyProgramsInstalled = 0;
+			unsigned int nofSignalsFired = 0;
+			double nofOpenPatterns = 0;
+			unsigned int nofEvents = 0;
+			std::vector<strus::Reference<PatternMatcherContext> >::const_iterator si = m_shards.begin(), se = m_shards.end();
+			for (; si != se; ++si)
+			{
+				const StateMachine& statemachine = (*si)->statemachine();
+				nofProgramsInstalled += statemachine.nofProgramsInstalled();
+				nofAltKeyProgramsInstalled += statemachine.nofAltKeyProgramsInstalled();
+				nofSignalsFired += statemachine.nofSignalsFired();
+				nofOpenPatterns += statemachine.nofOpenPatterns();
+				nofEvents = (*si)->nofEvents();
+			}
+			stats.define( "nofProgramsInstalled", nofProgramsInstalled);
+			stats.define( "nofAltKeyProgramsInstalled", nofAltKeyProgramsInstalled);
+			stats.define( "nofSignalsFired", nofSignalsFired);
+			if (nofEvents)
+			{
+				stats.define( "nofTriggersAvgActive", nofOpenPatterns / nofEvents);
+			}
+			return stats;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to get pattern match statistics: %s"), *m_errorhnd, PatternMatcherStatistics());
+	}
+
+	virtual void reset()
+	{
+		try
+		{
+			std::vector<strus::Reference<PatternMatcherContext> >::iterator si = m_shards.begin(), se = m_shards.end();
+			for (; si != se; ++si)
+			{
+				(*si)->reset();
+			}
+			m_input.clear();
+			m_curPosition = 0;
+		}
+		CATCH_ERROR_MAP( _TXT("failed to get reset pattern matcher context: %s"), *m_errorhnd);
+	}
+
+private:
+	/// \brief Thread feeding the buffered input to the state machine of one shard in each call of feedShards
+	class ShardWorker
+	{
+	public:
+		ShardWorker( PatternMatcherShardedContext* owner_, std::size_t shardidx_)
+			:m_owner(owner_),m_shardidx(shardidx_){}
+
+		void run()
+		{
+			m_owner->runWorker( m_shardidx);
+		}
+
+	private:
+		PatternMatcherShardedContext* m_owner;
+		std::size_t m_shardidx;
+	};
+
+	/// \brief Feed the buffered input to the state machine of one shard
+	/// \param[out] error the error message in case of an error
+	void feedShard( std::size_t shardidx, std::string& error)
+	{
+		try
+		{
+			StateMachine::TransitionBuffers buffers;
+			PatternMatcherContext* context = m_shards[ shardidx].get();
+			std::vector<analyzer::PatternLexem>::const_iterator ii = m_input.begin(), ie = m_input.end();
+			for (; ii != ie; ++ii)
+			{
+				context->putInput( *ii, buffers);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			error = _TXT("out of memory");
+		}
+		catch (const std::exception& err)
+		{
+			error = err.what();
+		}
+	}
+
+	void runWorker( std::size_t shardidx)
+	{
+		unsigned int round = 0;
+		strus::unique_lock lock( m_mutex);
+		for (;;)
+		{
+			while (!m_terminate && round == m_round)
+			{
+				m_taskCond.wait( lock);
+			}
+			if (m_terminate) break;
+			round = m_round;
+			lock.unlock();
+
+			// The input is not modified until all shards are fed, each thread writes only the error of its shard:
+			feedShard( shardidx, m_errors[ shardidx]);
+
+			lock.lock();
+			if (--m_nofOpenTasks == 0)
+			{
+				m_doneCond.notify_all();
+			}
+		}
+	}
+
+	void terminate()
+	{
+		{
+			strus::scoped_lock lock( m_mutex);
+			m_terminate = true;
+			m_taskCond.notify_all();
+		}
+		std::vector<strus::Reference<strus::thread> >::iterator ti = m_threads.begin(), te = m_threads.end();
+		for (; ti != te; ++ti) (*ti)->join();
+		m_threads.clear();
+	}
+
+	/// \brief Feed the buffered input to all shards, the first shard and the shards without a thread in the calling thread, the others by their threads
+	void feedShards()
+	{
+		if (m_input.empty()) return;
+		{
+			strus::scoped_lock lock( m_mutex);
+			m_nofOpenTasks = m_threads.size();
+			++m_round;
+			m_taskCond.notify_all();
+		}
+		feedShard( 0, m_errors[ 0]);
+		std::size_t si = m_threads.size()+1, se = m_shards.size();
+		for (; si < se; ++si)
+		{
+			feedShard( si, m_errors[ si]);
+		}
+		{
+			strus::unique_lock lock( m_mutex);
+			while (m_nofOpenTasks) m_doneCond.wait( lock);
+		}
+		m_input.clear();
+
+		std::vector<std::string>::iterator ei = m_errors.begin(), ee = m_errors.end();
+		for (; ei != ee; ++ei)
+		{
+			if (!ei->empty())
+			{
+				std::string error;
+				error.swap( *ei);
+				throw strus::runtime_error( _TXT("error feeding input to pattern matcher shard: %s"), error.c_str());
+			}
+		}
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	const PatternMatcherData* m_data;
+	std::vector<strus::Reference<PatternMatcherContext> > m_shards;
+	std::vector<analyzer::PatternLexem> m_input;		///< input not yet fed to the shards
+	int m_curPosition;
+	std::vector<strus::Reference<ShardWorker> > m_workers;	///< workers of the shards except the first one
+	std::vector<strus::Reference<strus::thread> > m_threads;	///< threads of the workers started, the first ones of m_workers
+	strus::mutex m_mutex;					///< mutex protecting the state of the current call of feedShards
+	strus::condition_variable m_taskCond;			///< signaled when the input of a call of feedShards is ready or on termination
+	strus::condition_variable m_doneCond;			///< signaled when all threads have fed the input of a call to their shard
+	bool m_terminate;
+	unsigned int m_round;					///< counter of the calls of feedShards, a thread feeds its shard when it changes
+	std::size_t m_nofOpenTasks;				///< number of threads not finished feeding the input of the current call
+	std::vector<std::string> m_errors;			///< errors of the current call of feedShards per shard
+
+private:
+	PatternMatcherShardedContext( const PatternMatcherShardedContext&);	//... non copyable
+	void operator=( const PatternMatcherShardedContext&);			//... non copyable
+};
+
+
+/// \brief Context feeding the lexems detected by a lexer directly to a pattern matcher without building a list of lexems
+class PatternLexerMatcherContext
+	:public PatternLexerMatcherContextInterface
+{
+public:
+	PatternLexerMatcherContext( PatternLexerContextInterface* lexer_, PatternMatcherContext* matcher_, bool keepResultValues_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_lexer(lexer_),m_matcher(matcher_),m_sink(matcher_),m_keepResultValues(keepResultValues_){}
+
+	virtual ~PatternLexerMatcherContext()
+	{
+		delete m_lexer;
+		delete m_matcher;
+	}
+
+	virtual std::vector<analyzer::PatternMatcherResult> match( const char* src, std::size_t srclen)
+	{
+		try
+		{
+			m_matcher->reset();
+			if (!m_keepResultValues)
+			{
+				m_matcher->resetResultValues();
+			}
+			matchPatternLexerContext( m_lexer, src, srclen, m_sink);
+			return m_matcher->fetchResults();
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to run lexer and pattern matcher: %s"), *m_errorhnd, std::vector<analyzer::PatternMatcherResult>());
+	}
+
+	virtual analyzer::PatternMatcherStatistics getStatistics() const
+	{
+		return m_matcher->getStatistics();
+	}
+
+	/// \brief Release the memory of the result values of the previous calls of match
+	void resetResultValues()
+	{
+		m_matcher->resetResultValues();
+	}
+
+private:
+	/// \brief Sink passing the lexems to the pattern matcher context, the buffers for the state machine are allocated once with the context
+	class MatcherSink
+		:public PatternLexemSink
+	{
+	public:
+		explicit MatcherSink( PatternMatcherContext* matcher_)
+			:m_matcher(matcher_){}
+
+		virtual void push_back( const analyzer::PatternLexem& lexem)
+		{
+			m_matcher->putInput( lexem, m_buffers);
+		}
+
+	private:
+		PatternMatcherContext* m_matcher;
+		StateMachine::TransitionBuffers m_buffers;
+	};
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	PatternLexerContextInterface* m_lexer;
+	PatternMatcherContext* m_matcher;
+	MatcherSink m_sink;
+	bool m_keepResultValues;		///< true, if the result values are not released by match, but by resetResultValues only
+};
+
+
 /// \brief Interface for building the automaton for detecting patterns in a document stream
 class PatternMatcherInstance
 	:public PatternMatcherInstanceInterface
 {
 public:
 	explicit PatternMatcherInstance( ErrorBufferInterface* errorhnd_)
-		:m_errorhnd(errorhnd_),m_debugtrace(0),m_data(errorhnd_),m_stack(),m_expression_event_cnt(0),m_popt()
+		:m_errorhnd(errorhnd_),m_debugtrace(0),m_data(errorhnd_),m_stack(),m_expression_event_cnt(0),m_popt(),m_imageLoaded(false)
 	{
 		DebugTraceInterface* dbgi = m_errorhnd->debugTrace();
 		if (dbgi) m_debugtrace = dbgi->createTraceContext( STRUS_DBGTRACE_COMPONENT_NAME);
@@ -359,13 +997,19 @@ public:
 
 	virtual void defineTermFrequency( unsigned int termid, double df)
 	{
-		m_data.programTable.defineEventFrequency( eventHandle( TermEvent, termid), df);
+		try
+		{
+			checkDefinitionPhase();
+			m_data.programTable.defineEventFrequency( eventHandle( TermEvent, termid), df);
+		}
+		CATCH_ERROR_MAP( _TXT("failed to define term frequency: %s"), *m_errorhnd);
 	}
 
 	virtual void pushTerm( unsigned int termid)
 	{
 		try
 		{
+			checkDefinitionPhase();
 			DEBUG_EVENT2( "term", "id=%d stack=%u", (int)termid, (unsigned int)m_stack.size()+1)
 			uint32_t eventid = eventHandle( TermEvent, termid);
 			m_stack.push_back( StackElement( eventid));
@@ -379,6 +1023,7 @@ public:
 	{
 		try
 		{
+			checkDefinitionPhase();
 			DEBUG_EVENT4( "expression", "op=%d args=%u range=%d cardinality=%d", (int)joinop, (unsigned int)argc, range, cardinality)
 			if (range > std::numeric_limits<uint32_t>::max())
 			{
@@ -510,6 +1155,7 @@ public:
 	{
 		try
 		{
+			checkDefinitionPhase();
 			DEBUG_EVENT2( "pattern", "name=%s stack=%u", name.c_str(), (unsigned int)m_stack.size())
 			uint32_t eventid = eventHandle( ReferenceEvent, m_data.patternMap.getOrCreate( name));
 			if (eventid == 0) throw std::runtime_error( _TXT("failed to define pattern symbol"));
@@ -522,6 +1168,7 @@ public:
 	{
 		try
 		{
+			checkDefinitionPhase();
 			DEBUG_EVENT1( "variable", "name=%s", name.c_str())
 			if (m_stack.empty())
 			{
@@ -545,6 +1192,7 @@ public:
 	{
 		try
 		{
+			checkDefinitionPhase();
 			if (m_stack.empty())
 			{
 				throw std::runtime_error( _TXT("illegal operation close pattern when no node on the stack"));
@@ -561,6 +1209,7 @@ public:
 			if (!formatstring.empty())
 			{
 				m_data.resultFormatHandles.push_back( m_data.resultFormatTable->createResultFormat( formatstring.c_str()));
+				m_data.resultFormatStrings.push_back( formatstring);
 				formatHandle = m_data.resultFormatHandles.size();
 			}
 			if (!program)
@@ -586,11 +1235,33 @@ public:
 	{
 		try
 		{
+			if (m_data.shards.size() > 1)
+			{
+				return new PatternMatcherShardedContext( &m_data, m_errorhnd);
+			}
 			return new PatternMatcherContext( &m_data, m_errorhnd);
 		}
 		CATCH_ERROR_MAP_RETURN( _TXT("failed to create pattern match context: %s"), *m_errorhnd, 0);
 	}
 
+	PatternLexerMatcherContextInterface* createLexerMatcherContext( const PatternLexerInstanceInterface* lexer, bool keepResultValues) const
+	{
+		PatternLexerContextInterface* lexerctx = lexer->createContext();
+		if (!lexerctx) throw std::runtime_error( _TXT("failed to create lexer context"));
+		PatternMatcherContext* matcherctx = 0;
+		try
+		{
+			matcherctx = new PatternMatcherContext( &m_data, m_errorhnd);
+			return new PatternLexerMatcherContext( lexerctx, matcherctx, keepResultValues, m_errorhnd);
+		}
+		catch (...)
+		{
+			delete lexerctx;
+			if (matcherctx) delete matcherctx;
+			throw;
+		}
+	}
+
 	void printAutomatonStatistics( std::ostream& out)
 	{
 		ProgramTable::Statistics stats = m_data.programTable.getProgramStatistics();
@@ -626,6 +1297,10 @@ public:
 			{
 				m_popt.maxRange = (unsigned int)(value + std::numeric_limits<double>::epsilon());
 			}
+			else if (strus::caseInsensitiveEquals( name, "compileThreads"))
+			{
+				m_popt.nofThreads = (unsigned int)(value + std::numeric_limits<double>::epsilon());
+			}
 			else if (strus::caseInsensitiveEquals( name, "maxResultSize"))
 			{
 				m_data.maxResultSize = (unsigned int)(value + std::numeric_limits<double>::epsilon());
@@ -634,6 +1309,18 @@ public:
 			{
 				m_data.exclusive = true;
 			}
+			else if (strus::caseInsensitiveEquals( name, "triggerHashIndex"))
+			{
+				m_data.triggerHashIndex = (value > std::numeric_limits<double>::epsilon());
+			}
+			else if (strus::caseInsensitiveEquals( name, "resetTrimSize"))
+			{
+				m_data.resetTrimSize = (unsigned int)(value + std::numeric_limits<double>::epsilon());
+			}
+			else if (strus::caseInsensitiveEquals( name, "shards"))
+			{
+				m_data.nofShards = (unsigned int)(value + std::numeric_limits<double>::epsilon());
+			}
 			else
 			{
 				throw strus::runtime_error(_TXT("unknown token pattern match option: '%s'"), name.c_str());
@@ -646,6 +1333,7 @@ public:
 	{
 		try
 		{
+			if (m_imageLoaded) return true; //... already compiled
 			if (m_debugtrace)
 			{
 				std::ostringstream out;
@@ -655,6 +1343,7 @@ public:
 				DEBUG_EVENT1( "statistics", "%s", outstr.c_str())
 			}
 			m_data.programTable.optimize( m_popt);
+			createShards();
 
 			if (m_debugtrace)
 			{
@@ -674,6 +1363,107 @@ public:
 		return analyzer::FunctionView();
 	}
 
+	/// \brief Write the compiled automaton as image to a file
+	void storeImage( const std::string& filename) const
+	{
+		if (!m_data.programTable.compiled())
+		{
+			throw std::runtime_error( _TXT("called store image without calling 'compile'"));
+		}
+		ImageWriter out;
+		out.writeHeader( ImageMagic, ImageVersion);
+		out.write<uint32_t>( m_data.exclusive ? 1:0);
+		out.write<uint32_t>( m_data.maxResultSize);
+		out.write<uint32_t>( m_data.triggerHashIndex ? 1:0);
+		out.write<uint32_t>( m_data.resetTrimSize);
+		out.write<uint32_t>( m_data.nofShards);
+		std::size_t vi = 0, ve = m_data.variableMap.size();
+		out.write<uint64_t>( ve);
+		for (; vi != ve; ++vi)
+		{
+			out.writeString( m_data.variableMap.key( vi+1));
+		}
+		if (m_data.patternNameTable.defined())
+		{
+			throw std::runtime_error( _TXT("cannot store image of a pattern matcher loaded from an image"));
+		}
+		ImageNameTable::storeImage( out, m_data.patternMap);
+		out.write<uint64_t>( m_data.resultFormatStrings.size());
+		std::vector<std::string>::const_iterator fi = m_data.resultFormatStrings.begin(), fe = m_data.resultFormatStrings.end();
+		for (; fi != fe; ++fi)
+		{
+			out.writeString( *fi);
+		}
+		m_data.programTable.storeImage( out);
+		writeImageFile( filename, out.content());
+	}
+
+	/// \brief Load the compiled automaton from an image file written with storeImage
+	/// \note The program table and the pattern names reference the mapped file without copying
+	void loadImage( const std::string& filename)
+	{
+		if (m_imageLoaded || m_expression_event_cnt || !m_stack.empty() || m_data.patternMap.size())
+		{
+			throw std::runtime_error( _TXT("called load image on a pattern matcher instance with definitions"));
+		}
+		m_data.image.open( filename);
+		ImageReader in( m_data.image.ptr(), m_data.image.size());
+		in.readHeader( ImageMagic, ImageVersion);
+		m_data.exclusive = (0!=in.read<uint32_t>());
+		m_data.maxResultSize = in.read<uint32_t>();
+		m_data.triggerHashIndex = (0!=in.read<uint32_t>());
+		m_data.resetTrimSize = in.read<uint32_t>();
+		m_data.nofShards = in.read<uint32_t>();
+		std::size_t vi = 0, ve = in.read<uint64_t>();
+		for (; vi != ve; ++vi)
+		{
+			if (vi+1 != m_data.variableMap.getOrCreate( in.readString()))
+			{
+				throw std::runtime_error( _TXT("corrupt variable table in pattern matcher image"));
+			}
+		}
+		m_data.patternNameTable.loadImage( in);
+		std::size_t fi = 0, fe = in.read<uint64_t>();
+		for (; fi != fe; ++fi)
+		{
+			std::string formatstring = in.readString();
+			const PatternResultFormat* fmt = m_data.resultFormatTable->createResultFormat( formatstring.c_str());
+			if (!fmt)
+			{
+				throw std::runtime_error( _TXT("failed to create result format from pattern matcher image"));
+			}
+			m_data.resultFormatHandles.push_back( fmt);
+			m_data.resultFormatStrings.push_back( formatstring);
+		}
+		m_data.programTable.loadImage( in);
+		if (!in.eof())
+		{
+			throw std::runtime_error( _TXT("corrupt pattern matcher image"));
+		}
+		// The handles are used as indices without checking them while matching:
+		m_data.programTable.checkHandles( m_data.patternNameTable.size(), m_data.resultFormatHandles.size(), m_data.variableMap.size());
+		createShards();
+		m_imageLoaded = true;
+	}
+
+private:
+	void createShards()
+	{
+		m_data.shards.clear();
+		if (m_data.nofShards > 1)
+		{
+			ProgramTableShard::createShards( m_data.shards, m_data.programTable, m_data.nofShards, DerivedEventMask);
+		}
+	}
+
+	void checkDefinitionPhase() const
+	{
+		if (m_imageLoaded)
+		{
+			throw std::runtime_error( _TXT("cannot add definitions to a pattern matcher loaded from an image"));
+		}
+	}
+
 private:
 	struct StackElement
 	{
@@ -696,13 +1486,18 @@ private:
 	std::vector<StackElement> m_stack;
 	uint32_t m_expression_event_cnt;
 	ProgramTable::OptimizeOptions m_popt;
+	bool m_imageLoaded;
+	static const char* ImageMagic;
+	enum {ImageVersion=4};
 };
 
+const char* PatternMatcherInstance::ImageMagic = "strus matcher";
+
 
 std::vector<std::string> PatternMatcher::getCompileOptionNames() const
 {
 	std::vector<std::string> rt;
-	static const char* ar[] = {"stopwordOccurrenceFactor","weightFactor","maxRange","exclusive","maxResultSize",0};
+	static const char* ar[] = {"stopwordOccurrenceFactor","weightFactor","maxRange","exclusive","maxResultSize","triggerHashIndex","resetTrimSize","compileThreads","shards",0};
 	for (std::size_t ai=0; ar[ai]; ++ai)
 	{
 		rt.push_back( ar[ ai]);
@@ -719,6 +1514,68 @@ PatternMatcherInstanceInterface* PatternMatcher::createInstance() const
 	CATCH_ERROR_MAP_RETURN( _TXT("failed to create pattern match instance: %s"), *m_errorhnd, 0);
 }
 
+bool strus::storePatternMatcherImage( const PatternMatcherInstanceInterface* instance, const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		const PatternMatcherInstance* matcher = dynamic_cast<const PatternMatcherInstance*>( instance);
+		if (!matcher)
+		{
+			throw std::runtime_error( _TXT("matcher instance passed is not an instance of the standard pattern matcher"));
+		}
+		matcher->storeImage( filename);
+		return true;
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to store pattern matcher image: %s"), *errorhnd, false);
+}
+
+PatternLexerMatcherContextInterface* strus::createPatternLexerMatcherContext( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* instance, ErrorBufferInterface* errorhnd, bool keepResultValues)
+{
+	try
+	{
+		const PatternMatcherInstance* matcher = dynamic_cast<const PatternMatcherInstance*>( instance);
+		if (!matcher)
+		{
+			throw std::runtime_error( _TXT("matcher instance passed is not an instance of the standard pattern matcher"));
+		}
+		return matcher->createLexerMatcherContext( lexer, keepResultValues);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to create lexer pattern matcher context: %s"), *errorhnd, 0);
+}
+
+void strus::resetPatternLexerMatcherResultValues( PatternLexerMatcherContextInterface* context, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		PatternLexerMatcherContext* ctx = dynamic_cast<PatternLexerMatcherContext*>( context);
+		if (!ctx)
+		{
+			throw std::runtime_error( _TXT("context passed is not a lexer pattern matcher context of the standard pattern matcher"));
+		}
+		ctx->resetResultValues();
+	}
+	CATCH_ERROR_MAP( _TXT("failed to reset result values of lexer pattern matcher context: %s"), *errorhnd);
+}
+
+PatternMatcherInstanceInterface* strus::loadPatternMatcherImage( const std::string& filename, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		PatternMatcherInstance* rt = new PatternMatcherInstance( errorhnd);
+		try
+		{
+			rt->loadImage( filename);
+		}
+		catch (...)
+		{
+			delete rt;
+			throw;
+		}
+		return rt;
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to load pattern matcher image: %s"), *errorhnd, 0);
+}
+
 const char* PatternMatcher::getDescription() const
 {
 	return _TXT( "pattern matcher based on an event driven automaton");
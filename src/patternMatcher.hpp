@@ -10,6 +10,7 @@
 #ifndef _STRUS_PATTERN_MATCHER_IMPLEMENTATION_HPP_INCLUDED
 #define _STRUS_PATTERN_MATCHER_IMPLEMENTATION_HPP_INCLUDED
 #include "strus/patternMatcherInterface.hpp"
+#include <string>
 
 namespace strus
 {
@@ -17,6 +18,10 @@ namespace strus
 class PatternMatcherInstanceInterface;
 /// \brief Forward declaration
 class ErrorBufferInterface;
+/// \brief Forward declaration
+class PatternLexerInstanceInterface;
+/// \brief Forward declaration
+class PatternLexerMatcherContextInterface;
 
 /// \brief Implementation of an automaton builder for detecting patterns of tokens in a document stream
 class PatternMatcher
@@ -36,5 +41,31 @@ private:
 	ErrorBufferInterface* m_errorhnd;
 };
 
+/// \brief Write the compiled automaton of a pattern matcher instance as image to a file
+/// \param[in] instance compiled pattern matcher instance created by PatternMatcher
+/// \param[in] filename path of the file to write
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return true on success, false on error
+bool storePatternMatcherImage( const PatternMatcherInstanceInterface* instance, const std::string& filename, ErrorBufferInterface* errorhnd);
+
+/// \brief Create a compiled pattern matcher instance from an image file written with storePatternMatcherImage
+/// \param[in] filename path of the file to load
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \return the pattern matcher instance ready for creating contexts
+PatternMatcherInstanceInterface* loadPatternMatcherImage( const std::string& filename, ErrorBufferInterface* errorhnd);
+
+/// \brief Create a context running a lexer and feeding the lexems detected directly to a pattern matcher without building a list of lexems
+/// \param[in] lexer compiled lexer instance created by PatternLexer
+/// \param[in] instance compiled pattern matcher instance created by PatternMatcher
+/// \param[in] errorhnd error buffer interface for reporting errors
+/// \param[in] keepResultValues true, if the result values of all calls of match are kept until resetPatternLexerMatcherResultValues is called, false if every call of match releases the ones of the previous call
+/// \return the context or NULL on error
+PatternLexerMatcherContextInterface* createPatternLexerMatcherContext( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* instance, ErrorBufferInterface* errorhnd, bool keepResultValues=false);
+
+/// \brief Release the memory of the result values of a context created with createPatternLexerMatcherContext
+/// \param[in] context context to reset the result values of
+/// \param[in] errorhnd error buffer interface for reporting errors
+void resetPatternLexerMatcherResultValues( PatternLexerMatcherContextInterface* context, ErrorBufferInterface* errorhnd);
+
 } //namespace
 #endif
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Implementation of a pool of threads detecting patterns in many documents in parallel
+/// \file "patternMatcherDocumentPool.cpp"
+#include "patternMatcherDocumentPool.hpp"
+#include "patternMatcher.hpp"
+#include "errorUtils.hpp"
+#include "internationalization.hpp"
+#include "strus/patternMatcherDocumentPoolInterface.hpp"
+#include "strus/patternLexerMatcherContextInterface.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/reference.hpp"
+#include <vector>
+#include <deque>
+#include <string>
+
+using namespace strus;
+
+/// \brief Pool of threads, each with a lexer feeding a pattern matcher, processing the documents of a call in parallel
+/// \note Every thread has its own queue of documents. The documents are distributed round robin over the queues.
+///	A thread with an empty queue steals documents from the end of the longest queue of the other threads.
+///	The contexts of the threads keep the result values of all documents of a call, they are released at the start of the next call.
+class PatternMatcherDocumentPool
+	:public PatternMatcherDocumentPoolInterface
+{
+public:
+	PatternMatcherDocumentPool( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* instance, unsigned int nofThreads_, std::size_t queueSize_, ErrorBufferInterface* errorhnd_)
+		:m_errorhnd(errorhnd_),m_workers(),m_threads(),m_queueSize(queueSize_?queueSize_:1)
+		,m_terminate(false),m_docar(0),m_results(0),m_nofOpenTasks(0),m_errors()
+	{
+		if (nofThreads_ == 0) throw std::runtime_error( _TXT("number of threads of a document pool must be at least 1"));
+		unsigned int ti = 0;
+		for (; ti < nofThreads_; ++ti)
+		{
+			PatternLexerMatcherContextInterface* context = createPatternLexerMatcherContext( lexer, instance, m_errorhnd, true/*keepResultValues*/);
+			if (!context) throw std::runtime_error( _TXT("failed to create lexer pattern matcher context for a thread of the document pool"));
+			m_workers.push_back( strus::Reference<Worker>( new Worker( this, ti, context)));
+		}
+		try
+		{
+			for (ti = 0; ti < nofThreads_; ++ti)
+			{
+				m_threads.push_back( strus::Reference<strus::thread>( new strus::thread( &Worker::run, m_workers[ ti].get())));
+			}
+		}
+		catch (...)
+		{
+			terminate();
+			throw;
+		}
+	}
+
+	virtual ~PatternMatcherDocumentPool()
+	{
+		terminate();
+	}
+
+	virtual std::vector<std::vector<analyzer::PatternMatcherResult> > matchDocuments( const Document* docar, std::size_t docarsize)
+	{
+		try
+		{
+			strus::scoped_lock callLock( m_callMutex);
+			std::vector<std::vector<analyzer::PatternMatcherResult> > rt( docarsize);
+			// The threads are idle between calls, so the result values of the previous call can be released here:
+			std::vector<strus::Reference<Worker> >::iterator ri = m_workers.begin(), re = m_workers.end();
+			for (; ri != re; ++ri)
+			{
+				(*ri)->resetResultValues( m_errorhnd);
+			}
+			strus::unique_lock lock( m_mutex);
+			m_docar = docar;
+			m_results = &rt;
+			m_errors.clear();
+			try
+			{
+				std::size_t di = 0;
+				for (; di < docarsize; ++di)
+				{
+					// Put the document into the queue of the next thread in turn with space left, wait if all queues are full:
+					std::size_t wi = findQueueWithSpace( di % m_workers.size());
+					while (wi == m_workers.size())
+					{
+						m_spaceCond.wait( lock);
+						wi = findQueueWithSpace( di % m_workers.size());
+					}
+					m_workers[ wi]->queue.push_back( di);
+					++m_nofOpenTasks;
+					m_taskCond.notify_one();
+				}
+			}
+			catch (...)
+			{
+				// ... drop the documents not started yet and wait for the ones in process, before the result is freed
+				std::vector<strus::Reference<Worker> >::iterator wi = m_workers.begin(), we = m_workers.end();
+				for (; wi != we; ++wi)
+				{
+					m_nofOpenTasks -= (*wi)->queue.size();
+					(*wi)->queue.clear();
+				}
+				while (m_nofOpenTasks) m_doneCond.wait( lock);
+				m_docar = 0;
+				m_results = 0;
+				throw;
+			}
+			while (m_nofOpenTasks) m_doneCond.wait( lock);
+			m_docar = 0;
+			m_results = 0;
+			if (!m_errors.empty())
+			{
+				throw strus::runtime_error( _TXT("error in thread of document pool: %s"), m_errors[0].c_str());
+			}
+			return rt;
+		}
+		CATCH_ERROR_MAP_RETURN( _TXT("failed to match documents with pattern matcher document pool: %s"), *m_errorhnd, std::vector<std::vector<analyzer::PatternMatcherResult> >());
+	}
+
+	virtual unsigned int nofThreads() const
+	{
+		return m_workers.size();
+	}
+
+private:
+	class Worker
+	{
+	public:
+		Worker( PatternMatcherDocumentPool* pool_, std::size_t idx_, PatternLexerMatcherContextInterface* context_)
+			:queue(),m_pool(pool_),m_idx(idx_),m_context(context_){}
+		~Worker()
+		{
+			delete m_context;
+		}
+
+		void run()
+		{
+			m_pool->runWorker( m_idx, m_context);
+		}
+
+		/// \brief Release the memory of the result values of the documents processed, must not be called while the thread processes a document
+		void resetResultValues( ErrorBufferInterface* errorhnd)
+		{
+			resetPatternLexerMatcherResultValues( m_context, errorhnd);
+		}
+
+		std::deque<std::size_t> queue;		///< indices of the documents waiting to be processed by this thread
+
+	private:
+#if __cplusplus >= 201103L
+		Worker( const Worker&) = delete;
+		void operator=( const Worker&) = delete;
+#else
+		Worker( const Worker&){}
+		void operator=( const Worker&){}
+#endif
+
+	private:
+		PatternMatcherDocumentPool* m_pool;
+		std::size_t m_idx;
+		PatternLexerMatcherContextInterface* m_context;
+	};
+
+	/// \brief Find the queue with space left, starting with the one of a preferred thread
+	/// \return the index of the thread or the number of threads if all queues are full
+	/// \note Expects the pool mutex to be locked
+	std::size_t findQueueWithSpace( std::size_t startidx) const
+	{
+		std::size_t ii = 0, nn = m_workers.size();
+		for (; ii < nn; ++ii)
+		{
+			std::size_t wi = (startidx + ii) % nn;
+			if (m_workers[ wi]->queue.size() < m_queueSize) return wi;
+		}
+		return nn;
+	}
+
+	/// \brief Take the next document of the own queue or steal one from the end of the longest queue of another thread
+	/// \note Expects the pool mutex to be locked
+	bool fetchTask( std::size_t workeridx, std::size_t& docidx)
+	{
+		std::deque<std::size_t>* queue = &m_workers[ workeridx]->queue;
+		if (queue->empty())
+		{
+			std::size_t wi = 0, we = m_workers.size();
+			for (; wi < we; ++wi)
+			{
+				if (m_workers[ wi]->queue.size() > queue->size())
+				{
+					queue = &m_workers[ wi]->queue;
+				}
+			}
+			if (queue->empty()) return false;
+			docidx = queue->back();
+			queue->pop_back();
+		}
+		else
+		{
+			docidx = queue->front();
+			queue->pop_front();
+		}
+		return true;
+	}
+
+	void runWorker( std::size_t workeridx, PatternLexerMatcherContextInterface* context)
+	{
+		bool hasErrorContext = m_errorhnd->allocContext();
+		strus::unique_lock lock( m_mutex);
+		for (;;)
+		{
+			std::size_t docidx = 0;
+			while (!m_terminate && !fetchTask( workeridx, docidx))
+			{
+				m_taskCond.wait( lock);
+			}
+			if (m_terminate) break;
+			m_spaceCond.notify_one();
+			const Document& doc = m_docar[ docidx];
+			std::vector<analyzer::PatternMatcherResult>& result = (*m_results)[ docidx];
+			lock.unlock();
+
+			// Each thread writes only the results of the documents it took from a queue:
+			std::string error;
+			try
+			{
+				if (!hasErrorContext)
+				{
+					error = _TXT("failed to allocate error buffer context for thread");
+				}
+				else
+				{
+					result = context->match( doc.src, doc.srclen);
+					if (m_errorhnd->hasError())
+					{
+						error = m_errorhnd->fetchError();
+					}
+				}
+			}
+			catch (const std::bad_alloc&)
+			{
+				error = _TXT("out of memory");
+			}
+			lock.lock();
+			if (!error.empty())
+			{
+				m_errors.push_back( error);
+			}
+			if (--m_nofOpenTasks == 0)
+			{
+				m_doneCond.notify_all();
+			}
+		}
+		lock.unlock();
+		if (hasErrorContext) m_errorhnd->releaseContext();
+	}
+
+	void terminate()
+	{
+		{
+			strus::scoped_lock lock( m_mutex);
+			m_terminate = true;
+			m_taskCond.notify_all();
+		}
+		std::vector<strus::Reference<strus::thread> >::iterator ti = m_threads.begin(), te = m_threads.end();
+		for (; ti != te; ++ti) (*ti)->join();
+		m_threads.clear();
+	}
+
+private:
+	ErrorBufferInterface* m_errorhnd;
+	std::vector<strus::Reference<Worker> > m_workers;
+	std::vector<strus::Reference<strus::thread> > m_threads;
+	strus::mutex m_callMutex;				///< mutex serializing the calls of matchDocuments
+	strus::mutex m_mutex;					///< mutex protecting the queues and the state of the current call
+	strus::condition_variable m_taskCond;			///< signaled when a document is put into a queue or on termination
+	strus::condition_variable m_spaceCond;			///< signaled when a document is taken from a queue
+	strus::condition_variable m_doneCond;			///< signaled when all documents of a call are processed
+	std::size_t m_queueSize;
+	bool m_terminate;
+	const Document* m_docar;				///< documents of the current call
+	std::vector<std::vector<analyzer::PatternMatcherResult> >* m_results;	///< results of the current call
+	std::size_t m_nofOpenTasks;				///< number of documents of the current call queued or in process
+	std::vector<std::string> m_errors;			///< errors of the current call
+};
+
+
+PatternMatcherDocumentPoolInterface* strus::createPatternMatcherDocumentPool( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* instance, unsigned int nofThreads, std::size_t queueSize, ErrorBufferInterface* errorhnd)
+{
+	try
+	{
+		return new PatternMatcherDocumentPool( lexer, instance, nofThreads, queueSize, errorhnd);
+	}
+	CATCH_ERROR_MAP_RETURN( _TXT("failed to create pattern matcher document pool: %s"), *errorhnd, 0);
+}
+
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Implementation of a pool of threads detecting patterns in many documents in parallel
+/// \file "patternMatcherDocumentPool.hpp"
+#ifndef _STRUS_PATTERN_MATCHER_DOCUMENT_POOL_IMPLEMENTATION_HPP_INCLUDED
+#define _STRUS_PATTERN_MATCHER_DOCUMENT_POOL_IMPLEMENTATION_HPP_INCLUDED
+#include <cstddef>
+
+namespace strus
+{
+/// \brief Forward declaration
+class PatternMatcherDocumentPoolInterface;
+/// \brief Forward declaration
+class PatternLexerInstanceInterface;
+/// \brief Forward declaration
+class PatternMatcherInstanceInterface;
+/// \brief Forward declaration
+class ErrorBufferInterface;
+
+/// \brief Create a pool of threads running a lexer feeding a pattern matcher on many documents in parallel
+/// \param[in] lexer compiled lexer instance created by PatternLexer
+/// \param[in] instance compiled pattern matcher instance created by PatternMatcher
+/// \param[in] nofThreads number of threads of the pool
+/// \param[in] queueSize maximum number of documents waiting in the queue of one thread, the caller blocks until a queue has space
+/// \param[in] errorhnd error buffer interface for reporting errors, has to be created for at least nofThreads+1 threads
+/// \return the pool or NULL on error
+PatternMatcherDocumentPoolInterface* createPatternMatcherDocumentPool( const PatternLexerInstanceInterface* lexer, const PatternMatcherInstanceInterface* instance, unsigned int nofThreads, std::size_t queueSize, ErrorBufferInterface* errorhnd);
+
+} //namespace
+#endif
+
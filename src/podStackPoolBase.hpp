@@ -152,6 +152,41 @@ public:
 	{
 		Parent::clear();
 	}
+	/// \brief Clear the pool, but keep the memory allocated for reuse
+	/// \param[in] maxAllocSize maximum number of elements kept allocated, 0 for no limit
+	void reset( SIZETYPE maxAllocSize=0)
+	{
+		Parent::reset( maxAllocSize);
+	}
+
+	typedef PodStackElement<ELEMTYPE,SIZETYPE> Element;
+
+	/// \brief Get the pointer to the elements (for serialization)
+	const Element* data() const
+	{
+		return Parent::data();
+	}
+	/// \brief Get the number of elements in the pool including the ones in the free list (for serialization)
+	SIZETYPE size() const
+	{
+		return Parent::size();
+	}
+	/// \brief Get the head of the free list (for serialization)
+	SIZETYPE freelistidx() const
+	{
+		return Parent::freelistidx();
+	}
+	/// \brief Get the index of the first element, a list is referenced by the index of its head plus 1 (for checking images)
+	SIZETYPE first() const
+	{
+		return Parent::first();
+	}
+	/// \brief Make the pool reference a block of elements not owned by it (e.g. in a read only mapped image)
+	/// \note The elements are copied on the first write as described in PodStructArrayBase::attach
+	void attach( const Element* ar_, SIZETYPE size_, SIZETYPE freelistidx_)
+	{
+		Parent::attach( ar_, size_, freelistidx_);
+	}
 
 private:
 	void checkCircular( SIZETYPE idx) const
@@ -11,39 +11,56 @@
 #include "strus/base/stdint.h"
 #include "internationalization.hpp"
 #include "errorUtils.hpp"
+#include "strus/base/atomic.hpp"
 #include <limits>
 #include <stdexcept>
 #include <cstring>
 #include <cstdlib>
 #include <new>
 
+/// \brief Each array type has its own base address for the indices, so that an index is never 0 (used as null reference by the automaton)
 #define STRUS_USE_BASEADDR
+/// \brief Every element access is bound checked, unless the build defines STRUS_PATTERN_UNCHECKED_ARRAYS (cmake option UNCHECKED_ARRAYS)
+/// \note An unchecked build drops the checks of the element accesses in the inner loops of the automaton, the checks on growth remain
+#ifndef STRUS_PATTERN_UNCHECKED_ARRAYS
+#define STRUS_CHECK_ARRAY_BOUNDS
+#endif
 
 namespace strus
 {
 
+/// \brief Array of POD elements, either in a buffer passed with the constructor, in memory allocated by the array or attached (read only)
+/// \note Copies of an array with allocated memory share the elements until one of them gets modified (copy on write).
+///	The reference counter of the shared memory is atomic, so copies may be used, modified and destroyed in different threads.
+///	But an array must not be copied by several threads at the same time, because the first copy creates the reference counter.
 template <typename ELEMTYPE, typename SIZETYPE, unsigned int BASEADDR>
 class PodStructArrayBase
 {
 public:
 	PodStructArrayBase( ELEMTYPE* ar_, SIZETYPE allocsize_)
-		:m_ar(ar_),m_allocsize(allocsize_),m_size(0),m_allocated(false)
+		:m_ar(ar_),m_allocsize(allocsize_),m_size(0),m_allocated(false),m_attached(false),m_refcnt(0)
 	{}
 	PodStructArrayBase()
-		:m_ar(0),m_allocsize(0),m_size(0),m_allocated(false)
+		:m_ar(0),m_allocsize(0),m_size(0),m_allocated(false),m_attached(false),m_refcnt(0)
 	{}
 	~PodStructArrayBase()
 	{
-		if (m_allocated) std::free( m_ar);
+		release();
 	}
 
 	PodStructArrayBase( const PodStructArrayBase& o)
-		:m_ar(0),m_allocsize(o.m_allocsize),m_size(o.m_size),m_allocated(false)
+		:m_ar(0),m_allocsize(0),m_size(0),m_allocated(false),m_attached(false),m_refcnt(0)
+	{
+		assign( o);
+	}
+	PodStructArrayBase& operator=( const PodStructArrayBase& o)
 	{
-		if (o.m_allocsize)
+		if (this != &o)
 		{
-			expand( m_allocsize);
+			release();
+			assign( o);
 		}
+		return *this;
 	}
 
 	SIZETYPE add( const ELEMTYPE& elem)
@@ -56,6 +73,14 @@ public:
 			}
 			expand( m_allocsize?(m_allocsize*2):BlockSize);
 		}
+		else if (m_refcnt)
+		{
+			unshare();
+		}
+		else if (m_attached)
+		{
+			expand( m_allocsize);
+		}
 		SIZETYPE newidx = m_size++;
 		m_ar[ newidx] = elem;
 #ifdef STRUS_USE_BASEADDR
@@ -70,10 +95,12 @@ public:
 #ifdef STRUS_USE_BASEADDR
 		idx -= BASEADDR;
 #endif
+#ifdef STRUS_CHECK_ARRAY_BOUNDS
 		if (idx >= m_size)
 		{
 			throw strus::runtime_error( _TXT("array bound read (%s)"), "PodStructArrayBase");
 		}
+#endif
 		return m_ar[idx];
 	}
 	ELEMTYPE& operator[]( SIZETYPE idx)
@@ -81,10 +108,14 @@ public:
 #ifdef STRUS_USE_BASEADDR
 		idx -= BASEADDR;
 #endif
+#ifdef STRUS_CHECK_ARRAY_BOUNDS
 		if (idx >= m_size)
 		{
 			throw strus::runtime_error( _TXT("array bound write (%s)"), "PodStructArrayBase");
 		}
+#endif
+		if (m_refcnt) unshare();
+		else if (m_attached) expand( m_allocsize);
 		return m_ar[idx];
 	}
 	ELEMTYPE* reserve( SIZETYPE addsize)
@@ -93,6 +124,14 @@ public:
 		{
 			expand( m_size + addsize);
 		}
+		else if (m_refcnt)
+		{
+			unshare();
+		}
+		else if (m_attached)
+		{
+			expand( m_allocsize);
+		}
 		return m_ar + m_size;
 	}
 	void commit_reserved( SIZETYPE addsize)
@@ -118,8 +157,40 @@ public:
 	}
 	void clear()
 	{
+		if (m_attached)
+		{
+			// ... the attached elements are dropped instead of being overwritten by the next elements added:
+			release();
+		}
 		m_size = 0;
 	}
+	/// \brief Clear the array, but keep the memory allocated for reuse
+	/// \param[in] maxAllocSize maximum number of elements kept allocated, the memory is freed if the array grew beyond this size, 0 for no limit
+	void reset( SIZETYPE maxAllocSize=0)
+	{
+		if ((maxAllocSize && m_allocsize > maxAllocSize && m_allocated) || m_refcnt || m_attached)
+		{
+			// ... memory shared with a copy or attached is released and not reused, because it would have to be copied on the next write anyway
+			release();
+		}
+		clear();
+	}
+
+	/// \brief Get the pointer to the elements (for serialization)
+	const ELEMTYPE* data() const
+	{
+		return m_ar;
+	}
+	/// \brief Make the array reference a block of elements not owned by it (e.g. in a read only mapped image)
+	/// \note The elements are never written, they are copied on the first modification of the array
+	void attach( const ELEMTYPE* ar_, SIZETYPE size_)
+	{
+		release();
+		m_ar = const_cast<ELEMTYPE*>( ar_);
+		m_allocsize = size_;
+		m_size = size_;
+		m_attached = true;
+	}
 
 	class const_iterator
 	{
@@ -166,29 +237,113 @@ private:
 		{
 			throw std::logic_error( "illegal call of PodStructArrayBase::expand");
 		}
+		if (!newallocsize)
+		{
+			newallocsize = BlockSize;
+		}
 		ELEMTYPE* ar_;
-		if (m_allocated)
+		if (m_refcnt)
+		{
+			ar_ = (ELEMTYPE*)std::malloc( newallocsize * sizeof(*m_ar));
+			if (!ar_) throw std::bad_alloc();
+			std::memcpy( ar_, m_ar, m_size * sizeof(*m_ar));
+			dropShare();
+		}
+		else if (m_allocated)
 		{
 			ar_ = (ELEMTYPE*)std::realloc( m_ar, newallocsize * sizeof(*m_ar));
 			if (!ar_) throw std::bad_alloc();
 		}
 		else
 		{
+			// ... copy of the elements in a buffer not owned (passed with the constructor or attached):
 			ar_ = (ELEMTYPE*)std::malloc( newallocsize * sizeof(*m_ar));
 			if (!ar_) throw std::bad_alloc();
-			std::memcpy( ar_, m_ar, m_size * sizeof(*m_ar));
+			if (m_size) std::memcpy( ar_, m_ar, m_size * sizeof(*m_ar));
 			m_allocated = true;
+			m_attached = false;
 		}
 		m_ar = ar_;
 		m_allocsize = newallocsize;
 	}
 
+	/// \brief Initialize an empty array as copy of another, sharing the memory if it is owned by the other array, copying the elements else
+	void assign( const PodStructArrayBase& o)
+	{
+		if (o.m_allocated)
+		{
+			if (!o.m_refcnt)
+			{
+				o.m_refcnt = new RefCounter( 1);
+			}
+			++*o.m_refcnt;
+			m_ar = o.m_ar;
+			m_allocsize = o.m_allocsize;
+			m_size = o.m_size;
+			m_allocated = true;
+			m_refcnt = o.m_refcnt;
+		}
+		else if (o.m_size)
+		{
+			// ... the elements of a buffer not owned (passed with the constructor or attached) are copied:
+			expand( o.m_size);
+			std::memcpy( m_ar, o.m_ar, o.m_size * sizeof(*m_ar));
+			m_size = o.m_size;
+		}
+	}
+	/// \brief Give up the reference to the shared memory, the caller is responsible to set m_ar to a valid block
+	void dropShare()
+	{
+		if (--*m_refcnt == 0)
+		{
+			std::free( m_ar);
+			delete m_refcnt;
+		}
+		m_refcnt = 0;
+	}
+	/// \brief Get a private copy of the memory shared with other arrays before a write
+	void unshare()
+	{
+		if (*m_refcnt == 1)
+		{
+			// ... all other copies are gone, the memory is owned exclusively:
+			delete m_refcnt;
+			m_refcnt = 0;
+			return;
+		}
+		ELEMTYPE* ar_ = (ELEMTYPE*)std::malloc( m_allocsize * sizeof(*m_ar));
+		if (!ar_) throw std::bad_alloc();
+		std::memcpy( ar_, m_ar, m_size * sizeof(*m_ar));
+		dropShare();
+		m_ar = ar_;
+	}
+	void release()
+	{
+		if (m_refcnt)
+		{
+			dropShare();
+		}
+		else if (m_allocated)
+		{
+			std::free( m_ar);
+		}
+		m_ar = 0;
+		m_allocsize = 0;
+		m_size = 0;
+		m_allocated = false;
+		m_attached = false;
+	}
+
 private:
 	enum {BlockSize=128};
+	typedef strus::atomic<unsigned int> RefCounter;
+
 	ELEMTYPE* m_ar;
 	SIZETYPE m_allocsize;
 	SIZETYPE m_size;
-	bool m_allocated;
+	bool m_allocated;			///< true, if the memory m_ar is allocated by this array (or shared with copies of it)
+	bool m_attached;			///< true, if m_ar references elements not owned by this array and not writable (attached image)
+	mutable RefCounter* m_refcnt;		///< number of arrays sharing the memory m_ar with copy on write or NULL if not shared
 };
 
 }//namespace
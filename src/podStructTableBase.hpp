@@ -147,13 +147,37 @@ public:
 	void clear()
 	{
 		Parent::clear();
+		clearFreeList();
+	}
+	/// \brief Clear the table, but keep the memory allocated for reuse
+	/// \param[in] maxAllocSize maximum number of elements kept allocated, 0 for no limit
+	void reset( SIZETYPE maxAllocSize=0)
+	{
+		Parent::reset( maxAllocSize);
+		clearFreeList();
+	}
+
+	/// \brief Get the head of the free list (for serialization)
+	SIZETYPE freelistidx() const
+	{
+#ifdef STRUS_CHECK_FREE_ITEMS
+		return 0;
+#else
+		return m_freelistidx;
+#endif
+	}
+	/// \brief Make the table reference a block of elements not owned by it (e.g. in a read only mapped image)
+	/// \note The elements are copied on the first write as described in PodStructArrayBase::attach
+	void attach( const ELEMTYPE* ar_, SIZETYPE size_, SIZETYPE freelistidx_)
+	{
+		Parent::attach( ar_, size_);
 #ifdef STRUS_CHECK_FREE_ITEMS
 		m_free_elemtab.clear();
 #else
-		m_freelistidx = 0;
+		m_freelistidx = freelistidx_;
 #endif
 #ifdef STRUS_CHECK_USED_ITEMS
-		m_used_size = 0;
+		m_used_size = size_;
 #endif
 	}
 
@@ -169,6 +193,19 @@ public:
 #endif
 	}
 
+private:
+	void clearFreeList()
+	{
+#ifdef STRUS_CHECK_FREE_ITEMS
+		m_free_elemtab.clear();
+#else
+		m_freelistidx = 0;
+#endif
+#ifdef STRUS_CHECK_USED_ITEMS
+		m_used_size = 0;
+#endif
+	}
+
 private:
 #ifdef STRUS_CHECK_FREE_ITEMS
 	std::set<SIZETYPE> m_free_elemtab;
@@ -7,7 +7,11 @@
  */
 
 #include "ruleMatcherAutomaton.hpp"
+#include "serialization.hpp"
+#include "eventScan.hpp"
 #include "strus/base/malloc.hpp"
+#include "strus/base/thread.hpp"
+#include "strus/reference.hpp"
 #include <limits>
 #include <cstdlib>
 #include <stdexcept>
@@ -17,10 +21,6 @@
 #include <stdint.h>
 
 #if !defined (__APPLE__) && !defined(__FreeBSD__) && !defined(__OpenBSD__) && !defined(_WIN32) && UINTPTR_MAX != 0xffffffff && !defined(__clang__) 
-#ifdef __SSE__
-#include <emmintrin.h>
-#define STRUS_USE_SSE_SCAN_TRIGGERS
-#endif
 #define HAVE_BUILTIN_ASSUME_ALIGNED
 #endif
 
@@ -39,10 +39,17 @@ static inline uint32_t evhash( uint32_t a)
 	return a;
 }
 
-EventTriggerTable::EventTriggerTable()
-	:m_nofTriggers(0){}
+static inline uint32_t chainhash( uint32_t a)
+{
+	a *= 2654435761U;
+	return a ^ (a >> 16);
+}
+
+EventTriggerTable::EventTriggerTable( bool useHashIndex_)
+	:m_nofTriggers(0),m_useHashIndex(useHashIndex_),m_chainTable(),m_nofChains(0),m_chainLinkAr(){}
 EventTriggerTable::EventTriggerTable( const EventTriggerTable& o)
 	:m_triggerTab(o.m_triggerTab),m_nofTriggers(o.m_nofTriggers)
+	,m_useHashIndex(o.m_useHashIndex),m_chainTable(o.m_chainTable),m_nofChains(o.m_nofChains),m_chainLinkAr(o.m_chainLinkAr)
 {
 	std::size_t htidx=0;
 	for (; htidx != EventHashTabSize; ++htidx)
@@ -57,6 +64,7 @@ EventTriggerTable::EventTriggerTable( const EventTriggerTable& o)
 		std::memcpy( rec.m_eventAr, rec_o.m_eventAr, rec_o.m_size * sizeof(*rec.m_eventAr));
 		std::memcpy( rec.m_ar, rec_o.m_ar, rec_o.m_size * sizeof(*rec.m_ar));
 		rec.m_size = rec_o.m_size;
+		rec.m_nofRemoved = rec_o.m_nofRemoved;
 	}
 }
 
@@ -64,7 +72,7 @@ EventTriggerTable::TriggerInd::~TriggerInd()
 {
 	if (m_eventAr)
 	{
-		std::free( m_eventAr);
+		strus::aligned_free( m_eventAr);
 	}
 	if (m_ar)
 	{
@@ -79,6 +87,19 @@ void EventTriggerTable::TriggerInd::clear()
 	std::memset( this, 0, sizeof(*this));
 }
 
+void EventTriggerTable::TriggerInd::reset( uint32_t maxAllocSize)
+{
+	if (maxAllocSize && m_allocsize > maxAllocSize)
+	{
+		clear();
+	}
+	else
+	{
+		m_size = 0;
+		m_nofRemoved = 0;
+	}
+}
+
 enum {EventArrayMemoryAlignment=64};
 void EventTriggerTable::TriggerInd::expand( uint32_t newallocsize)
 {
@@ -103,6 +124,115 @@ void EventTriggerTable::clear()
 	for (;  hi != he; ++hi) m_triggerIndAr[hi].clear();
 	m_triggerTab.clear();
 	m_nofTriggers = 0;
+	m_chainTable.clear();
+	m_nofChains = 0;
+	m_chainLinkAr.clear();
+}
+
+void EventTriggerTable::reset( uint32_t maxAllocSize)
+{
+	std::size_t hi = 0, he = EventHashTabSize;
+	for (;  hi != he; ++hi) m_triggerIndAr[hi].reset( maxAllocSize);
+	m_triggerTab.reset( maxAllocSize);
+	m_nofTriggers = 0;
+	if (maxAllocSize && m_chainTable.size() > maxAllocSize)
+	{
+		std::vector<EventTriggerChain>().swap( m_chainTable);
+	}
+	else if (!m_chainTable.empty())
+	{
+		// ... keep the size of the hash table, a power of 2, with all slots empty:
+		std::memset( &m_chainTable[0], 0, m_chainTable.size() * sizeof(EventTriggerChain));
+	}
+	m_nofChains = 0;
+	if (maxAllocSize && m_chainLinkAr.capacity() > maxAllocSize)
+	{
+		std::vector<EventTriggerChainLink>().swap( m_chainLinkAr);
+	}
+	else
+	{
+		m_chainLinkAr.clear();
+	}
+}
+
+uint32_t EventTriggerTable::findChain( uint32_t event) const
+{
+	if (m_chainTable.empty()) return 0;
+	uint32_t mask = m_chainTable.size()-1;
+	uint32_t htidx = chainhash( event) & mask;
+	while (m_chainTable[ htidx].event)
+	{
+		if (m_chainTable[ htidx].event == event) return htidx+1;
+		htidx = (htidx + 1) & mask;
+	}
+	return 0;
+}
+
+void EventTriggerTable::rehashChainTable( uint32_t newsize)
+{
+	EventTriggerChain empty;
+	std::memset( &empty, 0, sizeof(empty));
+	std::vector<EventTriggerChain> oldtable( newsize, empty);
+	oldtable.swap( m_chainTable);
+	uint32_t mask = newsize-1;
+	std::vector<EventTriggerChain>::const_iterator ci = oldtable.begin(), ce = oldtable.end();
+	for (; ci != ce; ++ci)
+	{
+		if (!ci->event) continue;
+		uint32_t htidx = chainhash( ci->event) & mask;
+		while (m_chainTable[ htidx].event)
+		{
+			htidx = (htidx + 1) & mask;
+		}
+		m_chainTable[ htidx] = *ci;
+	}
+}
+
+uint32_t EventTriggerTable::getOrCreateChain( uint32_t event)
+{
+	// Keep the fill factor of the hash table below 1/2:
+	if ((m_nofChains + 1) * 2 > m_chainTable.size())
+	{
+		if (m_chainTable.size() >= (1U<<31))
+		{
+			throw std::runtime_error(_TXT("too many elements in event trigger table"));
+		}
+		rehashChainTable( m_chainTable.empty() ? (uint32_t)InitChainTableSize : (uint32_t)m_chainTable.size() * 2);
+	}
+	uint32_t mask = m_chainTable.size()-1;
+	uint32_t htidx = chainhash( event) & mask;
+	while (m_chainTable[ htidx].event)
+	{
+		if (m_chainTable[ htidx].event == event) return htidx;
+		htidx = (htidx + 1) & mask;
+	}
+	EventTriggerChain& chain = m_chainTable[ htidx];
+	chain.event = event;
+	chain.head = 0;
+	chain.tail = 0;
+	chain.size = 0;
+	++m_nofChains;
+	return htidx;
+}
+
+void EventTriggerTable::removeChain( uint32_t chainidx)
+{
+	// Backward shift deletion, the table has no tombstones:
+	uint32_t mask = m_chainTable.size()-1;
+	uint32_t hole = chainidx;
+	uint32_t next = (hole + 1) & mask;
+	while (m_chainTable[ next].event)
+	{
+		uint32_t home = chainhash( m_chainTable[ next].event) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask))
+		{
+			m_chainTable[ hole] = m_chainTable[ next];
+			hole = next;
+		}
+		next = (next + 1) & mask;
+	}
+	std::memset( &m_chainTable[ hole], 0, sizeof(EventTriggerChain));
+	--m_nofChains;
 }
 
 static inline uint32_t linkid( uint32_t htidx, uint32_t elidx)
@@ -113,6 +243,37 @@ static inline uint32_t linkid( uint32_t htidx, uint32_t elidx)
 
 uint32_t EventTriggerTable::add( const EventTrigger& et)
 {
+	if (m_useHashIndex)
+	{
+		// The link of the trigger is the event in case of the hash index:
+		uint32_t chainidx = et.event ? getOrCreateChain( et.event) : 0;
+		uint32_t rt = m_triggerTab.add( LinkedTrigger( et.event, et.trigger));
+		uint32_t tidx = rt - m_triggerTab.first();
+		if (m_chainLinkAr.size() <= tidx)
+		{
+			m_chainLinkAr.resize( tidx+1);
+		}
+		EventTriggerChainLink& lnk = m_chainLinkAr[ tidx];
+		lnk.prev = 0;
+		lnk.next = 0;
+		if (et.event)
+		{
+			EventTriggerChain& chain = m_chainTable[ chainidx];
+			lnk.prev = chain.tail;
+			if (chain.tail)
+			{
+				m_chainLinkAr[ chain.tail-1].next = tidx+1;
+			}
+			else
+			{
+				chain.head = tidx+1;
+			}
+			chain.tail = tidx+1;
+			++chain.size;
+		}
+		++m_nofTriggers;
+		return rt;
+	}
 	uint32_t htidx = evhash( et.event) & EventHashTabIdxMask;
 	TriggerInd& rec = m_triggerIndAr[ htidx];
 	if (rec.m_size == rec.m_allocsize)
@@ -132,6 +293,48 @@ uint32_t EventTriggerTable::add( const EventTrigger& et)
 
 void EventTriggerTable::remove( uint32_t idx)
 {
+	if (m_useHashIndex)
+	{
+		uint32_t event = m_triggerTab[ idx].link;
+		uint32_t tidx = idx - m_triggerTab.first();
+		if (tidx >= m_chainLinkAr.size())
+		{
+			throw std::runtime_error( _TXT("bad trigger index (remove trigger)"));
+		}
+		if (event)
+		{
+			uint32_t chainidx = findChain( event);
+			if (!chainidx)
+			{
+				throw std::runtime_error( _TXT("bad trigger index (remove trigger)"));
+			}
+			EventTriggerChain& chain = m_chainTable[ chainidx-1];
+			const EventTriggerChainLink& lnk = m_chainLinkAr[ tidx];
+			if (lnk.prev)
+			{
+				m_chainLinkAr[ lnk.prev-1].next = lnk.next;
+			}
+			else
+			{
+				chain.head = lnk.next;
+			}
+			if (lnk.next)
+			{
+				m_chainLinkAr[ lnk.next-1].prev = lnk.prev;
+			}
+			else
+			{
+				chain.tail = lnk.prev;
+			}
+			if (--chain.size == 0)
+			{
+				removeChain( chainidx-1);
+			}
+		}
+		m_triggerTab.remove( idx);
+		--m_nofTriggers;
+		return;
+	}
 	uint32_t link = m_triggerTab[ idx].link;
 	uint32_t htidx = (link >> EventHashTabIdxShift) & EventHashTabIdxMask;
 	uint32_t aridx = link & ((1 << EventHashTabIdxShift) -1);
@@ -141,19 +344,48 @@ void EventTriggerTable::remove( uint32_t idx)
 		throw std::runtime_error( _TXT("bad trigger index (remove trigger)"));
 	}
 	m_triggerTab.remove( idx);
-	if (aridx != rec.m_size - 1)
+	// The element is not replaced by the last one, because the order of the triggers of an event must not depend
+	// on the removal of other triggers. It is marked as removed instead:
+	rec.m_eventAr[ aridx] = 0;
+	rec.m_ar[ aridx] = 0;
+	++rec.m_nofRemoved;
+	while (rec.m_size && !rec.m_ar[ rec.m_size-1])
+	{
+		--rec.m_size;
+		--rec.m_nofRemoved;
+	}
+	if (rec.m_nofRemoved > BlockSize && rec.m_nofRemoved * 2 > rec.m_size)
 	{
-		rec.m_eventAr[ aridx] = rec.m_eventAr[ rec.m_size-1];
-		rec.m_ar[ aridx] = rec.m_ar[ rec.m_size-1];
-		m_triggerTab[ rec.m_ar[ aridx]].link = link;
+		compactTriggerInd( htidx);
 	}
-	--rec.m_size;
 	--m_nofTriggers;
 }
 
+void EventTriggerTable::compactTriggerInd( uint32_t htidx)
+{
+	TriggerInd& rec = m_triggerIndAr[ htidx];
+	uint32_t ri = 0, wi = 0;
+	for (; ri != rec.m_size; ++ri)
+	{
+		if (rec.m_ar[ ri])
+		{
+			if (wi != ri)
+			{
+				rec.m_eventAr[ wi] = rec.m_eventAr[ ri];
+				rec.m_ar[ wi] = rec.m_ar[ ri];
+				m_triggerTab[ rec.m_ar[ wi]].link = linkid( htidx, wi);
+			}
+			++wi;
+		}
+	}
+	rec.m_size = wi;
+	rec.m_nofRemoved = 0;
+}
+
 uint32_t EventTriggerTable::getTriggerEventId( uint32_t triggeridx) const
 {
 	uint32_t link = m_triggerTab[ triggeridx].link;
+	if (m_useHashIndex) return link;
 	uint32_t htidx = (link >> EventHashTabIdxShift) & EventHashTabIdxMask;
 	uint32_t aridx = link & ((1 << EventHashTabIdxShift) -1);
 	return m_triggerIndAr[ htidx].m_eventAr[ aridx];
@@ -165,94 +397,45 @@ Trigger const* EventTriggerTable::getTriggerPtr( uint32_t idx) const
 	return &m_triggerTab[ idx].trigger;
 }
 
-#ifdef STRUS_USE_SSE_SCAN_TRIGGERS
-inline std::ostream & operator << (std::ostream& out, const __v4si & val)
-{
-	const uint32_t* vals;
-	vals = (const uint32_t*)&val;
-	return out << "[" << vals[0] << ", " << vals[1] << ", " << vals[2]
-				<< ", " << vals[3] << "]";
-}
-
-///\brief Linear search for triggers to fire on an event with help of SSE vectorization
-///\note This SIMD vectorization implementation with SSE was inspired by https://schani.wordpress.com/tag/c-optimization-linear-binary-search-sse2-simd
-static inline void getTriggers_SSE4( Trigger const** results, std::size_t& nofresults, uint32_t event, const uint32_t* eventar, const uint32_t* triggerindar, const LinkedTriggerTable& triggertab, std::size_t arsize)
+void EventTriggerTable::getTriggers( TriggerRefList& triggers, TriggerIndexList& indexbuf, uint32_t event) const
 {
-	__v4si *eventblkar = (__v4si*)eventar;		//... the SIMD search block (aligned to EventArrayMemoryAlignment byte blocks)
-	uint32_t ii = 0;				//... index on 16 word blocks we handle with SSE
-	uint32_t nn = ((uint32_t)arsize >> 4) << 2;	//... number of 16 word blocks we handle with SSE
-	// We prepare the SIMD search key vector as 4 times the value of the needle
-	__v4si event4 = (__v4si)_mm_set_epi32( event, event, event, event);
-
-	for (;ii<nn; ii+=4)
-	{
-		// Compare 4 times 4 words = 16 32 bit uints and store the results in cmp[i].
-		// cmp[i]: each [i] are 4 32 bit words, 0xFFffFFff true, 0x00000000 false:
-		__v4si cmp0 = __builtin_ia32_pcmpeqd128( event4, eventblkar[ ii + 0]);
-		__v4si cmp1 = __builtin_ia32_pcmpeqd128( event4, eventblkar[ ii + 1]);
-		__v4si cmp2 = __builtin_ia32_pcmpeqd128( event4, eventblkar[ ii + 2]);
-		__v4si cmp3 = __builtin_ia32_pcmpeqd128( event4, eventblkar[ ii + 3]);
-		// Pack two times the lo word (with sign) of 4 32 bit words into 8 * 16 bit words:
-		__v8hi pack01 = __builtin_ia32_packssdw128 (cmp0, cmp1);
-		// Pack two times the lo word (with sign) of 4 32 bit words into 8 * 16 bit words:
-		__v8hi pack23 = __builtin_ia32_packssdw128 (cmp2, cmp3);
-		// Pack two times the lo byte (with sign) of 8 16 bit words into 16 bytes:
-		__v16qi pack0123 = __builtin_ia32_packsswb128 (pack01, pack23);
-
-		// Pack the most significant bit of 16 bytes into a 16 bit word:
-		uint16_t res = __builtin_ia32_pmovmskb128( pack0123);
-		while (res)
-		{
-			// ... while there is a bit, that points to a match,
-			// get trailing bit index into 'tz':
-			uint8_t tz = __builtin_ctz( res);
-			// Evaluate the index of the corresponding match:
-			uint32_t idx = (ii << 2) + tz;
-			// and append it to the result (list of triggers fired by the event):
-			results[ nofresults++] = &triggertab[ triggerindar[ idx]].trigger;
-			// and mask out the visited match from the mask with the matches:
-			res ^= (1 << tz);
-		}
-	}
-	// The rest of the events modulo 16, we handle in the standard way:
-	ii <<= 2;
-	for (; ii < arsize; ++ii)
+	// The following implementation looks a little bit funny, but it is 
+	// crucial for the overall performance that this method is vectorizable.
+	if (!event) return;
+	if (m_useHashIndex)
 	{
-		if (eventar[ii] == event)
+		uint32_t chainidx = findChain( event);
+		if (!chainidx) return;
+		const EventTriggerChain& chain = m_chainTable[ chainidx-1];
+		Trigger const** tar = triggers.reserve( chain.size);
+		std::size_t nofresults = 0;
+		uint32_t tl = chain.head;
+		while (tl)
 		{
-			results[ nofresults++] = &triggertab[ triggerindar[ ii]].trigger;
+			tar[ nofresults++] = &m_triggerTab[ tl-1 + m_triggerTab.first()].trigger;
+			tl = m_chainLinkAr[ tl-1].next;
 		}
+		triggers.commit_reserved( nofresults);
+		return;
 	}
-}
-#endif
-
-void EventTriggerTable::getTriggers( TriggerRefList& triggers, uint32_t event) const
-{
-	// The following implementation looks a little bit funny, but it is 
-	// crucial for the overall performance that this method is vectorizable.
-	if (!event) return;
 	uint32_t htidx = evhash( event) & EventHashTabIdxMask;
 	const TriggerInd& rec = m_triggerIndAr[ htidx];
 	Trigger const** tar = triggers.reserve( rec.m_size);
-	std::size_t nofresults = 0;
 
 #if __GNUC__ >= 4 && defined(HAVE_BUILTIN_ASSUME_ALIGNED)
 	const uint32_t* eventAr = (const uint32_t*)__builtin_assume_aligned( rec.m_eventAr, EventArrayMemoryAlignment);
 #else
 	const uint32_t* eventAr = rec.m_eventAr;
 #endif
-#ifdef STRUS_USE_SSE_SCAN_TRIGGERS
-	getTriggers_SSE4( tar, nofresults, event, eventAr, rec.m_ar, m_triggerTab, rec.m_size);
-#else
-	uint32_t wi=0;
-	for (; wi<rec.m_size; ++wi)
+	// The scan kernel (SIMD, selected by the CPU features) writes the indices of the matching events
+	// into the index buffer, they are mapped to the trigger pointers in a second pass:
+	uint32_t* idxar = indexbuf.reserve( rec.m_size);
+	std::size_t nofresults = eventScan( idxar, event, eventAr, rec.m_size);
+	std::size_t ri = 0;
+	for (; ri < nofresults; ++ri)
 	{
-		if (eventAr[ wi] == event)
-		{
-			tar[ nofresults++] = &m_triggerTab[ rec.m_ar[ wi]].trigger;
-		}
+		tar[ ri] = &m_triggerTab[ rec.m_ar[ idxar[ ri]]].trigger;
 	}
-#endif
 	triggers.commit_reserved( nofresults);
 }
 
@@ -267,6 +450,7 @@ void ProgramTable::defineEventFrequency( uint32_t eventid, double df)
 
 uint32_t ProgramTable::createProgram( uint32_t positionRange_, const ActionSlotDef& actionSlotDef_)
 {
+	m_compiled = false;
 	return 1+m_programMap.add( Program( positionRange_, actionSlotDef_));
 }
 
@@ -274,7 +458,6 @@ void ProgramTable::createTrigger( uint32_t programidx, uint32_t event, bool isKe
 {
 	Program& program = m_programMap[ programidx-1];
 	m_triggerList.push( program.triggerListIdx, TriggerDef( event, isKeyEvent, sigtype, sigval, variable));
-	m_eventOccurrenceMap[ event] += 1;
 }
 
 void ProgramTable::doneProgram( uint32_t programidx)
@@ -329,6 +512,19 @@ void ProgramTable::defineEventProgram( uint32_t eventid, uint32_t programidx)
 
 uint32_t ProgramTable::getEventProgramList( uint32_t eventid) const
 {
+	if (m_compiled)
+	{
+		if (m_eventProgramIndex.size() == 0) return 0;
+		uint32_t mask = m_eventProgramIndex.size()-1;
+		const EventProgramIndexElem* ar = m_eventProgramIndex.data();
+		uint32_t htidx = evhash( eventid) & mask;
+		while (ar[ htidx].programlist)
+		{
+			if (ar[ htidx].eventid == eventid) return ar[ htidx].programlist;
+			htidx = (htidx + 1) & mask;
+		}
+		return 0;
+	}
 	EventProgamTriggerMap::const_iterator ei = m_eventProgamTriggerMap.find( eventid);
 	return ei == m_eventProgamTriggerMap.end() ? 0:ei->second;
 }
@@ -338,18 +534,241 @@ const ProgramTrigger* ProgramTable::nextProgramPtr( uint32_t& programlist) const
 	return m_programTriggerList.nextptr( programlist);
 }
 
+static bool compareEventProgramIndexElem( const EventProgramIndexElem& aa, const EventProgramIndexElem& bb)
+{
+	return aa.eventid < bb.eventid;
+}
+
+void ProgramTable::getEventProgramLists( std::vector<EventProgramIndexElem>& res) const
+{
+	res.clear();
+	if (m_compiled)
+	{
+		EventProgramIndex::const_iterator ii = m_eventProgramIndex.begin(), ie = m_eventProgramIndex.end();
+		for (; ii != ie; ++ii)
+		{
+			if (ii->programlist) res.push_back( *ii);
+		}
+	}
+	else
+	{
+		EventProgamTriggerMap::const_iterator ei = m_eventProgamTriggerMap.begin(), ee = m_eventProgamTriggerMap.end();
+		for (; ei != ee; ++ei)
+		{
+			EventProgramIndexElem elem;
+			elem.eventid = ei->first;
+			elem.programlist = ei->second;
+			res.push_back( elem);
+		}
+	}
+	std::sort( res.begin(), res.end(), compareEventProgramIndexElem);
+}
+
+void ProgramTableShard::getEventPrograms( uint32_t eventid, const ProgramTrigger*& itr, const ProgramTrigger*& end) const
+{
+	itr = end = 0;
+	if (m_index.empty()) return;
+	uint32_t mask = m_index.size()-1;
+	uint32_t htidx = evhash( eventid) & mask;
+	while (m_index[ htidx].size)
+	{
+		if (m_index[ htidx].eventid == eventid)
+		{
+			itr = &m_programs[ m_index[ htidx].start];
+			end = itr + m_index[ htidx].size;
+			return;
+		}
+		htidx = (htidx + 1) & mask;
+	}
+}
+
+void ProgramTableShard::addEventPrograms( uint32_t eventid, const std::vector<ProgramTrigger>& programs, const std::vector<uint32_t>& ranks)
+{
+	m_index.push_back( IndexElem( eventid, m_programs.size(), programs.size()));
+	m_programs.insert( m_programs.end(), programs.begin(), programs.end());
+	m_programRanks.insert( m_programRanks.end(), ranks.begin(), ranks.end());
+}
+
+void ProgramTableShard::buildIndex()
+{
+	// Rebuild the list of index elements appended by addEventPrograms as open addressing hash table with a fill factor of at most 1/2:
+	std::vector<IndexElem> elems;
+	elems.swap( m_index);
+	uint32_t indexsize = 16;
+	while (indexsize < elems.size() * 2) indexsize *= 2;
+	uint32_t mask = indexsize-1;
+	m_index.resize( indexsize, IndexElem( 0, 0, 0));
+
+	std::vector<IndexElem>::const_iterator ei = elems.begin(), ee = elems.end();
+	for (; ei != ee; ++ei)
+	{
+		uint32_t htidx = evhash( ei->eventid) & mask;
+		while (m_index[ htidx].size)
+		{
+			htidx = (htidx + 1) & mask;
+		}
+		m_index[ htidx] = *ei;
+	}
+}
+
+static uint32_t findSetRoot( std::vector<uint32_t>& parent, uint32_t idx)
+{
+	uint32_t root = idx;
+	while (parent[ root] != root) root = parent[ root];
+	while (parent[ idx] != root)
+	{
+		uint32_t next = parent[ idx];
+		parent[ idx] = root;
+		idx = next;
+	}
+	return root;
+}
+
+static void joinSets( std::vector<uint32_t>& parent, uint32_t aa, uint32_t bb)
+{
+	uint32_t ra = findSetRoot( parent, aa);
+	uint32_t rb = findSetRoot( parent, bb);
+	if (ra < rb) parent[ rb] = ra; else parent[ ra] = rb;
+}
+
+/// \brief Order of connected sets of programs for assigning them to shards: descending by weight, then ascending by root
+struct ProgramSetOrder
+{
+	const std::vector<uint32_t>* weight;
+
+	explicit ProgramSetOrder( const std::vector<uint32_t>* weight_)
+		:weight(weight_){}
+	bool operator()( uint32_t aa, uint32_t bb) const
+	{
+		if ((*weight)[ aa] != (*weight)[ bb]) return (*weight)[ aa] > (*weight)[ bb];
+		return aa < bb;
+	}
+};
+
+void ProgramTableShard::createShards( std::vector<ProgramTableShard>& res, const ProgramTable& table, unsigned int nofShards, uint32_t derivedEventMask)
+{
+	res.clear();
+	if (nofShards == 0) return;
+	uint32_t nofPrograms = table.nofPrograms();
+	uint32_t programBase = table.firstProgram()-1;	//... the sets are indexed by program index - programBase
+
+	// Join the programs issuing or consuming the same derived event to connected sets (union find):
+	std::vector<uint32_t> parent( nofPrograms+1);
+	std::vector<uint32_t> weight( nofPrograms+1, 0);
+	uint32_t pi = 0;
+	for (; pi <= nofPrograms; ++pi) parent[ pi] = pi;
+
+	std::vector<EventProgramIndexElem> eventProgramLists;
+	table.getEventProgramLists( eventProgramLists);
+
+	FlatEventMap<uint32_t> eventProgramMap;		//... map event -> first set with the event, 0 if none
+	std::vector<EventProgramIndexElem>::const_iterator ei = eventProgramLists.begin(), ee = eventProgramLists.end();
+	for (; ei != ee; ++ei)
+	{
+		if (ei->eventid & derivedEventMask)
+		{
+			uint32_t programlist = ei->programlist;
+			const ProgramTrigger* programTrigger;
+			while (0!=(programTrigger=table.nextProgramPtr( programlist)))
+			{
+				uint32_t setidx = programTrigger->programidx - programBase;
+				uint32_t& first = eventProgramMap[ ei->eventid];
+				if (first) joinSets( parent, setidx, first); else first = setidx;
+			}
+		}
+	}
+	for (pi = 1; pi <= nofPrograms; ++pi)
+	{
+		const Program& program = table[ programBase + pi];
+		weight[ pi] = 1;
+		if (program.slotDef.event & derivedEventMask)
+		{
+			uint32_t& first = eventProgramMap[ program.slotDef.event];
+			if (first) joinSets( parent, pi, first); else first = pi;
+		}
+		uint32_t triggerListItr = program.triggerListIdx;
+		const TriggerDef* triggerDef;
+		while (0!=(triggerDef=table.triggerList().nextptr( triggerListItr)))
+		{
+			weight[ pi] += 1;
+			if (triggerDef->event & derivedEventMask)
+			{
+				uint32_t& first = eventProgramMap[ triggerDef->event];
+				if (first) joinSets( parent, pi, first); else first = pi;
+			}
+		}
+	}
+	// Accumulate the weights of the sets and assign the sets to the shards, the heaviest set first to the shard with the lowest load:
+	std::vector<uint32_t> setWeight( nofPrograms+1, 0);
+	std::vector<uint32_t> roots;
+	for (pi = 1; pi <= nofPrograms; ++pi)
+	{
+		uint32_t root = findSetRoot( parent, pi);
+		if (root == pi) roots.push_back( root);
+		setWeight[ root] += weight[ pi];
+	}
+	std::sort( roots.begin(), roots.end(), ProgramSetOrder( &setWeight));
+	if (nofShards > roots.size()) nofShards = roots.size();
+	if (nofShards == 0) return;
+
+	std::vector<uint32_t> shardLoad( nofShards, 0);
+	std::vector<uint32_t> rootShard( nofPrograms+1, 0);
+	std::vector<uint32_t>::const_iterator ri = roots.begin(), re = roots.end();
+	for (; ri != re; ++ri)
+	{
+		std::size_t si = std::min_element( shardLoad.begin(), shardLoad.end()) - shardLoad.begin();
+		shardLoad[ si] += setWeight[ *ri];
+		rootShard[ *ri] = si;
+	}
+	// Build the program lists of the events for each shard, keeping the order of the programs in the lists of the table:
+	res.resize( nofShards);
+	for (pi = 1; pi <= nofPrograms; ++pi)
+	{
+		res[ rootShard[ findSetRoot( parent, pi)]].m_nofPrograms += 1;
+	}
+	std::vector<std::vector<ProgramTrigger> > shardPrograms( nofShards);
+	std::vector<std::vector<uint32_t> > shardProgramRanks( nofShards);
+	for (ei = eventProgramLists.begin(); ei != ee; ++ei)
+	{
+		uint32_t programlist = ei->programlist;
+		const ProgramTrigger* programTrigger;
+		uint32_t rank = 0;
+		for (; 0!=(programTrigger=table.nextProgramPtr( programlist)); ++rank)
+		{
+			std::size_t si = rootShard[ findSetRoot( parent, programTrigger->programidx - programBase)];
+			shardPrograms[ si].push_back( *programTrigger);
+			shardProgramRanks[ si].push_back( rank);
+		}
+		std::size_t si = 0;
+		for (; si != nofShards; ++si)
+		{
+			if (!shardPrograms[ si].empty())
+			{
+				res[ si].addEventPrograms( ei->eventid, shardPrograms[ si], shardProgramRanks[ si]);
+				shardPrograms[ si].clear();
+				shardProgramRanks[ si].clear();
+			}
+		}
+	}
+	std::vector<ProgramTableShard>::iterator si = res.begin(), se = res.end();
+	for (; si != se; ++si)
+	{
+		si->buildIndex();
+	}
+}
+
 double ProgramTable::calcEventWeight( uint32_t eventid) const
 {
 	double kf = 1.0;
-	FrequencyMap::const_iterator fi = m_frequencyMap.find( eventid);
-	if (fi != m_frequencyMap.end() && fi->second > 0.0)
+	const double* df = m_frequencyMap.find( eventid);
+	if (df && *df > 0.0)
 	{
-		kf = fi->second;
+		kf = *df;
 	}
-	EventOccurrenceMap::const_iterator ki = m_keyOccurrenceMap.find( eventid);
-	if (ki != m_keyOccurrenceMap.end() && ki->second > 0.0)
+	const uint32_t* ko = m_keyOccurrenceMap.find( eventid);
+	if (ko && *ko > 0.0)
 	{
-		kf *= ki->second;
+		kf *= *ko;
 	}
 	return kf;
 }
@@ -453,10 +872,10 @@ ProgramTable::Statistics ProgramTable::getProgramStatistics() const
 	for (; ei != ee; ++ei)
 	{
 		uint32_t eventid = ei->first;
-		EventOccurrenceMap::const_iterator ki = m_keyOccurrenceMap.find( eventid);
-		if (ki != m_keyOccurrenceMap.end())
+		const uint32_t* ko = m_keyOccurrenceMap.find( eventid);
+		if (ko)
 		{
-			koheap.push_back( ki->second);
+			koheap.push_back( *ko);
 		}
 	}
 	std::make_heap( koheap.begin(), koheap.end());
@@ -467,18 +886,23 @@ ProgramTable::Statistics ProgramTable::getProgramStatistics() const
 		koheap.pop_back();
 	}
 	// Get list of stop events:
-	std::set<uint32_t>::const_iterator si = m_stopWordSet.begin(), se = m_stopWordSet.end();
-	for (; si != se; ++si)
+	if (m_compiled)
+	{
+		rt.stopWordSet.insert( rt.stopWordSet.end(), m_stopWordList.data(), m_stopWordList.data() + m_stopWordList.size());
+	}
+	else
 	{
-		rt.stopWordSet.push_back( *si);
+		rt.stopWordSet.insert( rt.stopWordSet.end(), m_stopWordSet.begin(), m_stopWordSet.end());
 	}
 	return rt;
 }
 
 void ProgramTable::eliminateUnusedEvents()
 {
-	std::set<uint32_t> usedEvents;
-	std::set<uint32_t> programs;
+	// ... the programs are marked in an array indexed by program index, the events used are collected, sorted and made unique
+	std::vector<uint32_t> usedEvents;
+	uint32_t programBase = firstProgram();
+	std::vector<bool> programs( nofPrograms(), false);
 	EventProgamTriggerMap::const_iterator
 		ei = m_eventProgamTriggerMap.begin(),
 		ee = m_eventProgamTriggerMap.end();
@@ -488,27 +912,140 @@ void ProgramTable::eliminateUnusedEvents()
 		const ProgramTrigger* programTrigger;
 		while (0!=(programTrigger=m_programTriggerList.nextptr( prglist)))
 		{
-			programs.insert( programTrigger->programidx);
+			if (programs[ programTrigger->programidx - programBase]) continue;
+			programs[ programTrigger->programidx - programBase] = true;
 			const Program& program = m_programMap[ programTrigger->programidx-1];
 			uint32_t triggerlistitr = program.triggerListIdx;
 			const TriggerDef* trigger;
 			while (0!=(trigger = m_triggerList.nextptr( triggerlistitr)))
 			{
-				usedEvents.insert( trigger->event);
+				usedEvents.push_back( trigger->event);
 			}
 		}
 	}
-	std::set<uint32_t>::const_iterator gi = programs.begin(), ge = programs.end();
+	std::sort( usedEvents.begin(), usedEvents.end());
+	usedEvents.erase( std::unique( usedEvents.begin(), usedEvents.end()), usedEvents.end());
+	std::size_t gi = 0, ge = programs.size();
 	for (; gi != ge; ++gi)
 	{
-		Program& program = m_programMap[ *gi-1];
-		if (usedEvents.find( program.slotDef.event) == usedEvents.end())
+		if (!programs[ gi]) continue;
+		Program& program = m_programMap[ programBase + gi - 1];
+		if (!std::binary_search( usedEvents.begin(), usedEvents.end(), program.slotDef.event))
 		{
 			program.slotDef.event = 0;
 		}
 	}
 }
 
+void ProgramTable::calcAltEventList( AltEventList& res, uint32_t eventid) const
+{
+	EventProgamTriggerMap::const_iterator ei = m_eventProgamTriggerMap.find( eventid);
+	if (ei == m_eventProgamTriggerMap.end()) return;
+	uint32_t prglist = ei->second;
+	const ProgramTrigger* programTrigger;
+	while (0!=(programTrigger=m_programTriggerList.nextptr( prglist)))
+	{
+		const Program& program = m_programMap[ programTrigger->programidx-1];
+		res.push_back( AltEventElem( programTrigger->programidx, getAltEventId( eventid, program.triggerListIdx)));
+	}
+}
+
+/// \brief Worker evaluating the alternative key events for every n-th element of a list of events
+class ProgramTable::AltEventWorker
+{
+public:
+	AltEventWorker( const ProgramTable* programTable_, std::vector<AltEventList>* res_, const std::vector<uint32_t>* events_, std::size_t startidx_, std::size_t step_)
+		:m_programTable(programTable_),m_res(res_),m_events(events_),m_startidx(startidx_),m_step(step_),m_error(){}
+
+	void run()
+	{
+		try
+		{
+			std::size_t ei = m_startidx, ee = m_events->size();
+			for (; ei < ee; ei += m_step)
+			{
+				m_programTable->calcAltEventList( (*m_res)[ ei], (*m_events)[ ei]);
+			}
+		}
+		catch (const std::bad_alloc&)
+		{
+			m_error = _TXT("out of memory");
+		}
+		catch (const std::runtime_error& err)
+		{
+			m_error = err.what();
+		}
+	}
+
+	const std::string& error() const
+	{
+		return m_error;
+	}
+
+private:
+	const ProgramTable* m_programTable;
+	std::vector<AltEventList>* m_res;		//... each worker writes only its own elements
+	const std::vector<uint32_t>* m_events;
+	std::size_t m_startidx;
+	std::size_t m_step;
+	std::string m_error;
+};
+
+void ProgramTable::calcAltEventLists( std::vector<AltEventList>& res, const std::vector<uint32_t>& events, unsigned int nofThreads) const
+{
+	res.clear();
+	res.resize( events.size());
+	if (nofThreads <= 1 || events.size() <= 1)
+	{
+		std::size_t ei = 0, ee = events.size();
+		for (; ei != ee; ++ei)
+		{
+			calcAltEventList( res[ ei], events[ ei]);
+		}
+		return;
+	}
+	if (nofThreads > events.size()) nofThreads = events.size();
+
+	// The events are distributed round robin, because the sizes of the program lists are very skewed:
+	std::vector<AltEventWorker> workers;
+	workers.reserve( nofThreads);
+	std::size_t ti = 0;
+	for (; ti < nofThreads; ++ti)
+	{
+		workers.push_back( AltEventWorker( this, &res, &events, ti, nofThreads));
+	}
+	std::vector<strus::Reference<strus::thread> > threadGroup;
+	threadGroup.reserve( nofThreads);
+	try
+	{
+		for (ti=1; ti < nofThreads; ++ti)
+		{
+			threadGroup.push_back( strus::Reference<strus::thread>( new strus::thread( &AltEventWorker::run, &workers[ ti])));
+		}
+	}
+	catch (const std::exception&)
+	{
+		// ... if a thread could not be started, its work is done in the calling thread
+	}
+	workers[0].run();
+	std::size_t wi = threadGroup.size()+1;
+	for (; wi < nofThreads; ++wi)
+	{
+		workers[ wi].run();
+	}
+	std::vector<strus::Reference<strus::thread> >::iterator gi = threadGroup.begin(), ge = threadGroup.end();
+	for (; gi != ge; ++gi) (*gi)->join();
+
+	std::vector<AltEventWorker>::const_iterator oi = workers.begin(), oe = workers.end();
+	for (; oi != oe; ++oi)
+	{
+		if (!oi->error().empty())
+		{
+			throw strus::runtime_error( _TXT("error in thread evaluating alternative key events: %s"), oi->error().c_str());
+		}
+	}
+}
+
 void ProgramTable::optimize( OptimizeOptions& opt)
 {
 	eliminateUnusedEvents();
@@ -523,18 +1060,24 @@ void ProgramTable::optimize( OptimizeOptions& opt)
 		{
 			uint32_t eventid = ei->first;
 	
-			EventOccurrenceMap::const_iterator ki = m_keyOccurrenceMap.find( eventid);
-			if (ki != m_keyOccurrenceMap.end()
-			&&  ki->second >= (float)m_totalNofPrograms * opt.stopwordOccurrenceFactor)
+			const uint32_t* ko = m_keyOccurrenceMap.find( eventid);
+			if (ko
+			&&  *ko >= (float)m_totalNofPrograms * opt.stopwordOccurrenceFactor)
 			{
 				eventsToMove.push_back( eventid);
 			}
 		}
 	}
+	// Evaluate the alternative key events of the programs of all candidates in advance, possibly in parallel.
+	// getAltEventId depends only on the trigger definitions, that are not changed by the optimization.
+	// The following sequential pass takes the precalculated values and is therefore identical to the evaluation without:
+	std::vector<AltEventList> altEventLists;
+	calcAltEventLists( altEventLists, eventsToMove, opt.nofThreads);
+
 	// Get the event list of the event candidate, check for an alternative key events,
 	// replace the program list of the event:
 	std::vector<uint32_t>::const_iterator mi = eventsToMove.begin(), me = eventsToMove.end();
-	for (; mi != me; ++mi)
+	for (std::size_t midx=0; mi != me; ++mi,++midx)
 	{
 		// Build a new program list for each visited event. Because alternativeEventId does not
 		// return the identity, we can just add the new relations and replace the old
@@ -546,12 +1089,24 @@ void ProgramTable::optimize( OptimizeOptions& opt)
 		uint32_t prglist = ei->second;
 		uint32_t new_prglist = 0;
 		double weight = calcEventWeight( eventid);
+		const AltEventList& altEventList = altEventLists[ midx];
+		AltEventList::const_iterator ai = altEventList.begin(), ae = altEventList.end();
 
 		const ProgramTrigger* programTrigger;
 		while (0!=(programTrigger=m_programTriggerList.nextptr( prglist)))
 		{
 			Program& program = m_programMap[ programTrigger->programidx-1];
-			uint32_t alt_eventid = getAltEventId( eventid, program.triggerListIdx);
+			uint32_t alt_eventid;
+			if (ai != ae && ai->programidx == programTrigger->programidx)
+			{
+				alt_eventid = ai->alt_eventid;
+				++ai;
+			}
+			else
+			{
+				// ... program added to the list of this event by the optimization of another event before
+				alt_eventid = getAltEventId( eventid, program.triggerListIdx);
+			}
 			if (!alt_eventid)
 			{
 				m_programTriggerList.push( new_prglist, *programTrigger);
@@ -583,26 +1138,281 @@ void ProgramTable::optimize( OptimizeOptions& opt)
 			m_eventProgamTriggerMap.erase( ei);
 		}
 	}
+	buildCompiledStructures();
 }
 
+void ProgramTable::buildCompiledStructures()
+{
+	// Build the map of events to program lists as open addressing hash table with a fill factor of at most 1/2:
+	uint32_t indexsize = 16;
+	while (indexsize < m_eventProgamTriggerMap.size() * 2) indexsize *= 2;
+	uint32_t mask = indexsize-1;
+
+	EventProgramIndexElem empty;
+	empty.eventid = 0;
+	empty.programlist = 0;
+	m_eventProgramIndex.clear();
+	for (uint32_t ii=0; ii<indexsize; ++ii)
+	{
+		m_eventProgramIndex.add( empty);
+	}
+	EventProgamTriggerMap::const_iterator
+		ei = m_eventProgamTriggerMap.begin(),
+		ee = m_eventProgamTriggerMap.end();
+	for (; ei != ee; ++ei)
+	{
+		uint32_t htidx = evhash( ei->first) & mask;
+		while (m_eventProgramIndex[ htidx].programlist)
+		{
+			htidx = (htidx + 1) & mask;
+		}
+		m_eventProgramIndex[ htidx].eventid = ei->first;
+		m_eventProgramIndex[ htidx].programlist = ei->second;
+	}
+	// Build the sorted list of stop words:
+	m_stopWordList.clear();
+	FlatEventSet::const_iterator si = m_stopWordSet.begin(), se = m_stopWordSet.end();
+	for (; si != se; ++si)
+	{
+		m_stopWordList.add( *si);
+	}
+	buildStopWordBitmap();
+	m_compiled = true;
+}
 
-StateMachine::StateMachine( const ProgramTable* programTable_, DebugTraceContextInterface* debugtrace_)
+void ProgramTable::buildStopWordBitmap()
+{
+	m_stopWordBitmap.clear();
+	m_stopWordRank.clear();
+	const uint32_t* sw = m_stopWordList.data();
+	const uint32_t* se = sw + m_stopWordList.size();
+	uint32_t pi = 0;
+	for (; pi < NofStopWordPartitions; ++pi)
+	{
+		// ... the stop word list is sorted, so the stop words of a partition are adjacent and the last one has the biggest index
+		StopWordBitmapPartition& part = m_stopWordBitmapPartition[ pi];
+		const uint32_t* pe = std::lower_bound( sw, se, (pi+1) << StopWordPartitionShift);
+		if (pi+1 == NofStopWordPartitions) pe = se;
+		part.ofs = m_stopWordBitmap.size();
+		part.size = (sw == pe) ? 0 : ((*(pe-1) & StopWordPartitionIndexMask) + 1);
+		part.searchList = (part.size > (uint32_t)MaxStopWordBitmapSize);
+		if (part.searchList)
+		{
+			part.size = 0;
+		}
+		else
+		{
+			m_stopWordBitmap.resize( part.ofs + ((part.size + 63) >> 6), 0);
+			m_stopWordRank.resize( m_stopWordBitmap.size(), 0);
+			uint32_t rank = sw - m_stopWordList.data();
+			uint32_t wordidx = part.ofs;
+			for (; sw != pe; ++sw,++rank)
+			{
+				uint32_t idx = *sw & StopWordPartitionIndexMask;
+				for (; wordidx <= part.ofs + (idx >> 6); ++wordidx)
+				{
+					m_stopWordRank[ wordidx] = rank;
+				}
+				m_stopWordBitmap[ part.ofs + (idx >> 6)] |= (uint64_t)1 << (idx & 63);
+			}
+		}
+		sw = pe;
+	}
+}
+
+void ProgramTable::storeImage( ImageWriter& out) const
+{
+	if (!m_compiled)
+	{
+		throw std::runtime_error( _TXT("cannot store image of program table that is not compiled"));
+	}
+	out.writeArray( m_triggerList.data(), m_triggerList.size());
+	out.write<uint32_t>( m_triggerList.freelistidx());
+	out.writeArray( m_programMap.data(), m_programMap.size());
+	out.write<uint32_t>( m_programMap.freelistidx());
+	out.writeArray( m_programTriggerList.data(), m_programTriggerList.size());
+	out.write<uint32_t>( m_programTriggerList.freelistidx());
+	out.writeArray( m_eventProgramIndex.data(), m_eventProgramIndex.size());
+	out.writeArray( m_stopWordList.data(), m_stopWordList.size());
+	out.write<uint32_t>( m_totalNofPrograms);
+}
+
+template <class PoolType>
+static void attachPoolImage( PoolType& pool, ImageReader& in)
+{
+	std::size_t size;
+	const typename PoolType::Element* ar = in.readArray<typename PoolType::Element>( size);
+	uint32_t freelistidx = in.read<uint32_t>();
+	if (size > std::numeric_limits<uint32_t>::max() || freelistidx > size)
+	{
+		throw std::runtime_error( _TXT("corrupt program table image"));
+	}
+	pool.attach( ar, size, freelistidx);
+}
+
+template <class ArrayType, typename ElementType>
+static void attachArrayImage( ArrayType& array, ImageReader& in)
+{
+	std::size_t size;
+	const ElementType* ar = in.readArray<ElementType>( size);
+	if (size > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::runtime_error( _TXT("corrupt program table image"));
+	}
+	array.attach( ar, size);
+}
+
+/// \brief Check the links of a list in a pool loaded from an image, so that the list can be traversed without bound checks
+/// \param[in,out] visited flags of the elements visited by the lists checked before, an element shared or visited twice indicates a corrupt image
+template <class PoolType>
+static void checkPoolListImage( const PoolType& pool, uint32_t listidx, std::vector<bool>& visited)
+{
+	uint32_t base = pool.first();
+	while (listidx)
+	{
+		uint32_t elemidx = listidx - 1 - base;
+		if (listidx - 1 < base || elemidx >= pool.size() || visited[ elemidx])
+		{
+			throw std::runtime_error( _TXT("corrupt program table image"));
+		}
+		visited[ elemidx] = true;
+		listidx = pool.data()[ elemidx].next;
+	}
+}
+
+void ProgramTable::checkImage() const
+{
+	std::vector<bool> visitedTriggers( m_triggerList.size(), false);
+	const Program* pi = m_programMap.data();
+	const Program* pe = pi + m_programMap.size();
+	for (; pi != pe; ++pi)
+	{
+		checkPoolListImage( m_triggerList, pi->triggerListIdx, visitedTriggers);
+		uint32_t triggerListItr = pi->triggerListIdx;
+		const TriggerDef* triggerDef;
+		while (0!=(triggerDef=m_triggerList.nextptr( triggerListItr)))
+		{
+			if (triggerDef->sigtype > Trigger::SigAnd || triggerDef->isKeyEvent > 1)
+			{
+				throw std::runtime_error( _TXT("corrupt program table image"));
+			}
+		}
+	}
+	std::vector<bool> visitedProgramTriggers( m_programTriggerList.size(), false);
+	uint32_t programBase = firstProgram();
+	uint32_t nofEmptySlots = 0;
+	EventProgramIndex::const_iterator ei = m_eventProgramIndex.begin(), ee = m_eventProgramIndex.end();
+	for (; ei != ee; ++ei)
+	{
+		if (!ei->programlist) ++nofEmptySlots;
+		checkPoolListImage( m_programTriggerList, ei->programlist, visitedProgramTriggers);
+		uint32_t programlist = ei->programlist;
+		const ProgramTrigger* programTrigger;
+		while (0!=(programTrigger = m_programTriggerList.nextptr( programlist)))
+		{
+			if (programTrigger->programidx < programBase || programTrigger->programidx - programBase >= nofPrograms())
+			{
+				throw std::runtime_error( _TXT("corrupt program table image"));
+			}
+		}
+	}
+	if (m_eventProgramIndex.size() && !nofEmptySlots)
+	{
+		// ... a search for an event not in the index would not terminate
+		throw std::runtime_error( _TXT("corrupt program table image"));
+	}
+}
+
+void ProgramTable::checkHandles( uint32_t nofResultHandles, uint32_t nofFormatHandles, uint32_t nofVariables) const
+{
+	const Program* pi = m_programMap.data();
+	const Program* pe = pi + m_programMap.size();
+	for (; pi != pe; ++pi)
+	{
+		if (pi->slotDef.resultHandle > nofResultHandles || pi->slotDef.formatHandle > nofFormatHandles)
+		{
+			throw std::runtime_error( _TXT("corrupt program table image (result handle out of range)"));
+		}
+		uint32_t triggerListItr = pi->triggerListIdx;
+		const TriggerDef* triggerDef;
+		while (0!=(triggerDef=m_triggerList.nextptr( triggerListItr)))
+		{
+			if (triggerDef->variable > nofVariables)
+			{
+				throw std::runtime_error( _TXT("corrupt program table image (variable out of range)"));
+			}
+		}
+	}
+}
+
+void ProgramTable::loadImage( ImageReader& in)
+{
+	attachPoolImage( m_triggerList, in);
+	{
+		std::size_t size;
+		const Program* ar = in.readArray<Program>( size);
+		uint32_t freelistidx = in.read<uint32_t>();
+		if (size > std::numeric_limits<uint32_t>::max() || freelistidx > size)
+		{
+			throw std::runtime_error( _TXT("corrupt program table image"));
+		}
+		m_programMap.attach( ar, size, freelistidx);
+	}
+	attachPoolImage( m_programTriggerList, in);
+	attachArrayImage<EventProgramIndex,EventProgramIndexElem>( m_eventProgramIndex, in);
+	uint32_t indexsize = m_eventProgramIndex.size();
+	if (indexsize & (indexsize-1))
+	{
+		throw std::runtime_error( _TXT("corrupt program table image"));
+	}
+	attachArrayImage<StopWordList,uint32_t>( m_stopWordList, in);
+	uint32_t si = 1;
+	for (; si < m_stopWordList.size(); ++si)
+	{
+		if (m_stopWordList.data()[ si-1] >= m_stopWordList.data()[ si])
+		{
+			throw std::runtime_error( _TXT("corrupt program table image"));
+		}
+	}
+	m_totalNofPrograms = in.read<uint32_t>();
+	checkImage();
+
+	m_eventProgamTriggerMap.clear();
+	m_stopWordSet.clear();
+	m_keyOccurrenceMap.clear();
+	m_frequencyMap.clear();
+	buildStopWordBitmap();
+	m_compiled = true;
+}
+
+
+StateMachine::StateMachine( const ProgramTable* programTable_, bool triggerHashIndex_, DebugTraceContextInterface* debugtrace_, const ProgramTableShard* shard_)
 	:m_debugtrace(debugtrace_)
 	,m_programTable(programTable_)
+	,m_shard(shard_)
+	,m_eventTriggerTable(triggerHashIndex_)
 	,m_curpos(0)
 	,m_nofProgramsInstalled(0)
 	,m_nofAltKeyProgramsInstalled(0)
 	,m_nofSignalsFired(0)
 	,m_nofOpenPatterns(0.0)
 	,m_timestmp(0)
+	,m_timestmpBase(0)
+	,m_nofTransitions(0)
+	,m_curOrigin()
+	,m_followOrigins()
+	,m_installOrigins()
+	,m_resultOrigins()
 {
 	std::memset( m_disposeWindow, 0, sizeof(m_disposeWindow));
 	std::make_heap( m_ruleDisposeQueue.begin(), m_ruleDisposeQueue.end());
 	std::memset( m_observeEvents, 0, sizeof(m_observeEvents));
 }
 
-StateMachine::StateMachine( const StateMachine& o)
-	:m_programTable(o.m_programTable)
+StateMachine::StateMachine( const StateMachine& o, DebugTraceContextInterface* debugtrace_)
+	:m_debugtrace(debugtrace_)
+	,m_programTable(o.m_programTable)
+	,m_shard(o.m_shard)
 	,m_eventTriggerTable(o.m_eventTriggerTable)
 	,m_actionSlotTable(o.m_actionSlotTable)
 	,m_eventTriggerList(o.m_eventTriggerList)
@@ -613,12 +1423,18 @@ StateMachine::StateMachine( const StateMachine& o)
 	,m_curpos(o.m_curpos)
 	,m_disposeRuleList(o.m_disposeRuleList)
 	,m_ruleDisposeQueue(o.m_ruleDisposeQueue)
-	,m_stopWordsEventLogMap(o.m_stopWordsEventLogMap)
+	,m_stopWordsEventLog(o.m_stopWordsEventLog)
 	,m_nofProgramsInstalled(o.m_nofProgramsInstalled)
 	,m_nofAltKeyProgramsInstalled(o.m_nofAltKeyProgramsInstalled)
 	,m_nofSignalsFired(o.m_nofSignalsFired)
 	,m_nofOpenPatterns(o.m_nofOpenPatterns)
 	,m_timestmp(o.m_timestmp)
+	,m_timestmpBase(o.m_timestmpBase)
+	,m_nofTransitions(o.m_nofTransitions)
+	,m_curOrigin()
+	,m_followOrigins()
+	,m_installOrigins(o.m_installOrigins)
+	,m_resultOrigins(o.m_resultOrigins)
 {
 	std::memcpy( m_disposeWindow, o.m_disposeWindow, sizeof(m_disposeWindow));
 	std::make_heap( m_ruleDisposeQueue.begin(), m_ruleDisposeQueue.end());
@@ -661,12 +1477,67 @@ void StateMachine::clear()
 	m_disposeRuleList.clear();
 	m_ruleDisposeQueue.clear();
 	std::make_heap( m_ruleDisposeQueue.begin(), m_ruleDisposeQueue.end());
-	m_stopWordsEventLogMap.clear();
+	m_stopWordsEventLog.clear();
 	m_nofProgramsInstalled = 0;
 	m_nofAltKeyProgramsInstalled = 0;
 	m_nofSignalsFired = 0;
 	m_nofOpenPatterns = 0;
 	m_timestmp = 0;
+	m_timestmpBase = 0;
+	m_nofTransitions = 0;
+	m_installOrigins.clear();
+	m_resultOrigins.clear();
+}
+
+void StateMachine::reset( std::size_t trimSize)
+{
+	uint32_t maxAllocSize = (uint32_t)std::min( trimSize, (std::size_t)std::numeric_limits<uint32_t>::max());
+	m_eventTriggerTable.reset( maxAllocSize);
+	m_actionSlotTable.reset( maxAllocSize);
+	m_eventTriggerList.reset( maxAllocSize);
+	m_eventItemList.reset( maxAllocSize);
+	m_eventDataReferenceTable.reset( maxAllocSize);
+	m_ruleTable.reset( maxAllocSize);
+	m_results.reset( trimSize);
+	m_curpos = 0;
+	std::memset( m_disposeWindow, 0, sizeof(m_disposeWindow));
+	m_disposeRuleList.reset( maxAllocSize);
+	if (trimSize && m_ruleDisposeQueue.capacity() > trimSize)
+	{
+		std::vector<DisposeEvent>().swap( m_ruleDisposeQueue);
+	}
+	else
+	{
+		m_ruleDisposeQueue.clear();
+	}
+	// The stop word log is kept allocated, its entries are outdated by moving the timestmp base to the current timestmp:
+	if (m_timestmp > std::numeric_limits<unsigned int>::max() / 2)
+	{
+		std::fill( m_stopWordsEventLog.begin(), m_stopWordsEventLog.end(), EventLog());
+		m_timestmp = 0;
+	}
+	m_timestmpBase = m_timestmp;
+	m_nofProgramsInstalled = 0;
+	m_nofAltKeyProgramsInstalled = 0;
+	m_nofSignalsFired = 0;
+	m_nofOpenPatterns = 0;
+	m_nofTransitions = 0;
+	if (trimSize && m_installOrigins.capacity() > trimSize)
+	{
+		std::vector<ShardOrigin>().swap( m_installOrigins);
+	}
+	else
+	{
+		m_installOrigins.clear();
+	}
+	if (trimSize && m_resultOrigins.capacity() > trimSize)
+	{
+		std::vector<ShardOrigin>().swap( m_resultOrigins);
+	}
+	else
+	{
+		m_resultOrigins.clear();
+	}
 }
 
 uint32_t StateMachine::createRule( uint32_t expiryOrdpos)
@@ -948,6 +1819,10 @@ void StateMachine::fireSignal(
 			if (slot.resultHandle)
 			{
 				m_results.add( Result( slot.resultHandle, slot.formatHandle, rule.eventDataReferenceIdx, slot.start_ordpos, slot.end_ordpos, slot.start_origseg, slot.start_origpos, data.end_origseg, data.end_origpos));
+				if (m_shard)
+				{
+					m_resultOrigins.push_back( m_curOrigin);
+				}
 				if (rule.eventDataReferenceIdx)
 				{
 					referenceEventData( rule.eventDataReferenceIdx);
@@ -978,7 +1853,7 @@ void StateMachine::fireSignal(
 	}
 }
 
-void StateMachine::doTransition( uint32_t event, const EventData& data)
+void StateMachine::doTransition( uint32_t event, const EventData& data, TransitionBuffers& buffers)
 {
 	if (UNLIKELY(!!m_debugtrace))
 	{
@@ -991,28 +1866,33 @@ void StateMachine::doTransition( uint32_t event, const EventData& data)
 	// Some logging:
 	m_nofOpenPatterns += m_eventTriggerTable.nofTriggers();
 
-	enum {NofTriggers=1024,NofEventStruct=1024,NofDisposeRules=1024};
-	Trigger const* trigger_alloca[ NofTriggers];
-	EventStruct followList_alloca[ NofEventStruct];
-	uint32_t disposeRuleList_alloca[ NofDisposeRules];
-
 	// Process the event and all follow events triggered:
-	EventStructList followList( followList_alloca, NofEventStruct);
+	EventStructList followList( buffers.followList, TransitionBuffers::NofEventStruct);
 	followList.add( EventStruct( data, event));
 	std::size_t ei = followList.first();
 	if (followList[ei].data.subdataref)
 	{
 		referenceEventData( followList[ei].data.subdataref);
 	}
+	if (m_shard)
+	{
+		m_curOrigin = ShardOrigin( ++m_nofTransitions, 0/*depth*/, 0, 0);
+		m_followOrigins.assign( 1, m_curOrigin);
+	}
 	for (; ei < followList.first() + followList.size(); ++ei)
 	{
-		EventTriggerTable::TriggerRefList triggers( trigger_alloca, NofTriggers);
-		DisposeRuleList disposeRuleList( disposeRuleList_alloca, NofDisposeRules);
+		EventTriggerTable::TriggerRefList triggers( buffers.triggers, TransitionBuffers::NofTriggers);
+		EventTriggerTable::TriggerIndexList triggerIndices( buffers.triggerIndices, TransitionBuffers::NofTriggers);
+		DisposeRuleList disposeRuleList( buffers.disposeRuleList, TransitionBuffers::NofDisposeRules);
 
 		EventStruct follow = followList[ ei];
+		if (m_shard)
+		{
+			m_curOrigin = m_followOrigins[ ei - followList.first()];
+		}
 
 		// Fire triggers waiting for this event:
-		m_eventTriggerTable.getTriggers( triggers, follow.eventid);
+		m_eventTriggerTable.getTriggers( triggers, triggerIndices, follow.eventid);
 		EventTriggerTable::TriggerRefList::const_iterator
 			ti = triggers.begin(), te = triggers.end();
 		for (; ti != te; ++ti)
@@ -1020,7 +1900,20 @@ void StateMachine::doTransition( uint32_t event, const EventData& data)
 			const Trigger& trigger = **ti;
 			ActionSlot& slot = m_actionSlotTable[ trigger.slot()];
 
-			fireSignal( slot, trigger, follow.data, disposeRuleList, followList);
+			if (m_shard)
+			{
+				if (m_curOrigin.depth == 0)
+				{
+					m_curOrigin.steptype = ShardOrigin::StepTrigger;
+					m_curOrigin.stepref = m_ruleTable[ slot.rule].installIdx;
+				}
+				fireSignal( slot, trigger, follow.data, disposeRuleList, followList);
+				pushFollowOrigins( followList);
+			}
+			else
+			{
+				fireSignal( slot, trigger, follow.data, disposeRuleList, followList);
+			}
 		}
 		// Install triggered programs:
 		installEventPrograms( follow.eventid, follow.data, followList, disposeRuleList);
@@ -1035,9 +1928,14 @@ void StateMachine::doTransition( uint32_t event, const EventData& data)
 
 		// Keep all stopword events to feed slots of programs triggered by a key event 
 		// that is not the first appearing:
-		if (m_programTable->isStopWord( follow.eventid))
+		uint32_t stopWordIndex = m_programTable->stopWordIndex( follow.eventid);
+		if (stopWordIndex)
 		{
-			m_stopWordsEventLogMap[ follow.eventid] = EventLog( follow.data, ++m_timestmp);
+			if (m_stopWordsEventLog.empty())
+			{
+				m_stopWordsEventLog.resize( m_programTable->nofStopWords());
+			}
+			m_stopWordsEventLog[ stopWordIndex-1] = EventLog( follow.data, ++m_timestmp);
 		}
 		// Release event data not referenced by any active rule:
 		else if (follow.data.subdataref)
@@ -1063,6 +1961,15 @@ void StateMachine::doTransition( uint32_t event, const EventData& data)
 	}
 }
 
+void StateMachine::pushFollowOrigins( const EventStructList& followList)
+{
+	// The events issued by the current step are one level deeper, but descend from the same step processing the input event:
+	while (m_followOrigins.size() < followList.size())
+	{
+		m_followOrigins.push_back( ShardOrigin( m_curOrigin.transition, m_curOrigin.depth+1, m_curOrigin.steptype, m_curOrigin.stepref));
+	}
+}
+
 void StateMachine::defineDisposeRule( uint32_t pos, uint32_t ruleidx)
 {
 	if (pos < m_curpos)
@@ -1136,14 +2043,33 @@ void StateMachine::setCurrentPos( uint32_t pos)
 
 void StateMachine::installEventPrograms( uint32_t event, const EventData& data, EventStructList& followList, DisposeRuleList& disposeRuleList)
 {
-	uint32_t programlist = m_programTable->getEventProgramList( event);
-	const ProgramTrigger* programTrigger;
 	uint32_t icnt = 0;
-
-	while (0!=(programTrigger=m_programTable->nextProgramPtr( programlist)))
+	if (m_shard)
+	{
+		const ProgramTrigger* pi;
+		const ProgramTrigger* pe;
+		m_shard->getEventPrograms( event, pi, pe);
+		for (; pi != pe; ++pi)
+		{
+			if (m_curOrigin.depth == 0)
+			{
+				m_curOrigin.steptype = ShardOrigin::StepInstall;
+				m_curOrigin.stepref = m_shard->programRank( pi);
+			}
+			installProgram( event, *pi, data, followList, disposeRuleList);
+			pushFollowOrigins( followList);
+			++icnt;
+		}
+	}
+	else
 	{
-		installProgram( event, *programTrigger, data, followList, disposeRuleList);
-		++icnt;
+		uint32_t programlist = m_programTable->getEventProgramList( event);
+		const ProgramTrigger* programTrigger;
+		while (0!=(programTrigger=m_programTable->nextProgramPtr( programlist)))
+		{
+			installProgram( event, *programTrigger, data, followList, disposeRuleList);
+			++icnt;
+		}
 	}
 	if (UNLIKELY(!!m_debugtrace))
 	{
@@ -1181,6 +2107,11 @@ void StateMachine::installProgram( uint32_t keyevent, const ProgramTrigger& prog
 	}
 	uint32_t ruleidx = createRule( data.start_ordpos + program.positionRange);
 	Rule& rule = m_ruleTable[ ruleidx];
+	if (m_shard)
+	{
+		m_installOrigins.push_back( m_curOrigin);
+		rule.installIdx = m_installOrigins.size();
+	}
 	if (UNLIKELY(!!m_debugtrace))
 	{
 		if (isObservedEvent( keyevent))
@@ -1273,9 +2204,10 @@ void StateMachine::replayPastEvent( uint32_t eventid, const Rule& rule, uint32_t
 {
 	// Search for the event 'eventid' in the latest visited stopwords and trigger them
 	// to fire on the slot of the installed rule
-	std::map<uint32_t,EventLog>::const_iterator
-		ei = m_stopWordsEventLogMap.find( eventid);
-	if (ei != m_stopWordsEventLogMap.end() && ei->second.data.start_ordpos + positionRange >= m_curpos)
+	uint32_t stopWordIndex = m_programTable->stopWordIndex( eventid);
+	if (!stopWordIndex || m_stopWordsEventLog.empty()) return;
+	const EventLog& eventLog = m_stopWordsEventLog[ stopWordIndex-1];
+	if (eventLog.timestmp > m_timestmpBase && eventLog.data.start_ordpos + positionRange >= m_curpos)
 	{
 		ActionSlot& slot = m_actionSlotTable[ rule.actionSlotIdx-1];
 
@@ -1300,7 +2232,7 @@ void StateMachine::replayPastEvent( uint32_t eventid, const Rule& rule, uint32_t
 			}
 			if (eventid == trigger_eventid)
 			{
-				fireSignal( slot, *tp, ei->second.data, disposeRuleList, followList);
+				fireSignal( slot, *tp, eventLog.data, disposeRuleList, followList);
 			}
 		}
 		if (delEventList.size())
@@ -1310,9 +2242,8 @@ void StateMachine::replayPastEvent( uint32_t eventid, const Rule& rule, uint32_t
 				le = delEventList.end();
 			for (; li != le; ++li)
 			{
-				std::map<uint32_t,EventLog>::const_iterator
-					stopwi = m_stopWordsEventLogMap.find( *li);
-				if (stopwi != m_stopWordsEventLogMap.end() && stopwi->second.timestmp > ei->second.timestmp)
+				uint32_t delStopWordIndex = m_programTable->stopWordIndex( *li);
+				if (delStopWordIndex && m_stopWordsEventLog[ delStopWordIndex-1].timestmp > eventLog.timestmp)
 				{
 					deactivateRule( slot.rule);
 					break;
@@ -1335,3 +2266,91 @@ void StateMachine::replayPastEvent( uint32_t eventid, const Rule& rule, uint32_t
 
 
 
+
+/// \brief Rule installed or result produced by the state machine of a shard with the key ordering it among the items of all shards of the same input event (see ShardOrigin)
+struct ShardMergeItem
+{
+	std::size_t shardidx;
+	std::size_t idx;	///< index of the item in the list of the shard
+	uint32_t depth;
+	uint32_t steptype;
+	uint32_t steprank;	///< StepTrigger: rank of the installation of the rule of the trigger among all shards, StepInstall: rank of the program installed
+
+	ShardMergeItem( std::size_t shardidx_, std::size_t idx_, uint32_t depth_, uint32_t steptype_, uint32_t steprank_)
+		:shardidx(shardidx_),idx(idx_),depth(depth_),steptype(steptype_),steprank(steprank_){}
+
+	bool operator<( const ShardMergeItem& o) const
+	{
+		if (depth != o.depth) return depth < o.depth;
+		if (steptype != o.steptype) return steptype < o.steptype;
+		return steprank < o.steprank;
+	}
+};
+
+/// \brief Collect the items of all shards of an input event, with the rank of the installation of the rule among all shards as key for triggers fired
+/// \note The items of each shard are appended in the order they were produced, so that items with an equal key stay in this order when sorted stable
+static void collectShardMergeItems(
+		std::vector<ShardMergeItem>& res, std::vector<std::size_t>& itr,
+		const std::vector<const std::vector<ShardOrigin>*>& origins,
+		const std::vector<std::vector<uint32_t> >& installRanks,
+		uint32_t transition)
+{
+	res.clear();
+	std::size_t si = 0, se = origins.size();
+	for (; si != se; ++si)
+	{
+		const std::vector<ShardOrigin>& shardOrigins = *origins[ si];
+		for (; itr[ si] < shardOrigins.size() && shardOrigins[ itr[ si]].transition == transition; ++itr[ si])
+		{
+			const ShardOrigin& origin = shardOrigins[ itr[ si]];
+			uint32_t steprank = origin.steptype == ShardOrigin::StepTrigger
+						? installRanks[ si][ origin.stepref-1]
+						: origin.stepref;
+			res.push_back( ShardMergeItem( si, itr[ si], origin.depth, origin.steptype, steprank));
+		}
+	}
+	std::stable_sort( res.begin(), res.end());
+}
+
+void StateMachine::mergeShardResults( std::vector<ShardResultRef>& res, const StateMachine* const* shards, std::size_t nofShards)
+{
+	res.clear();
+	if (nofShards == 0) return;
+
+	// The rules installed by an input event get their rank among all shards before the results of the next input event are merged,
+	// the triggers of an input event belong to rules installed by preceding input events:
+	std::vector<const std::vector<ShardOrigin>*> installOrigins;
+	std::vector<const std::vector<ShardOrigin>*> resultOrigins;
+	std::vector<std::vector<uint32_t> > installRanks( nofShards);
+	std::size_t si = 0;
+	for (; si != nofShards; ++si)
+	{
+		if (shards[ si]->resultOrigins().size() != shards[ si]->results().size()
+		||  shards[ si]->nofTransitions() != shards[ 0]->nofTransitions())
+		{
+			throw std::runtime_error( _TXT("internal: state machines of shards not fed with the same input"));
+		}
+		installOrigins.push_back( &shards[ si]->installOrigins());
+		resultOrigins.push_back( &shards[ si]->resultOrigins());
+		installRanks[ si].resize( shards[ si]->installOrigins().size(), 0);
+	}
+	std::vector<std::size_t> installItr( nofShards, 0);
+	std::vector<std::size_t> resultItr( nofShards, 0);
+	std::vector<ShardMergeItem> items;
+	uint32_t nofInstalls = 0;
+	uint32_t transition = 1, nofTransitions = shards[ 0]->nofTransitions();
+	for (; transition <= nofTransitions; ++transition)
+	{
+		collectShardMergeItems( items, installItr, installOrigins, installRanks, transition);
+		std::vector<ShardMergeItem>::const_iterator ii = items.begin(), ie = items.end();
+		for (; ii != ie; ++ii)
+		{
+			installRanks[ ii->shardidx][ ii->idx] = ++nofInstalls;
+		}
+		collectShardMergeItems( items, resultItr, resultOrigins, installRanks, transition);
+		for (ii = items.begin(), ie = items.end(); ii != ie; ++ii)
+		{
+			res.push_back( ShardResultRef( ii->shardidx, &shards[ ii->shardidx]->results()[ ii->idx]));
+		}
+	}
+}
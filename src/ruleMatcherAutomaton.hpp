@@ -14,13 +14,13 @@
 #include "podStructArrayBase.hpp"
 #include "podStructTableBase.hpp"
 #include "podStackPoolBase.hpp"
+#include "flatEventMap.hpp"
 #include "errorUtils.hpp"
 #include "internationalization.hpp"
 #include <vector>
-#include <map>
-#include <set>
 #include <string>
 #include <stdexcept>
+#include <algorithm>
 
 namespace strus
 {
@@ -129,11 +129,30 @@ struct LinkedTrigger
 struct LinkedTriggerTableFreeListElem {uint32_t _[3]; uint32_t next;};
 typedef PodStructTableBase<LinkedTrigger,uint32_t,LinkedTriggerTableFreeListElem,BaseAddrLinkedTriggerTable> LinkedTriggerTable;
 
+/// \brief Slot of the hash index of EventTriggerTable, head of the chain of triggers of one event
+struct EventTriggerChain
+{
+	uint32_t event;		///< event, 0 for an empty slot
+	uint32_t head;		///< first trigger of the chain (index + 1)
+	uint32_t tail;		///< last trigger of the chain (index + 1)
+	uint32_t size;		///< number of triggers in the chain
+};
+
+/// \brief Links of a trigger in the chain of triggers of its event
+struct EventTriggerChainLink
+{
+	uint32_t prev;		///< previous trigger in the chain (index + 1), 0 for none
+	uint32_t next;		///< next trigger in the chain (index + 1), 0 for none
+};
+
 class EventTriggerTable
 {
 public:
 	~EventTriggerTable(){}
-	EventTriggerTable();
+	/// \brief Constructor
+	/// \param[in] useHashIndex_ true, if the triggers should be indexed with an open addressing hash table keyed by event with a chain of triggers per event,
+	///		false, if they should be indexed in a fixed number of buckets scanned linearly (vectorized)
+	explicit EventTriggerTable( bool useHashIndex_=false);
 	EventTriggerTable( const EventTriggerTable& o);
 
 	uint32_t add( const EventTrigger& et);
@@ -142,30 +161,52 @@ public:
 	Trigger const* getTriggerPtr( uint32_t idx) const;
 
 	typedef PodStructArrayBase<Trigger const*,std::size_t,0> TriggerRefList;
-	void getTriggers( TriggerRefList& triggers, uint32_t event) const;
+	typedef PodStructArrayBase<uint32_t,std::size_t,0> TriggerIndexList;
+	/// \brief Get the triggers waiting for an event
+	/// \param[out] triggers where to append the triggers found
+	/// \param[in,out] indexbuf buffer for the indices of the matching events written by the event scan, not changed in size
+	/// \param[in] event the event
+	void getTriggers( TriggerRefList& triggers, TriggerIndexList& indexbuf, uint32_t event) const;
 	uint32_t nofTriggers() const			{return m_nofTriggers;}
 	void clear();
+	/// \brief Clear the table, but keep the memory allocated for reuse
+	/// \param[in] maxAllocSize maximum number of elements kept allocated per array, 0 for no limit
+	void reset( uint32_t maxAllocSize);
 
 public:
 	enum {BlockSize=1024,EventHashTabSize=16,EventHashTabIdxShift=28,EventHashTabIdxMask=15};
+	enum {InitChainTableSize=1024};
 private:
 	void expandEventAr( uint32_t htidx, uint32_t newallocsize);
+	uint32_t findChain( uint32_t event) const;
+	uint32_t getOrCreateChain( uint32_t event);
+	void removeChain( uint32_t chainidx);
+	void rehashChainTable( uint32_t newsize);
 private:
+	/// \brief Bucket of the triggers, the triggers of an event are kept in the order of insertion
+	/// \note Removed triggers are marked with event 0 in m_eventAr (never scanned for) and a 0 in m_ar, the array is compacted when they take more than half of it
 	struct TriggerInd
 	{
 		uint32_t* m_eventAr;
 		uint32_t* m_ar;
 		uint32_t m_allocsize;
 		uint32_t m_size;
+		uint32_t m_nofRemoved;
 
-		TriggerInd() :m_eventAr(0),m_ar(0),m_allocsize(0),m_size(0){}
+		TriggerInd() :m_eventAr(0),m_ar(0),m_allocsize(0),m_size(0),m_nofRemoved(0){}
 		~TriggerInd();
 		void expand( uint32_t newallocsize);
 		void clear();
+		void reset( uint32_t maxAllocSize);
 	};
+	void compactTriggerInd( uint32_t htidx);
 	TriggerInd m_triggerIndAr[ EventHashTabSize];
 	LinkedTriggerTable m_triggerTab;
 	uint32_t m_nofTriggers;
+	bool m_useHashIndex;
+	std::vector<EventTriggerChain> m_chainTable;		///< hash index (open addressing, linear probing), size is a power of 2
+	uint32_t m_nofChains;					///< number of used slots in m_chainTable
+	std::vector<EventTriggerChainLink> m_chainLinkAr;	///< chain links of triggers, parallel to m_triggerTab
 };
 
 class Rule
@@ -174,13 +215,14 @@ public:
 	uint32_t actionSlotIdx;
 	uint32_t eventTriggerListIdx;
 	uint32_t eventDataReferenceIdx;
+	uint32_t installIdx;		///< index of the installation of the rule counted from 1, only set by the state machine of a shard (see ShardOrigin)
 	unsigned int done:1;
 	unsigned int lastpos:31;
 
 	explicit Rule( uint32_t lastpos_=0)
-		:actionSlotIdx(0),eventTriggerListIdx(0),eventDataReferenceIdx(0),done(0),lastpos(lastpos_){}
+		:actionSlotIdx(0),eventTriggerListIdx(0),eventDataReferenceIdx(0),installIdx(0),done(0),lastpos(lastpos_){}
 	void assign( const Rule& o)
-		{actionSlotIdx=o.actionSlotIdx;eventTriggerListIdx=o.eventTriggerListIdx;eventDataReferenceIdx=o.eventDataReferenceIdx;done=o.done;lastpos=o.lastpos;}
+		{actionSlotIdx=o.actionSlotIdx;eventTriggerListIdx=o.eventTriggerListIdx;eventDataReferenceIdx=o.eventDataReferenceIdx;installIdx=o.installIdx;done=o.done;lastpos=o.lastpos;}
 
 	bool isActive() const	{return actionSlotIdx!=0;}
 };
@@ -288,6 +330,36 @@ struct Result
 		{resultHandle=o.resultHandle;formatHandle=o.formatHandle;eventDataReferenceIdx=o.eventDataReferenceIdx;start_ordpos=o.start_ordpos;end_ordpos=o.end_ordpos;start_origseg=o.start_origseg;end_origseg=o.end_origseg;start_origpos=o.start_origpos;end_origpos=o.end_origpos;}
 };
 
+/// \brief Origin of a rule installed or a result produced by the state machine of a shard, for merging the results of the shards in the order of a state machine for the whole table
+/// \note A state machine processes the events issued by programs breadth first: all events issued while processing the input event, then all events issued by them, etc.
+///	The steps processing an input event are the triggers fired in the order of the installation of their rules and then the programs installed in the order of the program list of the event.
+///	Items of the same input event are therefore ordered by the depth of the event processed, then by the step processing the input event they descend from.
+///	Items with the same origin belong to the same shard and are in the order they were produced by it.
+struct ShardOrigin
+{
+	enum StepType {StepTrigger=0,StepInstall=1};
+
+	uint32_t transition;	///< index of the input event (call of StateMachine::doTransition) counted from 1
+	uint32_t depth;		///< number of events issued by programs on the path from the input event to the event processed
+	uint32_t steptype;	///< type of the step processing the input event the item descends from (StepType)
+	uint32_t stepref;	///< StepTrigger: index of the installation of the rule of the trigger fired, StepInstall: rank of the program installed in the program list of the input event
+
+	ShardOrigin()
+		:transition(0),depth(0),steptype(0),stepref(0){}
+	ShardOrigin( uint32_t transition_, uint32_t depth_, uint32_t steptype_, uint32_t stepref_)
+		:transition(transition_),depth(depth_),steptype(steptype_),stepref(stepref_){}
+};
+
+/// \brief Reference to a result of the state machine of a shard
+struct ShardResultRef
+{
+	std::size_t shardidx;
+	const Result* result;
+
+	ShardResultRef( std::size_t shardidx_, const Result* result_)
+		:shardidx(shardidx_),result(result_){}
+};
+
 struct ActionSlotDef
 {
 	uint32_t initsigval;		//< initial signal value (bitset)
@@ -307,11 +379,12 @@ struct TriggerDef
 	uint32_t event;
 	unsigned char isKeyEvent;
 	unsigned char sigtype;
+	unsigned char _[2];		///< explicit padding, initialized, so that images written are identical for identical tables
 	uint32_t sigval;
 	uint32_t variable;
 
 	TriggerDef( uint32_t event_, bool isKeyEvent_, Trigger::SigType sigtype_, uint32_t sigval_, uint32_t variable_)
-		:event(event_),isKeyEvent((unsigned char)isKeyEvent_),sigtype((unsigned char)sigtype_),sigval(sigval_),variable(variable_){}
+		:event(event_),isKeyEvent((unsigned char)isKeyEvent_),sigtype((unsigned char)sigtype_),sigval(sigval_),variable(variable_){_[0]=0;_[1]=0;}
 	void assign( const TriggerDef& o)
 		{event=o.event;isKeyEvent=o.isKeyEvent;sigtype=o.sigtype;sigval=o.sigval;variable=o.variable;}
 };
@@ -341,11 +414,21 @@ struct ProgramTrigger
 
 struct ProgramTableFreeListElem {uint32_t _;uint32_t next;};
 
+class ImageWriter;
+class ImageReader;
+
+/// \brief Element of the compiled map of events to their program lists (open addressing hash table)
+struct EventProgramIndexElem
+{
+	uint32_t eventid;
+	uint32_t programlist;	///< list of program triggers, 0 for an empty slot
+};
+
 class ProgramTable
 {
 public:
 	ProgramTable()
-		:m_totalNofPrograms(0){}
+		:m_totalNofPrograms(0),m_compiled(false){}
 
 	typedef PodStackPoolBase<ActionSlotDef,uint32_t,BaseAddrActionSlotDefTable> ActionSlotDefList;
 	typedef PodStackPoolBase<TriggerDef,uint32_t,BaseAddrTriggerDefTable> TriggerDefList;
@@ -369,11 +452,12 @@ public:
 		float stopwordOccurrenceFactor;
 		float weightFactor;
 		uint32_t maxRange;
+		unsigned int nofThreads;	///< number of threads used for the optimization, 0 or 1 for doing everything in the calling thread
 	
 		OptimizeOptions()		
-			:stopwordOccurrenceFactor(0.01f),weightFactor(10.0f),maxRange(5){}
+			:stopwordOccurrenceFactor(0.01f),weightFactor(10.0f),maxRange(5),nofThreads(0){}
 		void assign( const OptimizeOptions& o)
-			{stopwordOccurrenceFactor=o.stopwordOccurrenceFactor;weightFactor=o.weightFactor;maxRange=o.maxRange;}
+			{stopwordOccurrenceFactor=o.stopwordOccurrenceFactor;weightFactor=o.weightFactor;maxRange=o.maxRange;nofThreads=o.nofThreads;}
 	};
 	void optimize( OptimizeOptions& opt);
 
@@ -384,16 +468,97 @@ public:
 	};
 
 	Statistics getProgramStatistics() const;
-	bool isStopWord( uint32_t eventid) const		{return m_stopWordSet.find(eventid) != m_stopWordSet.end();}
+	bool isStopWord( uint32_t eventid) const
+	{
+		if (m_compiled)
+		{
+			const StopWordBitmapPartition& part = m_stopWordBitmapPartition[ eventid >> StopWordPartitionShift];
+			uint32_t idx = eventid & StopWordPartitionIndexMask;
+			if (part.searchList)
+			{
+				const uint32_t* sw = m_stopWordList.data();
+				return std::binary_search( sw, sw + m_stopWordList.size(), eventid);
+			}
+			return idx < part.size && ((m_stopWordBitmap[ part.ofs + (idx >> 6)] >> (idx & 63)) & 1);
+		}
+		return m_stopWordSet.contains( eventid);
+	}
+	/// \brief Get the index of a stop word, the stop words have the indices 1 to nofStopWords() in ascending order of their events
+	/// \return the index of the stop word or 0 if the event is not a stop word
+	uint32_t stopWordIndex( uint32_t eventid) const
+	{
+		if (m_compiled)
+		{
+			const StopWordBitmapPartition& part = m_stopWordBitmapPartition[ eventid >> StopWordPartitionShift];
+			uint32_t idx = eventid & StopWordPartitionIndexMask;
+			if (part.searchList)
+			{
+				const uint32_t* sw = m_stopWordList.data();
+				const uint32_t* si = std::lower_bound( sw, sw + m_stopWordList.size(), eventid);
+				return (si != sw + m_stopWordList.size() && *si == eventid) ? (si - sw + 1) : 0;
+			}
+			if (idx >= part.size) return 0;
+			uint32_t wordidx = part.ofs + (idx >> 6);
+			uint64_t word = m_stopWordBitmap[ wordidx];
+			uint64_t bit = (uint64_t)1 << (idx & 63);
+			return (word & bit) ? (m_stopWordRank[ wordidx] + __builtin_popcountll( word & (bit-1)) + 1) : 0;
+		}
+		return m_stopWordSet.index( eventid);
+	}
+	/// \brief Get the number of stop words
+	uint32_t nofStopWords() const
+	{
+		return m_compiled ? m_stopWordList.size() : m_stopWordSet.size();
+	}
+
+	/// \brief Test if the table has been compiled with optimize or loaded from an image
+	bool compiled() const					{return m_compiled;}
+	/// \brief Get the number of programs, the programs have the indices firstProgram() to firstProgram()+nofPrograms()-1
+	uint32_t nofPrograms() const				{return m_programMap.size();}
+	/// \brief Get the index of the first program
+	uint32_t firstProgram() const				{return m_programMap.first()+1;}
+	/// \brief Get all events with a non empty program list and their program lists, ascending by event
+	void getEventProgramLists( std::vector<EventProgramIndexElem>& res) const;
+	/// \brief Write the compiled program table to an image
+	/// \note The compile time only structures (event statistics, the maps used for building) are not stored
+	void storeImage( ImageWriter& out) const;
+	/// \brief Load a compiled program table from an image
+	/// \note The table references the arrays in the image, so the image has to live as long as the table, the table is read only after this call
+	void loadImage( ImageReader& in);
+	/// \brief Check the handles referenced by the programs of a table loaded from an image against the sizes of the tables they refer to
+	/// \param[in] nofResultHandles number of result handles (pattern names) defined
+	/// \param[in] nofFormatHandles number of result format handles defined
+	/// \param[in] nofVariables number of variables defined
+	/// \note Throws a runtime error if a handle of a program is out of range
+	void checkHandles( uint32_t nofResultHandles, uint32_t nofFormatHandles, uint32_t nofVariables) const;
 
 private:
 	void defineEventProgramAlt( uint32_t eventid, uint32_t programidx, uint32_t past_eventid);
 	double calcEventWeight( uint32_t eventid) const;
 	uint32_t getAltEventId( uint32_t eventid, uint32_t triggerListIdx) const;
+
+	/// \brief Alternative key event of a program triggered by an event, evaluated before the optimization
+	struct AltEventElem
+	{
+		uint32_t programidx;
+		uint32_t alt_eventid;
+
+		AltEventElem( uint32_t programidx_, uint32_t alt_eventid_)
+			:programidx(programidx_),alt_eventid(alt_eventid_){}
+	};
+	typedef std::vector<AltEventElem> AltEventList;
+	class AltEventWorker;
+	void calcAltEventLists( std::vector<AltEventList>& res, const std::vector<uint32_t>& events, unsigned int nofThreads) const;
+	void calcAltEventList( AltEventList& res, uint32_t eventid) const;
 	void getDelimTokenStopWordSet( uint32_t triggerListIdx);
 	void defineEventProgram( uint32_t eventid, uint32_t programidx);
 	void defineDisposeRule( uint32_t pos, uint32_t ruleidx);
 	void eliminateUnusedEvents();
+	void buildCompiledStructures();
+	void buildStopWordBitmap();
+	/// \brief Check the references between the arrays of a table loaded from an image and the fields of the programs and their triggers, so that a corrupt image is detected also without bound checks of the array accesses
+	/// \note The handles referring to tables of the pattern matcher are checked with checkHandles
+	void checkImage() const;
 
 private:
 	ActionSlotDefList m_actionSlotArray;
@@ -403,13 +568,86 @@ private:
 	PodStackPoolBase<ProgramTrigger,uint32_t,BaseAddrProgramList> m_programTriggerList;
 	typedef strus::unordered_map<uint32_t,uint32_t> EventProgamTriggerMap;
 	EventProgamTriggerMap m_eventProgamTriggerMap;
-	std::set<uint32_t> m_stopWordSet;
-	typedef std::map<uint32_t,uint32_t> EventOccurrenceMap;
+	FlatEventSet m_stopWordSet;
+	typedef FlatEventMap<uint32_t> EventOccurrenceMap;
 	EventOccurrenceMap m_keyOccurrenceMap;
-	EventOccurrenceMap m_eventOccurrenceMap;
-	typedef std::map<uint32_t,double> FrequencyMap;
+	typedef FlatEventMap<double> FrequencyMap;
 	FrequencyMap m_frequencyMap;
 	uint32_t m_totalNofPrograms;
+	typedef PodStructArrayBase<EventProgramIndexElem,uint32_t,0> EventProgramIndex;
+	EventProgramIndex m_eventProgramIndex;			///< compiled map of events to program lists, size is a power of 2
+	typedef PodStructArrayBase<uint32_t,uint32_t,0> StopWordList;
+	StopWordList m_stopWordList;				///< compiled sorted list of stop word events
+
+	/// \brief Partition of the stop word bitmap for the events with the same upper 3 bits (the event type)
+	struct StopWordBitmapPartition
+	{
+		uint32_t ofs;		///< index of the first word of the partition in m_stopWordBitmap
+		uint32_t size;		///< number of bits of the partition, the events with a bigger index are not stop words
+		bool searchList;	///< true if the partition is too sparse for a bitmap and m_stopWordList is searched instead
+
+		StopWordBitmapPartition()
+			:ofs(0),size(0),searchList(false){}
+	};
+	enum {
+		StopWordPartitionShift=29,
+		StopWordPartitionIndexMask=(1<<29)-1,
+		NofStopWordPartitions=8,
+		MaxStopWordBitmapSize=1<<22	///< maximum number of bits of a partition, partitions with stop words with a bigger index are searched in m_stopWordList
+	};
+	std::vector<uint64_t> m_stopWordBitmap;			///< bitmap of stop word events indexed by event in partitions, built from m_stopWordList
+	std::vector<uint32_t> m_stopWordRank;			///< number of stop words before the events of each word of m_stopWordBitmap
+	StopWordBitmapPartition m_stopWordBitmapPartition[ NofStopWordPartitions];
+	bool m_compiled;
+};
+
+/// \brief Subset of the programs of a program table closed under the events issued by programs,
+///	for matching a document with one state machine per subset, each one fed with the same input events
+class ProgramTableShard
+{
+public:
+	ProgramTableShard()
+		:m_index(),m_programs(),m_nofPrograms(0){}
+
+	/// \brief Get the programs of this shard triggered by an event
+	/// \param[in] eventid event
+	/// \param[out] itr start of the array of program triggers
+	/// \param[out] end end of the array of program triggers
+	void getEventPrograms( uint32_t eventid, const ProgramTrigger*& itr, const ProgramTrigger*& end) const;
+	/// \brief Get the rank of a program trigger returned by getEventPrograms in the program list of the event of the whole table
+	uint32_t programRank( const ProgramTrigger* programTrigger) const
+	{
+		return m_programRanks[ programTrigger - &m_programs[0]];
+	}
+
+	/// \brief Get the number of programs assigned to this shard
+	uint32_t nofPrograms() const		{return m_nofPrograms;}
+
+	/// \brief Partition the programs of a table into shards, so that all programs connected by an event issued by one of them are in the same shard
+	/// \param[out] res the shards created, at most nofShards, not more than the number of connected sets of programs
+	/// \param[in] table program table to partition
+	/// \param[in] nofShards maximum number of shards to create
+	/// \param[in] derivedEventMask mask with the bits of the event identifiers marking events issued by programs, the other events are input events shared by all shards
+	static void createShards( std::vector<ProgramTableShard>& res, const ProgramTable& table, unsigned int nofShards, uint32_t derivedEventMask);
+
+private:
+	struct IndexElem
+	{
+		uint32_t eventid;
+		uint32_t start;
+		uint32_t size;	///< number of programs, 0 for an empty slot
+
+		IndexElem( uint32_t eventid_, uint32_t start_, uint32_t size_)
+			:eventid(eventid_),start(start_),size(size_){}
+	};
+	void addEventPrograms( uint32_t eventid, const std::vector<ProgramTrigger>& programs, const std::vector<uint32_t>& ranks);
+	void buildIndex();
+
+private:
+	std::vector<IndexElem> m_index;		///< map of events to program ranges in m_programs (open addressing, linear probing), size is a power of 2
+	std::vector<ProgramTrigger> m_programs;
+	std::vector<uint32_t> m_programRanks;	///< rank of each element of m_programs in the program list of its event of the whole table
+	uint32_t m_nofPrograms;
 };
 
 struct DisposeEvent
@@ -431,13 +669,38 @@ struct DisposeEvent
 class StateMachine
 {
 public:
-	StateMachine( const ProgramTable* programTable_, DebugTraceContextInterface* debugtrace_);
-	StateMachine( const StateMachine& o);
+	/// \brief Constructor
+	/// \param[in] programTable_ table of programs to install
+	/// \param[in] triggerHashIndex_ true, if the triggers are indexed by event with a hash table instead of a fixed number of buckets
+	/// \param[in] debugtrace_ debug trace context or NULL
+	/// \param[in] shard_ subset of the programs to install or NULL for all programs of the table
+	StateMachine( const ProgramTable* programTable_, bool triggerHashIndex_, DebugTraceContextInterface* debugtrace_, const ProgramTableShard* shard_=0);
+	/// \brief Create a snapshot of a state machine
+	/// \param[in] o state machine to copy
+	/// \param[in] debugtrace_ debug trace context of the copy (the one of o may belong to another context)
+	/// \note The pools are shared with copy on write, so that the copy is cheap, but the copy has to be used in the same thread as the original
+	StateMachine( const StateMachine& o, DebugTraceContextInterface* debugtrace_);
 
 	void addObserveEvent( uint32_t event);
 	bool isObservedEvent( uint32_t event) const;
 
-	void doTransition( uint32_t event, const EventData& data);
+	/// \brief Buffers used for the processing of one event and all follow events triggered by it
+	/// \note Declared once by callers processing a batch of events
+	struct TransitionBuffers
+	{
+		enum {NofTriggers=1024,NofEventStruct=1024,NofDisposeRules=1024};
+		Trigger const* triggers[ NofTriggers];
+		uint32_t triggerIndices[ NofTriggers];
+		EventStruct followList[ NofEventStruct];
+		uint32_t disposeRuleList[ NofDisposeRules];
+	};
+
+	void doTransition( uint32_t event, const EventData& data)
+	{
+		TransitionBuffers buffers;
+		doTransition( event, data, buffers);
+	}
+	void doTransition( uint32_t event, const EventData& data, TransitionBuffers& buffers);
 	void setCurrentPos( uint32_t pos);
 
 	typedef PodStructArrayBase<Result,std::size_t,0> ResultList;
@@ -453,7 +716,31 @@ public:
 	{
 		return m_eventItemList.nextptr( list);
 	}
+	/// \brief Get the number of input events processed (calls of doTransition) since the last reset, only counted by the state machine of a shard
+	uint32_t nofTransitions() const
+	{
+		return m_nofTransitions;
+	}
+	/// \brief Get the origins of the rules installed by the state machine of a shard, indexed by Rule::installIdx - 1
+	const std::vector<ShardOrigin>& installOrigins() const
+	{
+		return m_installOrigins;
+	}
+	/// \brief Get the origins of the results produced by the state machine of a shard, one per element of results()
+	const std::vector<ShardOrigin>& resultOrigins() const
+	{
+		return m_resultOrigins;
+	}
+	/// \brief Merge the results of the state machines of the shards of a table, fed with the same input, into the order of the results of a state machine for the whole table
+	/// \param[out] res references to the results of all shards in the order of a state machine for the whole table
+	/// \param[in] shards state machines of the shards
+	/// \param[in] nofShards number of shards
+	static void mergeShardResults( std::vector<ShardResultRef>& res, const StateMachine* const* shards, std::size_t nofShards);
+
 	void clear();
+	/// \brief Reset the state machine for processing a new document without freeing the memory allocated by its pools
+	/// \param[in] trimSize maximum number of elements kept allocated per pool, pools that grew beyond this size are freed, 0 for no limit
+	void reset( std::size_t trimSize=0);
 
 public://getStatistics
 	unsigned int nofProgramsInstalled() const	{return m_nofProgramsInstalled;}
@@ -477,10 +764,12 @@ private:
 	void installProgram( uint32_t keyevent, const ProgramTrigger& programTrigger, const EventData& data, EventStructList& followList, DisposeRuleList& disposeRuleList);
 	void installEventPrograms( uint32_t keyevent, const EventData& data, EventStructList& followList, DisposeRuleList& disposeRuleList);
 	void defineDisposeRule( uint32_t pos, uint32_t ruleidx);
+	void pushFollowOrigins( const EventStructList& followList);
 
 private:
 	DebugTraceContextInterface* m_debugtrace;
 	const ProgramTable* m_programTable;
+	const ProgramTableShard* m_shard;
 	EventTriggerTable m_eventTriggerTable;
 	ActionSlotTable m_actionSlotTable;
 	PodStackPoolBase<uint32_t,uint32_t,BaseAddrEventTriggerList> m_eventTriggerList;
@@ -494,14 +783,24 @@ private:
 	typedef PodStackPoolBase<uint32_t,uint32_t,BaseAddrDisposeEventList> DisposeEventList;
 	DisposeEventList m_disposeRuleList;
 	std::vector<DisposeEvent> m_ruleDisposeQueue;
-	std::map<uint32_t,EventLog> m_stopWordsEventLogMap;
+	std::vector<EventLog> m_stopWordsEventLog;		///< last occurrence of each stop word indexed by ProgramTable::stopWordIndex - 1, a timestmp not greater than m_timestmpBase marks no occurrence
 	unsigned int m_nofProgramsInstalled;
 	unsigned int m_nofAltKeyProgramsInstalled;
 	unsigned int m_nofSignalsFired;
 	double m_nofOpenPatterns;
-	unsigned int m_timestmp;
+	unsigned int m_timestmp;				///< timestmp of the last stop word event logged
+	unsigned int m_timestmpBase;				///< timestmp of the last stop word event logged before the last reset, the log entries up to it are outdated
+	uint32_t m_nofTransitions;				///< number of input events processed, only counted by the state machine of a shard
+	ShardOrigin m_curOrigin;				///< origin of the current step of the state machine of a shard
+	std::vector<ShardOrigin> m_followOrigins;		///< origins of the events of the follow list of the current transition of the state machine of a shard
+	std::vector<ShardOrigin> m_installOrigins;		///< origins of the rules installed by the state machine of a shard
+	std::vector<ShardOrigin> m_resultOrigins;		///< origins of the results produced by the state machine of a shard
 	enum {MaxNofObserveEvents=8};
 	uint32_t m_observeEvents[ MaxNofObserveEvents];
+
+private:
+	StateMachine( const StateMachine&);	//... non copyable, use the constructor with the debug trace context
+	void operator=( const StateMachine&);	//... non copyable
 };
 
 } //namespace
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Helper classes for writing and reading binary images of compiled data structures
+/// \file "serialization.cpp"
+#include "serialization.hpp"
+#include "strus/base/fileio.hpp"
+#include "internationalization.hpp"
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace strus;
+
+void MappedFile::open( const std::string& filename)
+{
+	close();
+	int fd = ::open( filename.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		int ec = errno;
+		throw strus::runtime_error(_TXT("failed to open image file '%s': %s"), filename.c_str(), ::strerror(ec));
+	}
+	struct stat st;
+	if (::fstat( fd, &st) != 0)
+	{
+		int ec = errno;
+		::close( fd);
+		throw strus::runtime_error(_TXT("failed to get size of image file '%s': %s"), filename.c_str(), ::strerror(ec));
+	}
+	if (st.st_size == 0)
+	{
+		::close( fd);
+		throw strus::runtime_error(_TXT("image file '%s' is empty"), filename.c_str());
+	}
+	void* ptr = ::mmap( 0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	int ec = errno;
+	::close( fd);
+	if (ptr == MAP_FAILED)
+	{
+		throw strus::runtime_error(_TXT("failed to map image file '%s' into memory: %s"), filename.c_str(), ::strerror(ec));
+	}
+	m_ptr = (const char*)ptr;
+	m_size = st.st_size;
+}
+
+void MappedFile::close()
+{
+	if (m_ptr)
+	{
+		::munmap( (void*)m_ptr, m_size);
+		m_ptr = 0;
+		m_size = 0;
+	}
+}
+
+void strus::writeImageFile( const std::string& filename, const std::string& content)
+{
+	// Write to a temporary file and rename it, so that processes having the old image mapped are not affected:
+	std::string tmpfilename = filename + ".tmp";
+	int ec = strus::writeFile( tmpfilename, content);
+	if (ec)
+	{
+		throw strus::runtime_error(_TXT("failed to write image file '%s': %s"), tmpfilename.c_str(), ::strerror(ec));
+	}
+	if (0!=std::rename( tmpfilename.c_str(), filename.c_str()))
+	{
+		ec = errno;
+		throw strus::runtime_error(_TXT("failed to rename image file '%s' to '%s': %s"), tmpfilename.c_str(), filename.c_str(), ::strerror(ec));
+	}
+}
+
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Helper classes for writing and reading binary images of compiled data structures
+/// \file "serialization.hpp"
+#ifndef _STRUS_PATTERN_SERIALIZATION_HPP_INCLUDED
+#define _STRUS_PATTERN_SERIALIZATION_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include "internationalization.hpp"
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Builder of a binary image
+/// \note All elements written are aligned to ImageAlignment bytes relative to the start of the image.
+///	Arrays of POD elements are stored as they are in memory and can be referenced directly in a mapped image.
+class ImageWriter
+{
+public:
+	enum {ImageAlignment=8};
+
+	ImageWriter()
+		:m_content(){}
+
+	/// \brief Write the header identifying the image type and version
+	/// \param[in] magic image type identifier (at most 15 characters)
+	/// \param[in] version version of the image format
+	void writeHeader( const char* magic, uint32_t version)
+	{
+		char buf[ 16];
+		std::memset( buf, 0, sizeof(buf));
+		std::strncpy( buf, magic, sizeof(buf)-1);
+		m_content.append( buf, sizeof(buf));
+		write<uint32_t>( version);
+		write<uint32_t>( ByteOrderMark);
+	}
+
+	/// \brief Write a scalar value
+	template <typename ScalarType>
+	void write( const ScalarType& value)
+	{
+		m_content.append( (const char*)&value, sizeof(value));
+		align();
+	}
+
+	/// \brief Write a string
+	void writeString( const std::string& value)
+	{
+		write<uint64_t>( value.size());
+		m_content.append( value);
+		m_content.push_back( '\0');
+		align();
+	}
+
+	/// \brief Write an array of POD elements
+	template <typename ElementType>
+	void writeArray( const ElementType* ar, std::size_t arsize)
+	{
+		write<uint64_t>( arsize);
+		if (arsize) m_content.append( (const char*)ar, arsize * sizeof(ElementType));
+		align();
+	}
+
+	/// \brief Write a block of bytes
+	void writeBlob( const void* ptr, std::size_t size)
+	{
+		writeArray( (const char*)ptr, size);
+	}
+
+	/// \brief Get the image built
+	const std::string& content() const
+	{
+		return m_content;
+	}
+
+	enum {ByteOrderMark=0x01020304};
+
+private:
+	void align()
+	{
+		std::size_t rest = m_content.size() % ImageAlignment;
+		if (rest) m_content.append( ImageAlignment - rest, '\0');
+	}
+
+private:
+	std::string m_content;
+};
+
+/// \brief Reader of a binary image built with ImageWriter
+/// \note Arrays read are references into the image, the image has to be kept alive as long as they are used
+class ImageReader
+{
+public:
+	/// \brief Constructor
+	/// \param[in] ptr pointer to image, has to be aligned to ImageWriter::ImageAlignment
+	/// \param[in] size size of the image in bytes
+	ImageReader( const char* ptr, std::size_t size)
+		:m_ptr(ptr),m_size(size),m_pos(0)
+	{
+		if (((uintptr_t)ptr % ImageWriter::ImageAlignment) != 0)
+		{
+			throw std::runtime_error( _TXT("image is not properly aligned"));
+		}
+	}
+
+	/// \brief Read the header and check if it matches the image type and version expected
+	void readHeader( const char* magic, uint32_t version)
+	{
+		const char* buf = get( 16);
+		if (0!=std::strncmp( buf, magic, 15) || buf[15] != '\0')
+		{
+			throw std::runtime_error( _TXT("image is not of the type expected"));
+		}
+		align();
+		if (read<uint32_t>() != version)
+		{
+			throw std::runtime_error( _TXT("version of image does not match"));
+		}
+		if (read<uint32_t>() != (uint32_t)ImageWriter::ByteOrderMark)
+		{
+			throw std::runtime_error( _TXT("byte order of image does not match"));
+		}
+	}
+
+	/// \brief Read a scalar value
+	template <typename ScalarType>
+	ScalarType read()
+	{
+		ScalarType rt;
+		std::memcpy( &rt, get( sizeof(rt)), sizeof(rt));
+		align();
+		return rt;
+	}
+
+	/// \brief Read a string
+	std::string readString()
+	{
+		uint64_t size = read<uint64_t>();
+		if (size >= m_size - m_pos)
+		{
+			// ... checked before adding the terminating 0 byte, that could wrap around
+			throw std::runtime_error( _TXT("unexpected end of image"));
+		}
+		const char* str = get( size+1);
+		align();
+		return std::string( str, size);
+	}
+
+	/// \brief Read an array of POD elements
+	/// \param[out] arsize number of elements in the array
+	/// \return pointer to the array in the image
+	template <typename ElementType>
+	const ElementType* readArray( std::size_t& arsize)
+	{
+		uint64_t size = read<uint64_t>();
+		if (size > (m_size - m_pos) / sizeof(ElementType))
+		{
+			throw std::runtime_error( _TXT("unexpected end of image"));
+		}
+		arsize = size;
+		const ElementType* rt = (const ElementType*)(void*)get( arsize * sizeof(ElementType));
+		align();
+		return rt;
+	}
+
+	/// \brief Read a block of bytes
+	const void* readBlob( std::size_t& size)
+	{
+		return readArray<char>( size);
+	}
+
+	/// \brief Test if the whole image has been read
+	bool eof() const
+	{
+		return m_pos == m_size;
+	}
+
+private:
+	const char* get( std::size_t size)
+	{
+		if (size > m_size - m_pos)
+		{
+			throw std::runtime_error( _TXT("unexpected end of image"));
+		}
+		const char* rt = m_ptr + m_pos;
+		m_pos += size;
+		return rt;
+	}
+	void align()
+	{
+		std::size_t rest = m_pos % ImageWriter::ImageAlignment;
+		if (rest)
+		{
+			m_pos += ImageWriter::ImageAlignment - rest;
+			if (m_pos > m_size) m_pos = m_size;
+		}
+	}
+
+private:
+	const char* m_ptr;
+	std::size_t m_size;
+	std::size_t m_pos;
+};
+
+/// \brief File mapped read only into memory
+/// \note The memory can be shared between processes mapping the same file
+class MappedFile
+{
+public:
+	MappedFile()
+		:m_ptr(0),m_size(0){}
+	~MappedFile()
+	{
+		close();
+	}
+
+	/// \brief Map a file into memory
+	/// \param[in] filename path of the file to map
+	void open( const std::string& filename);
+	/// \brief Unmap the file
+	void close();
+
+	/// \brief Pointer to the mapped file content
+	const char* ptr() const		{return m_ptr;}
+	/// \brief Size of the mapped file content in bytes
+	std::size_t size() const	{return m_size;}
+
+private:
+	MappedFile( const MappedFile&){}	//... non copyable
+	void operator=( const MappedFile&){}	//... non copyable
+
+private:
+	const char* m_ptr;
+	std::size_t m_size;
+};
+
+/// \brief Write an image to a file
+/// \param[in] filename path of the file to write
+/// \param[in] content the image to write
+void writeImageFile( const std::string& filename, const std::string& content);
+
+}//namespace
+#endif
+
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Immutable symbol dictionary with a minimal perfect hash for the lookup of keys
+/// \file "symbolPerfectHash.cpp"
+#include "symbolPerfectHash.hpp"
+#include "serialization.hpp"
+#include "internationalization.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace strus;
+
+void SymbolPerfectHash::addKey( const char* key, std::size_t keylen)
+{
+	if (m_built)
+	{
+		throw std::runtime_error( _TXT("add key to perfect hash after build"));
+	}
+	if (m_keyofs.empty()) m_keyofs.push_back( 0);
+	if (m_keystr.size() + keylen >= std::numeric_limits<uint32_t>::max() || m_keyofs.size() >= (std::size_t)DirectSlotFlag)
+	{
+		throw std::runtime_error( _TXT("too many symbols defined for perfect hash"));
+	}
+	m_keystr.append( key, keylen);
+	m_keyofs.push_back( m_keystr.size());
+}
+
+/// \brief Order of buckets with the biggest first, they are the hardest to place
+struct BucketSizeOrder
+{
+	const std::vector<uint32_t>* bucketstart;
+
+	explicit BucketSizeOrder( const std::vector<uint32_t>* bucketstart_)
+		:bucketstart(bucketstart_){}
+	bool operator()( uint32_t aa, uint32_t bb) const
+	{
+		uint32_t asize = (*bucketstart)[ aa+1] - (*bucketstart)[ aa];
+		uint32_t bsize = (*bucketstart)[ bb+1] - (*bucketstart)[ bb];
+		return asize == bsize ? aa < bb : asize > bsize;
+	}
+};
+
+bool SymbolPerfectHash::tryBuild( std::size_t nofBuckets)
+{
+	enum {MaxDisplacement=1<<20};
+	std::size_t nofKeys = size();
+	std::vector<uint64_t> hashar( nofKeys);
+	std::vector<uint32_t> bucketstart( nofBuckets+1, 0);
+	std::size_t ki = 0;
+	for (; ki < nofKeys; ++ki)
+	{
+		hashar[ ki] = keyHash( m_keystr.c_str() + m_keyofs[ ki], m_keyofs[ ki+1] - m_keyofs[ ki]);
+		++bucketstart[ bucketIndex( hashar[ ki], nofBuckets)+1];
+	}
+	// Group the keys by bucket (counting sort):
+	std::size_t bi = 0;
+	for (; bi < nofBuckets; ++bi)
+	{
+		bucketstart[ bi+1] += bucketstart[ bi];
+	}
+	std::vector<uint32_t> members( nofKeys);
+	{
+		std::vector<uint32_t> fill( bucketstart.begin(), bucketstart.end()-1);
+		for (ki = 0; ki < nofKeys; ++ki)
+		{
+			members[ fill[ bucketIndex( hashar[ ki], nofBuckets)]++] = ki;
+		}
+	}
+	std::vector<uint32_t> order( nofBuckets);
+	for (bi = 0; bi < nofBuckets; ++bi) order[ bi] = bi;
+	std::sort( order.begin(), order.end(), BucketSizeOrder( &bucketstart));
+
+	m_slots.assign( nofKeys, 0);
+	m_disp.assign( nofBuckets, 0);
+	std::vector<std::size_t> positions;
+	// Slots taken by the keys of the displacement tried are marked with the number of the try, so that
+	// the test for a collision inside the bucket costs one access instead of a search in positions:
+	std::vector<uint32_t> slotmark( nofKeys, 0);
+	uint32_t tryno = 0;
+	std::vector<uint32_t>::const_iterator oi = order.begin(), oe = order.end();
+	for (; oi != oe; ++oi)
+	{
+		uint32_t mi = bucketstart[ *oi], me = bucketstart[ *oi+1];
+		if (me - mi < 2) break;
+		// Search a displacement that maps all keys of the bucket to free and different slots:
+		uint32_t disp = 0;
+		for (; disp < (uint32_t)MaxDisplacement; ++disp)
+		{
+			positions.clear();
+			if (++tryno == 0)
+			{
+				std::fill( slotmark.begin(), slotmark.end(), 0);
+				tryno = 1;
+			}
+			uint32_t ii = mi;
+			for (; ii < me; ++ii)
+			{
+				std::size_t pos = slotIndex( hashar[ members[ ii]], disp, nofKeys);
+				if (m_slots[ pos] || slotmark[ pos] == tryno) break;
+				slotmark[ pos] = tryno;
+				positions.push_back( pos);
+			}
+			if (ii == me) break;
+		}
+		if (disp == (uint32_t)MaxDisplacement) return false;
+		m_disp[ *oi] = disp;
+		std::size_t pi = 0;
+		for (; pi < positions.size(); ++pi)
+		{
+			m_slots[ positions[ pi]] = members[ mi + pi] + 1;
+		}
+	}
+	// The single keys of the remaining buckets get the free slots assigned directly:
+	std::size_t freeslot = 0;
+	for (; oi != oe; ++oi)
+	{
+		uint32_t mi = bucketstart[ *oi], me = bucketstart[ *oi+1];
+		if (mi == me) break;
+		while (m_slots[ freeslot]) ++freeslot;
+		m_slots[ freeslot] = members[ mi] + 1;
+		m_disp[ *oi] = freeslot | DirectSlotFlag;
+	}
+	return true;
+}
+
+void SymbolPerfectHash::build()
+{
+	if (m_keyofs.empty()) m_keyofs.push_back( 0);
+	m_disp.clear();
+	m_slots.clear();
+	std::size_t nofKeys = size();
+	if (nofKeys)
+	{
+		// ... fewer buckets make a smaller displacement table, more buckets make the search for displacements easier
+		static const unsigned int keysPerBucket[] = {4,2,1,0};
+		std::size_t ki = 0;
+		for (; keysPerBucket[ ki]; ++ki)
+		{
+			std::size_t nofBuckets = (nofKeys + keysPerBucket[ ki] - 1) / keysPerBucket[ ki];
+			if (tryBuild( nofBuckets)) break;
+		}
+		if (!keysPerBucket[ ki])
+		{
+			throw std::runtime_error( _TXT("failed to build perfect hash for symbol table"));
+		}
+	}
+	m_built = true;
+}
+
+void SymbolPerfectHash::storeImage( ImageWriter& out) const
+{
+	out.writeArray( m_disp.empty() ? (const uint32_t*)0 : &m_disp[0], m_disp.size());
+	out.writeArray( m_slots.empty() ? (const uint32_t*)0 : &m_slots[0], m_slots.size());
+	out.writeArray( m_keyofs.empty() ? (const uint32_t*)0 : &m_keyofs[0], m_keyofs.size());
+	out.writeString( m_keystr);
+}
+
+void SymbolPerfectHash::loadImage( ImageReader& in)
+{
+	std::size_t arsize;
+	const uint32_t* ar = in.readArray<uint32_t>( arsize);
+	m_disp.assign( ar, ar + arsize);
+	ar = in.readArray<uint32_t>( arsize);
+	m_slots.assign( ar, ar + arsize);
+	ar = in.readArray<uint32_t>( arsize);
+	m_keyofs.assign( ar, ar + arsize);
+	m_keystr = in.readString();
+
+	// Check the consistency of the tables, so that a lookup never accesses memory out of range:
+	std::size_t nofKeys = size();
+	if (m_slots.size() != nofKeys || (nofKeys && m_disp.empty()) || (!m_keyofs.empty() && m_keyofs.back() != m_keystr.size()))
+	{
+		throw std::runtime_error( _TXT("corrupt symbol table in lexer image"));
+	}
+	std::vector<uint32_t>::const_iterator si = m_slots.begin(), se = m_slots.end();
+	for (; si != se; ++si)
+	{
+		if (*si == 0 || *si > nofKeys) throw std::runtime_error( _TXT("corrupt symbol table in lexer image"));
+	}
+	std::vector<uint32_t>::const_iterator di = m_disp.begin(), de = m_disp.end();
+	for (; di != de; ++di)
+	{
+		if ((*di & DirectSlotFlag) && (*di & ~(uint32_t)DirectSlotFlag) >= nofKeys) throw std::runtime_error( _TXT("corrupt symbol table in lexer image"));
+	}
+	std::size_t ki = 1;
+	for (; ki < m_keyofs.size(); ++ki)
+	{
+		if (m_keyofs[ ki] < m_keyofs[ ki-1]) throw std::runtime_error( _TXT("corrupt symbol table in lexer image"));
+	}
+	m_built = true;
+}
+
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Immutable symbol dictionary with a minimal perfect hash for the lookup of keys
+/// \file "symbolPerfectHash.hpp"
+#ifndef _STRUS_PATTERN_SYMBOL_PERFECT_HASH_HPP_INCLUDED
+#define _STRUS_PATTERN_SYMBOL_PERFECT_HASH_HPP_INCLUDED
+#include "strus/base/stdint.h"
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+namespace strus {
+
+/// \brief Forward declaration
+class ImageWriter;
+/// \brief Forward declaration
+class ImageReader;
+
+/// \brief Immutable dictionary of symbols with a minimal perfect hash (hash and displace) built once for all keys
+/// \note A lookup costs one hash of the key, one access to the displacement of the bucket, one to the slot and one key comparison
+class SymbolPerfectHash
+{
+public:
+	SymbolPerfectHash()
+		:m_disp(),m_slots(),m_keyofs(),m_keystr(),m_built(false){}
+
+	/// \brief Add a key, the keys get the indices 1,2,3... in the order they are added
+	/// \remark The keys added must be unique
+	void addKey( const char* key, std::size_t keylen);
+
+	/// \brief Build the hash for all keys added
+	void build();
+
+	/// \brief Evaluate if build was called or the hash was loaded from an image
+	bool built() const
+	{
+		return m_built;
+	}
+
+	/// \brief Get the number of keys
+	std::size_t size() const
+	{
+		return m_keyofs.empty() ? 0 : m_keyofs.size()-1;
+	}
+
+	/// \brief Get the index of a key
+	/// \return the index of the key starting with 1 or 0 if not found
+	uint32_t get( const char* key, std::size_t keylen) const
+	{
+		if (m_slots.empty()) return 0;
+		uint64_t hash = keyHash( key, keylen);
+		uint32_t disp = m_disp[ bucketIndex( hash, m_disp.size())];
+		uint32_t keyidx = m_slots[ slotIndex( hash, disp, m_slots.size())];
+		const char* stored = m_keystr.c_str() + m_keyofs[ keyidx-1];
+		std::size_t storedlen = m_keyofs[ keyidx] - m_keyofs[ keyidx-1];
+		return (storedlen == keylen && 0==std::memcmp( stored, key, keylen)) ? keyidx : 0;
+	}
+
+	/// \brief Get a key by its index
+	std::string key( uint32_t keyidx) const
+	{
+		return std::string( m_keystr.c_str() + m_keyofs[ keyidx-1], m_keyofs[ keyidx] - m_keyofs[ keyidx-1]);
+	}
+
+	/// \brief Write the built hash to an image
+	void storeImage( ImageWriter& out) const;
+	/// \brief Restore a hash from an image written with storeImage
+	void loadImage( ImageReader& in);
+
+private:
+	enum {DirectSlotFlag=0x80000000U};
+
+	/// \brief FNV-1a hash of a key, computed once per lookup
+	static uint64_t keyHash( const char* key, std::size_t keylen)
+	{
+		uint64_t rt = 14695981039346656037ULL;
+		std::size_t ki = 0;
+		for (; ki < keylen; ++ki)
+		{
+			rt ^= (unsigned char)key[ ki];
+			rt *= 1099511628211ULL;
+		}
+		return rt;
+	}
+
+	/// \brief Finalizer of splitmix64 for deriving the slot of a key from its hash and the displacement of its bucket
+	static uint64_t mix( uint64_t val)
+	{
+		val ^= val >> 30;
+		val *= 0xbf58476d1ce4e5b9ULL;
+		val ^= val >> 27;
+		val *= 0x94d049bb133111ebULL;
+		val ^= val >> 31;
+		return val;
+	}
+
+	static std::size_t bucketIndex( uint64_t hash, std::size_t nofBuckets)
+	{
+		return (std::size_t)((hash >> 32) % nofBuckets);
+	}
+
+	/// \brief Get the slot of a key, a displacement with the DirectSlotFlag set is the slot of the single key of a bucket
+	static std::size_t slotIndex( uint64_t hash, uint32_t disp, std::size_t nofSlots)
+	{
+		if (disp & DirectSlotFlag) return disp & ~(uint32_t)DirectSlotFlag;
+		return (std::size_t)(mix( hash ^ ((uint64_t)disp * 0x9e3779b97f4a7c15ULL)) % nofSlots);
+	}
+
+	bool tryBuild( std::size_t nofBuckets);
+
+private:
+	std::vector<uint32_t> m_disp;		///< displacement for each bucket
+	std::vector<uint32_t> m_slots;		///< index of the key starting with 1 for each slot
+	std::vector<uint32_t> m_keyofs;		///< offset of each key in m_keystr plus the end of the last key
+	std::string m_keystr;			///< all keys concatenated
+	bool m_built;
+};
+
+}//namespace
+#endif
+
@@ -19,15 +19,17 @@ using namespace strus;
 void OneByteCharMap::init( const char* src, std::size_t srcsize)
 {
 	typedef textwolf::TextScanner<textwolf::SrcIterator,textwolf::charset::UTF8> TextScanner;
+	prefixsize = asciiPrefixSize( src, srcsize);
+	value.assign( src, prefixsize);
+	posar.clear();
+	posar.push_back( prefixsize);
+	if (prefixsize == srcsize) return;
+
 	textwolf::charset::UTF8 utf8;
-	textwolf::SrcIterator srcitr( src, srcsize, 0);
+	textwolf::SrcIterator srcitr( src + prefixsize, srcsize - prefixsize, 0);
 	TextScanner itr( utf8, srcitr);
 	textwolf::UChar ch;
 
-	value.clear();
-	posar.clear();
-
-	posar.push_back( 0);
 	while ((ch = *itr) != 0)
 	{
 		++itr;
@@ -39,7 +41,7 @@ void OneByteCharMap::init( const char* src, std::size_t srcsize)
 		{
 			value.push_back( 128 + (ch % 128));
 		}
-		posar.push_back( itr.getPosition());
+		posar.push_back( prefixsize + itr.getPosition());
 	}
 }
 
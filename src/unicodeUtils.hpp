@@ -19,12 +19,30 @@ class OneByteCharMap
 {
 public:
 	OneByteCharMap()
-		:value(),posar(){}
+		:value(),posar(),prefixsize(0){}
 
+	/// \brief Map a UTF-8 source to the one byte character set
+	/// \note The ASCII prefix of the source is mapped to itself, the positions are only stored for the characters after it.
+	///	All characters after the prefix are decoded and mapped
 	void init( const char* src, std::size_t srcsize);
 
+	/// \brief Get the position in the source of a position in the value mapped
+	std::size_t origpos( std::size_t pos) const
+	{
+		return pos < prefixsize ? pos : posar[ pos - prefixsize];
+	}
+
+	/// \brief Evaluate the size of the ASCII prefix of a source, mapped to itself
+	static std::size_t asciiPrefixSize( const char* src, std::size_t srcsize)
+	{
+		std::size_t rt = 0;
+		for (; rt < srcsize && (unsigned char)src[ rt] < 128; ++rt){}
+		return rt;
+	}
+
 	std::string value;
-	std::vector<std::size_t> posar;
+	std::vector<std::size_t> posar;		///< source positions of the characters of the value after the ASCII prefix plus the end
+	std::size_t prefixsize;			///< size of the ASCII prefix
 };
 
 struct WCharString
@@ -0,0 +1,290 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Fuzz test of the rule matcher automaton with random program tables, checking the consistency of the results
+///	of different ways to run the same table and the rejection of corrupt images.
+/// \note Meant to be run with the array accesses bound checked (build without STRUS_PATTERN_UNCHECKED_ARRAYS),
+///	so that any access out of range throws an exception and fails the test instead of going unnoticed.
+#include "strus/base/stdint.h"
+#include "ruleMatcherAutomaton.hpp"
+#include "serialization.hpp"
+#include "strus/reference.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
+
+enum {ExpressionEventType=1<<29, DerivedEventMask=3<<29};
+
+static unsigned int getUintValue( const char* arg)
+{
+	char* end = 0;
+	unsigned long rt = std::strtoul( arg, &end, 10);
+	if (!end || *end || !*arg) throw std::runtime_error( "positive integer value expected as argument");
+	return rt;
+}
+
+enum Operation {OpSequence,OpSequenceStruct,OpWithin,OpAny,NofOperations};
+
+/// \brief Create a program for an expression the same way as the pattern matcher does for the operation
+static uint32_t createExpression( strus::ProgramTable& table, Operation op, const std::vector<uint32_t>& args, uint32_t range, uint32_t slotEvent, uint32_t resultHandle)
+{
+	using strus::Trigger;
+	uint32_t argc = args.size();
+	uint32_t initsigval = 0;
+	uint32_t initcount = argc;
+	Trigger::SigType sigtype = Trigger::SigAny;
+	switch (op)
+	{
+		case OpSequence: sigtype = Trigger::SigSequence; initsigval = argc; break;
+		case OpSequenceStruct: sigtype = Trigger::SigSequence; initsigval = argc-1; --initcount; break;
+		case OpWithin: sigtype = Trigger::SigWithin; initsigval = 0xffFFffFF; break;
+		case OpAny: sigtype = Trigger::SigAny; initcount = 1; break;
+		case NofOperations: break;
+	}
+	uint32_t program = table.createProgram( range, strus::ActionSlotDef( initsigval, initcount, slotEvent, resultHandle, 0));
+	uint32_t ai = 0;
+	for (; ai != argc; ++ai)
+	{
+		bool isKeyEvent = true;
+		uint32_t sigval = 0;
+		Trigger::SigType trigger_sigtype = sigtype;
+		switch (op)
+		{
+			case OpSequence: sigval = argc-ai; isKeyEvent = (ai == 0); break;
+			case OpSequenceStruct:
+				if (ai == 0) trigger_sigtype = Trigger::SigDel;
+				else {sigval = argc-ai; isKeyEvent = (ai == 1);}
+				break;
+			case OpWithin: sigval = 1 << (argc-ai-1); break;
+			case OpAny: break;
+			case NofOperations: break;
+		}
+		table.createTrigger( program, args[ ai], isKeyEvent, trigger_sigtype, sigval, 0);
+	}
+	table.doneProgram( program);
+	return program;
+}
+
+static void createRandomTable( strus::ProgramTable& table, unsigned int nofTerms, unsigned int nofPatterns)
+{
+	std::vector<uint32_t> subexpressions;
+	uint32_t expressionCount = 0;
+	unsigned int pi = 0;
+	for (; pi < nofPatterns; ++pi)
+	{
+		Operation op = (Operation)RANDINT( 0, NofOperations);
+		std::vector<uint32_t> args;
+		unsigned int ai = 0, ae = RANDINT( (op == OpSequenceStruct) ? 3 : 2, 5);
+		for (; ai < ae; ++ai)
+		{
+			uint32_t arg = (!subexpressions.empty() && RANDINT( 0, 4) == 0)
+					? subexpressions[ RANDINT( 0, subexpressions.size())]
+					: RANDINT( 1, nofTerms+1);
+			args.push_back( arg);
+		}
+		uint32_t slotEvent = ExpressionEventType | ++expressionCount;
+		bool isResult = RANDINT( 0, 3) != 0;
+		createExpression( table, op, args, RANDINT( 2, 12), slotEvent, isResult ? (pi+1) : 0);
+		subexpressions.push_back( slotEvent);
+	}
+}
+
+/// \brief Result as vector of its end position, start position, result handle and original positions
+typedef std::vector<uint32_t> ResultKey;
+
+static ResultKey getResultKey( const strus::Result& result)
+{
+	ResultKey rt;
+	rt.push_back( result.end_ordpos);
+	rt.push_back( result.start_ordpos);
+	rt.push_back( result.resultHandle);
+	rt.push_back( result.start_origpos);
+	rt.push_back( result.end_origpos);
+	return rt;
+}
+
+/// \brief Get the results of a state machine in the order they were produced
+static std::vector<ResultKey> getResults( const strus::StateMachine& sm)
+{
+	std::vector<ResultKey> rt;
+	strus::StateMachine::ResultList::const_iterator ri = sm.results().begin(), re = sm.results().end();
+	for (; ri != re; ++ri)
+	{
+		rt.push_back( getResultKey( *ri));
+	}
+	return rt;
+}
+
+static void feedDocument( strus::StateMachine& sm, const std::vector<uint32_t>& doc)
+{
+	std::size_t di = 0;
+	for (; di < doc.size(); ++di)
+	{
+		sm.setCurrentPos( di+1);
+		strus::EventData data( 0, di*10, 0, di*10+5, di+1, di+2, 0, 0);
+		sm.doTransition( doc[ di], data);
+	}
+}
+
+static std::vector<ResultKey> matchDocument( const strus::ProgramTable& table, const strus::ProgramTableShard* shard, bool triggerHashIndex, const std::vector<uint32_t>& doc)
+{
+	strus::StateMachine sm( &table, triggerHashIndex, 0, shard);
+	feedDocument( sm, doc);
+	return getResults( sm);
+}
+
+/// \brief Match a document with the programs partitioned into shards and get the results of the shards merged
+static std::vector<ResultKey> matchDocumentShards( const strus::ProgramTable& table, const std::vector<strus::ProgramTableShard>& shards, bool triggerHashIndex, const std::vector<uint32_t>& doc)
+{
+	std::vector<strus::Reference<strus::StateMachine> > statemachines;
+	std::vector<const strus::StateMachine*> statemachinerefs;
+	std::vector<strus::ProgramTableShard>::const_iterator si = shards.begin(), se = shards.end();
+	for (; si != se; ++si)
+	{
+		statemachines.push_back( strus::Reference<strus::StateMachine>( new strus::StateMachine( &table, triggerHashIndex, 0, &*si)));
+		feedDocument( *statemachines.back(), doc);
+		statemachinerefs.push_back( statemachines.back().get());
+	}
+	std::vector<strus::ShardResultRef> merged;
+	strus::StateMachine::mergeShardResults( merged, statemachinerefs.data(), statemachinerefs.size());
+	std::vector<ResultKey> rt;
+	std::vector<strus::ShardResultRef>::const_iterator ri = merged.begin(), re = merged.end();
+	for (; ri != re; ++ri)
+	{
+		rt.push_back( getResultKey( *ri->result));
+	}
+	return rt;
+}
+
+static void checkEqual( const std::vector<ResultKey>& result, const std::vector<ResultKey>& expected, unsigned int round, const char* name)
+{
+	if (result != expected)
+	{
+		std::cerr << "round " << round << ": " << name << " has " << result.size() << " results, expected " << expected.size() << std::endl;
+		throw std::runtime_error( std::string("results differ: ") + name);
+	}
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		if (argc > 2)
+		{
+			std::cerr << "usage: " << argv[0] << " [<nofrounds>]" << std::endl;
+			std::cerr << "<nofrounds> = number of random program tables to check" << std::endl;
+			return 1;
+		}
+		unsigned int nofRounds = (argc > 1) ? getUintValue( argv[1]) : 20;
+		unsigned int nofCorruptImagesDetected = 0;
+		unsigned int nofCorruptImages = 0;
+		unsigned int round = 0;
+		for (; round < nofRounds; ++round)
+		{
+			std::srand( round+1);
+			unsigned int nofTerms = RANDINT( 10, 60);
+			strus::ProgramTable table;
+			createRandomTable( table, nofTerms, RANDINT( 50, 1000));
+			strus::ProgramTable::OptimizeOptions opt;
+			opt.stopwordOccurrenceFactor = (float)RANDINT( 1, 100) / 1000;
+			opt.weightFactor = (float)RANDINT( 1, 20);
+			table.optimize( opt);
+
+			std::vector<uint32_t> doc;
+			unsigned int di = 0, de = RANDINT( 100, 3000);
+			for (; di < de; ++di)
+			{
+				doc.push_back( RANDINT( 1, nofTerms+1));
+			}
+			// Table loaded from an image:
+			strus::ImageWriter out;
+			table.storeImage( out);
+			std::string image = out.content();
+			strus::ProgramTable loaded;
+			{
+				strus::ImageReader in( image.c_str(), image.size());
+				loaded.loadImage( in);
+			}
+			// The triggers of an event are fired in the order of their insertion with both trigger indices,
+			// so the results are expected to be in the same order for all ways to run the table:
+			std::vector<ResultKey> expected = matchDocument( table, 0, false, doc);
+			int ti = 0;
+			for (; ti < 2; ++ti)
+			{
+				bool triggerHashIndex = (ti == 1);
+				const char* indexName = triggerHashIndex ? "hash index" : "bucket index";
+				checkEqual( matchDocument( table, 0, triggerHashIndex, doc), expected, round, indexName);
+				checkEqual( matchDocument( loaded, 0, triggerHashIndex, doc), expected, round, "image");
+
+				// Reuse of a state machine after reset:
+				strus::StateMachine sm( &table, triggerHashIndex, 0);
+				feedDocument( sm, doc);
+				sm.reset( RANDINT( 0, 2) ? 0 : 64);
+				feedDocument( sm, doc);
+				checkEqual( getResults( sm), expected, round, "state machine reset");
+
+				// Programs partitioned into shards, the results of the shards merged in the order of the results of one state machine:
+				std::vector<strus::ProgramTableShard> shards;
+				strus::ProgramTableShard::createShards( shards, table, RANDINT( 2, 6), DerivedEventMask);
+				checkEqual( matchDocumentShards( table, shards, triggerHashIndex, doc), expected, round, "shards");
+			}
+			std::size_t nofResults = expected.size();
+			// Corrupt images must be rejected on load or be processed without an access out of range,
+			// other errors detected while matching with the corrupt table (e.g. an illegal variable) are accepted:
+			unsigned int ci = 0;
+			for (; ci < 20 && !image.empty(); ++ci)
+			{
+				std::string corrupt = image;
+				corrupt[ RANDINT( 0, corrupt.size())] ^= (char)(1 << RANDINT( 0, 8));
+				strus::ProgramTable corruptTable;
+				try
+				{
+					strus::ImageReader in( corrupt.c_str(), corrupt.size());
+					corruptTable.loadImage( in);
+				}
+				catch (const std::runtime_error&)
+				{
+					++nofCorruptImagesDetected;
+					++nofCorruptImages;
+					continue;
+				}
+				++nofCorruptImages;
+				try
+				{
+					matchDocument( corruptTable, 0, RANDINT( 0, 2) == 1, doc);
+				}
+				catch (const std::runtime_error& err)
+				{
+					if (std::strstr( err.what(), "array bound") || std::strstr( err.what(), "illegal list access"))
+					{
+						std::cerr << "round " << round << ": access out of range with a corrupt image not rejected on load" << std::endl;
+						throw;
+					}
+				}
+			}
+			std::cerr << "round " << round << ": " << table.nofPrograms() << " programs, " << table.nofStopWords() << " stop words, " << nofResults << " results" << std::endl;
+		}
+		std::cerr << "corrupt images rejected on load: " << nofCorruptImagesDetected << " of " << nofCorruptImages << std::endl;
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::runtime_error& err)
+	{
+		std::cerr << "error in automaton consistency test: " << err.what() << std::endl;
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "out of memory in automaton consistency test" << std::endl;
+	}
+	return -1;
+}
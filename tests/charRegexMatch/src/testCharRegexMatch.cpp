@@ -12,6 +12,14 @@
 #include "strus/patternLexerInterface.hpp"
 #include "strus/patternLexerInstanceInterface.hpp"
 #include "strus/patternLexerContextInterface.hpp"
+#include "strus/patternLexerStreamContextInterface.hpp"
+#include "strus/patternLexerSegmentContextInterface.hpp"
+#include "strus/patternLexerMatcherContextInterface.hpp"
+#include "strus/patternMatcherDocumentPoolInterface.hpp"
+#include "strus/patternMatcherInterface.hpp"
+#include "strus/patternMatcherInstanceInterface.hpp"
+#include "strus/patternMatcherContextInterface.hpp"
+#include "strus/analyzer/patternMatcherResult.hpp"
 #include "strus/analyzer/patternLexem.hpp"
 #include "strus/base/local_ptr.hpp"
 #include <stdexcept>
@@ -28,10 +36,12 @@
 #include <cmath>
 #include <cstring>
 #include <iomanip>
+#include <algorithm>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
 strus::ErrorBufferInterface* g_errorBuffer = 0;
+enum {NofPoolThreads=3};	///< number of threads of the pool matching many documents
 
 struct PatternDef
 {
@@ -63,6 +73,9 @@ struct TestDef
 	SymbolDef symbols[64];
 	const char* src;
 	ResultDef result[128];
+	bool stream;		///< true if the test is also executed in streaming mode (not possible with edit distance patterns)
+	bool segments;		///< true if the test is also executed on a document with the source repeated in several segments
+	bool vectored;		///< true if the test is also executed in block mode with the option VECTORED set, that must not change the result
 };
 
 static void compile( strus::PatternLexerInstanceInterface* ptinst, const PatternDef* par, const SymbolDef* sar)
@@ -103,6 +116,128 @@ static std::vector<strus::analyzer::PatternLexem>
 	return rt;
 }
 
+static std::vector<strus::analyzer::PatternLexem>
+	matchStream( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, std::size_t chunksize)
+{
+	strus::local_ptr<strus::PatternLexerStreamContextInterface> mt( strus::createPatternLexerStreamContext_std( ptinst, g_errorBuffer));
+	if (!mt.get()) throw std::runtime_error("failed to create regular expression term matcher stream context");
+	std::vector<strus::analyzer::PatternLexem> rt;
+	std::size_t pos = 0;
+	for (; pos < src.size(); pos += chunksize)
+	{
+		std::size_t size = std::min( chunksize, src.size() - pos);
+		std::vector<strus::analyzer::PatternLexem> part = mt->putInput( src.c_str() + pos, size);
+		rt.insert( rt.end(), part.begin(), part.end());
+	}
+	std::vector<strus::analyzer::PatternLexem> rest = mt->close();
+	rt.insert( rt.end(), rest.begin(), rest.end());
+	return rt;
+}
+
+static std::vector<strus::analyzer::PatternLexem>
+	matchSegments( strus::PatternLexerInstanceInterface* ptinst, const std::string& src, std::size_t nofSegments)
+{
+	strus::local_ptr<strus::PatternLexerSegmentContextInterface> mt( strus::createPatternLexerSegmentContext_std( ptinst, g_errorBuffer));
+	if (!mt.get()) throw std::runtime_error("failed to create regular expression term matcher segment context");
+	std::vector<strus::PatternLexerSegmentContextInterface::Segment> segments;
+	std::size_t si = 0;
+	for (; si != nofSegments; ++si)
+	{
+		segments.push_back( strus::PatternLexerSegmentContextInterface::Segment( (si+1) * 100/*origseg*/, src.c_str(), src.size()));
+	}
+	return mt->matchSegments( &segments[0], segments.size());
+}
+
+/// \brief Create a pattern matcher on the lexems detected with some patterns for testing the lexer feeding the pattern matcher directly
+static strus::PatternMatcherInstanceInterface* createTestPatternMatcher( const strus::PatternMatcherInterface* matcher, const PatternDef* par)
+{
+	strus::local_ptr<strus::PatternMatcherInstanceInterface> rt( matcher->createInstance());
+	if (!rt.get()) throw std::runtime_error("failed to create pattern matcher instance");
+	std::size_t pi = 0;
+	for (; par[pi].expression; ++pi)
+	{
+		char name[ 64];
+		std::snprintf( name, sizeof(name), "term_%u", par[pi].id);
+		rt->pushTerm( par[pi].id);
+		rt->definePattern( name, ""/*formatstring*/, true);
+
+		std::snprintf( name, sizeof(name), "pair_%u", par[pi].id);
+		rt->pushTerm( par[pi].id);
+		rt->pushTerm( par[pi].id);
+		rt->pushExpression( strus::PatternMatcherInstanceInterface::OpSequence, 2, 2/*range*/, 0/*cardinality*/);
+		rt->definePattern( name, ""/*formatstring*/, true);
+	}
+	if (!rt->compile())
+	{
+		throw std::runtime_error("error building pattern matcher automaton");
+	}
+	return rt.release();
+}
+
+static std::vector<strus::analyzer::PatternMatcherResult>
+	matchPipeline( strus::PatternLexerInstanceInterface* ptinst, const strus::PatternMatcherInstanceInterface* mtinst, const std::string& src)
+{
+	strus::local_ptr<strus::PatternMatcherContextInterface> mt( mtinst->createContext());
+	if (!mt.get()) throw std::runtime_error("failed to create pattern matcher context");
+	std::vector<strus::analyzer::PatternLexem> lexems = match( ptinst, src);
+	std::vector<strus::analyzer::PatternLexem>::const_iterator li = lexems.begin(), le = lexems.end();
+	for (; li != le; ++li)
+	{
+		mt->putInput( *li);
+	}
+	return mt->fetchResults();
+}
+
+static bool checkMatcherResult( const std::vector<strus::analyzer::PatternMatcherResult>& result, const std::vector<strus::analyzer::PatternMatcherResult>& expected)
+{
+	if (result.size() != expected.size()) return false;
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator
+		ri = result.begin(), re = result.end(), xi = expected.begin();
+	for (; ri != re; ++ri,++xi)
+	{
+		if (0!=std::strcmp( ri->name(), xi->name())) return false;
+		if (ri->ordpos() != xi->ordpos() || ri->ordend() != xi->ordend()) return false;
+		if (ri->origpos().ofs() != xi->origpos().ofs() || ri->origend().ofs() != xi->origend().ofs()) return false;
+	}
+	return true;
+}
+
+static bool checkSegmentsResult( const std::vector<strus::analyzer::PatternLexem>& result, const std::vector<strus::analyzer::PatternLexem>& singleResult, std::size_t nofSegments)
+{
+	if (result.size() != singleResult.size() * nofSegments) return false;
+	int maxordpos = singleResult.empty() ? 0 : singleResult.back().ordpos();
+	std::vector<strus::analyzer::PatternLexem>::const_iterator ri = result.begin();
+	std::size_t si = 0;
+	for (; si != nofSegments; ++si)
+	{
+		std::vector<strus::analyzer::PatternLexem>::const_iterator xi = singleResult.begin(), xe = singleResult.end();
+		for (; xi != xe; ++xi,++ri)
+		{
+			if (ri->id() != xi->id()) return false;
+			if (ri->ordpos() != xi->ordpos() + (int)si * maxordpos) return false;
+			if (ri->origpos().seg() != (si+1) * 100) return false;
+			if (ri->origpos().ofs() != xi->origpos().ofs()) return false;
+			if (ri->origsize() != xi->origsize()) return false;
+		}
+	}
+	return true;
+}
+
+static bool checkResult( const std::vector<strus::analyzer::PatternLexem>& result, const ResultDef* expected)
+{
+	std::vector<strus::analyzer::PatternLexem>::const_iterator ri = result.begin(), re = result.end();
+	std::size_t ridx=0;
+	for (; ri != re && expected[ridx].origsize != 0; ++ridx,++ri)
+	{
+		const ResultDef& exp = expected[ridx];
+		if (exp.id != ri->id()) break;
+		if (exp.ordpos != ri->ordpos()) break;
+		if (exp.origpos != ri->origpos().ofs()) break;
+		if (exp.origsize != ri->origsize()) break;
+	}
+	return (ri == re && expected[ridx].origsize == 0);
+}
+
 static const TestDef g_tests[32] =
 {
 	{
@@ -157,7 +292,9 @@ static const TestDef g_tests[32] =
 			{3,17,89,2},
 			{2,18,94,7},
 			{0,0,0,0}
-		}
+		},
+		true,
+		true
 	},
 	{
 		{
@@ -195,6 +332,43 @@ static const TestDef g_tests[32] =
 			{0,0,0,0}
 		}
 	},
+	{
+		{
+			{1,"a\xC3\xB6\xC3\xBC ~1",0,1,true}, //... "aöü" with edit distance, scanned on the one byte character map
+			{2,"[0-9]+",0,1,true},			//... exact pattern, scanned on the source
+			{0,0,0,0,false}
+		},
+		{
+			{0,0,0}
+		},
+		"12 a\xC3\xB6\xC3\xBC 345 a\xC3\xBC",
+		{
+			{2,1,0,2},
+			{1,2,3,5},
+			{2,3,9,3},
+			{1,4,13,3},
+			{0,0,0,0}
+		}
+	},
+	{
+		{
+			{1,"[\xC3\x80-\xC9\x8F]+",0,1,true},	//... Latin-1 supplement to Latin extended-B, not mapped to a contiguous range in the one byte character map
+			{2,"a\xC3\xB6\xC3\xBC ~1",0,1,true},	//... "aöü" with edit distance, scanned on the one byte character map in vectored mode too
+			{0,0,0,0,false}
+		},
+		{
+			{0,0,0}
+		},
+		"x \xC8\x81\xC8\x82 a\xC3\xBC",
+		{
+			{1,1,2,4},
+			{2,2,7,3},
+			{0,0,0,0}
+		},
+		false,
+		false,
+		true
+	},
 	{
 		{
 			{0,0,0,0,false}
@@ -210,11 +384,47 @@ static const TestDef g_tests[32] =
 };
 
 
+/// \brief Test that a match longer than the maximum size of a lexem does not fail the document, neither in block nor in streaming mode
+static void testOversizedMatch( const strus::PatternLexerInterface* pt)
+{
+	static const PatternDef patterns[] = {
+		{1,"[a-z]+",0,1,true},
+		{2,"[0-9]+",0,1,true},
+		{0,0,0,0,false}
+	};
+	static const SymbolDef symbols[] = {{0,0,0}};
+	std::string src( 70000, 'a');
+	src.append( " 12");
+
+	for (int mode=0; mode < 2; ++mode)
+	{
+		const char* modename = mode ? "streaming mode" : "block mode";
+		std::cerr << "executing test of a match longer than the maximum lexem size in " << modename << std::endl;
+		strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( pt->createInstance());
+		if (!ptinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+		ptinst->defineOption( "DOTALL", 0);
+		if (mode) ptinst->defineOption( "STREAM", 0);
+		compile( ptinst.get(), patterns, symbols);
+
+		std::vector<strus::analyzer::PatternLexem> result = mode
+			? matchStream( ptinst.get(), src, 1000)
+			: match( ptinst.get(), src);
+		if (g_errorBuffer->hasError())
+		{
+			throw std::runtime_error( std::string("error matching a source with a match longer than the maximum lexem size in ") + modename);
+		}
+		if (result.empty() || result.back().id() != 2 || result.back().origpos().ofs() != 70001 || result.back().origsize() != 2)
+		{
+			throw std::runtime_error( std::string("lexem following a match longer than the maximum lexem size not found in ") + modename);
+		}
+	}
+}
+
 int main( int argc, const char** argv)
 {
 	try
 	{
-		g_errorBuffer = strus::createErrorBuffer_standard( 0, 1, NULL/*debug trace interface*/);
+		g_errorBuffer = strus::createErrorBuffer_standard( 0, 1+NofPoolThreads, NULL/*debug trace interface*/);
 		if (!g_errorBuffer)
 		{
 			std::cerr << "construction of error buffer failed" << std::endl;
@@ -245,22 +455,145 @@ int main( int argc, const char** argv)
 			{
 				throw std::runtime_error( "error matching");
 			}
-			std::vector<strus::analyzer::PatternLexem>::const_iterator ri = result.begin(), re = result.end();
-			std::size_t ridx=0;
-			const ResultDef* expected = g_tests[ti].result;
-			for (; ri != re && expected[ridx].origsize != 0; ++ridx,++ri)
+			if (!checkResult( result, g_tests[ti].result))
 			{
-				const ResultDef& exp = expected[ridx];
-				if (exp.id != ri->id()) break;
-				if (exp.ordpos != ri->ordpos()) break;
-				if (exp.origpos != ri->origpos().ofs()) break;
-				if (exp.origsize != ri->origsize()) break;
+				throw std::runtime_error( "test failed");
 			}
-			if (ri != re || expected[ridx].origsize != 0)
 			{
-				throw std::runtime_error( "test failed");
+				std::cerr << "executing test " << (ti+1) << " with lexer loaded from image" << std::endl;
+				char imagefilename[ 64];
+				std::snprintf( imagefilename, sizeof(imagefilename), "lexer_%u.img", (unsigned int)(ti+1));
+				if (!strus::storePatternLexerImage_std( ptinst.get(), imagefilename, g_errorBuffer))
+				{
+					throw std::runtime_error( "error storing lexer image");
+				}
+				strus::local_ptr<strus::PatternLexerInstanceInterface> ptimageinst( strus::loadPatternLexerImage_std( imagefilename, g_errorBuffer));
+				if (!ptimageinst.get()) throw std::runtime_error("failed to load lexer image");
+				std::vector<strus::analyzer::PatternLexem> imageresult = match( ptimageinst.get(), g_tests[ti].src);
+				if (g_errorBuffer->hasError())
+				{
+					throw std::runtime_error( "error matching with lexer loaded from image");
+				}
+				if (!checkResult( imageresult, g_tests[ti].result))
+				{
+					throw std::runtime_error( "test with lexer loaded from image failed");
+				}
+				std::remove( imagefilename);
+			}
+			{
+				std::cerr << "executing test " << (ti+1) << " with the lexer feeding a pattern matcher directly" << std::endl;
+				strus::local_ptr<strus::PatternMatcherInterface> mt( strus::createPatternMatcher_std( g_errorBuffer));
+				if (!mt.get()) throw std::runtime_error("failed to create pattern matcher");
+				strus::local_ptr<strus::PatternMatcherInstanceInterface> mtinst( createTestPatternMatcher( mt.get(), g_tests[ti].patterns));
+				std::vector<strus::analyzer::PatternMatcherResult> expected = matchPipeline( ptinst.get(), mtinst.get(), g_tests[ti].src);
+				if (expected.empty())
+				{
+					throw std::runtime_error( "no pattern matcher results for the lexems detected");
+				}
+				strus::local_ptr<strus::PatternLexerMatcherContextInterface> lmt( strus::createPatternLexerMatcherContext_std( ptinst.get(), mtinst.get(), g_errorBuffer));
+				if (!lmt.get()) throw std::runtime_error("failed to create lexer pattern matcher context");
+				int ii = 0;
+				for (; ii < 2; ++ii)
+				{
+					//... the second run checks that the context starts with a new document on each call
+					std::vector<strus::analyzer::PatternMatcherResult> matcherResult = lmt->match( g_tests[ti].src, std::strlen( g_tests[ti].src));
+					if (g_errorBuffer->hasError())
+					{
+						throw std::runtime_error( "error matching with the lexer feeding a pattern matcher directly");
+					}
+					if (!checkMatcherResult( matcherResult, expected))
+					{
+						throw std::runtime_error( "test with the lexer feeding a pattern matcher directly failed");
+					}
+				}
+				std::cerr << "executing test " << (ti+1) << " with a pool of threads matching many documents" << std::endl;
+				strus::local_ptr<strus::PatternMatcherDocumentPoolInterface> pool( strus::createPatternMatcherDocumentPool_std( ptinst.get(), mtinst.get(), NofPoolThreads, 2/*queue size*/, g_errorBuffer));
+				if (!pool.get()) throw std::runtime_error("failed to create pattern matcher document pool");
+				std::vector<strus::PatternMatcherDocumentPoolInterface::Document> docs( 3 * NofPoolThreads + 1, strus::PatternMatcherDocumentPoolInterface::Document( g_tests[ti].src, std::strlen( g_tests[ti].src)));
+				for (ii = 0; ii < 2; ++ii)
+				{
+					//... the second run checks the results after the result values of the first one have been released
+					std::vector<std::vector<strus::analyzer::PatternMatcherResult> > poolResults = pool->matchDocuments( docs.data(), docs.size());
+					if (g_errorBuffer->hasError())
+					{
+						throw std::runtime_error( "error matching with a pool of threads");
+					}
+					if (poolResults.size() != docs.size())
+					{
+						throw std::runtime_error( "number of results of the pool of threads differs from the number of documents");
+					}
+					std::vector<std::vector<strus::analyzer::PatternMatcherResult> >::const_iterator pi = poolResults.begin(), pe = poolResults.end();
+					for (; pi != pe; ++pi)
+					{
+						if (!checkMatcherResult( *pi, expected))
+						{
+							throw std::runtime_error( "test with a pool of threads matching many documents failed");
+						}
+					}
+				}
+			}
+			if (g_tests[ti].stream)
+			{
+				std::cerr << "executing test " << (ti+1) << " in streaming mode" << std::endl;
+				strus::local_ptr<strus::PatternLexerInstanceInterface> ptstreaminst( pt->createInstance());
+				if (!ptstreaminst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+
+				ptstreaminst->defineOption( "DOTALL", 0);
+				ptstreaminst->defineOption( "STREAM", 0);
+				compile( ptstreaminst.get(), g_tests[ti].patterns, g_tests[ti].symbols);
+				if (g_errorBuffer->hasError())
+				{
+					throw std::runtime_error( "error building automaton for test in streaming mode");
+				}
+				static const std::size_t chunksizes[] = {1, 7, 64, 100000, 0};
+				for (std::size_t ci=0; chunksizes[ci]; ++ci)
+				{
+					std::vector<strus::analyzer::PatternLexem> streamresult = matchStream( ptstreaminst.get(), g_tests[ti].src, chunksizes[ci]);
+					if (g_errorBuffer->hasError())
+					{
+						throw std::runtime_error( "error matching in streaming mode");
+					}
+					if (!checkResult( streamresult, g_tests[ti].result))
+					{
+						throw std::runtime_error( "test in streaming mode failed");
+					}
+				}
+			}
+			if (g_tests[ti].segments || g_tests[ti].vectored)
+			{
+				std::cerr << "executing test " << (ti+1) << " with option VECTORED" << std::endl;
+				strus::local_ptr<strus::PatternLexerInstanceInterface> ptsegmentinst( pt->createInstance());
+				if (!ptsegmentinst.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+
+				ptsegmentinst->defineOption( "DOTALL", 0);
+				ptsegmentinst->defineOption( "VECTORED", 0);
+				compile( ptsegmentinst.get(), g_tests[ti].patterns, g_tests[ti].symbols);
+				if (g_errorBuffer->hasError())
+				{
+					throw std::runtime_error( "error building automaton for test on segments");
+				}
+				std::vector<strus::analyzer::PatternLexem> singleResult = match( ptsegmentinst.get(), g_tests[ti].src);
+				//... the source is scanned in block mode as without the option VECTORED, it only affects the database for segments
+				if (g_errorBuffer->hasError() || !checkResult( singleResult, g_tests[ti].result))
+				{
+					throw std::runtime_error( "test in block mode with option VECTORED failed");
+				}
+				static const std::size_t nofSegmentsAr[] = {1, 2, 5, 0};
+				for (std::size_t ni=0; g_tests[ti].segments && nofSegmentsAr[ni]; ++ni)
+				{
+					std::vector<strus::analyzer::PatternLexem> segmentsResult = matchSegments( ptsegmentinst.get(), g_tests[ti].src, nofSegmentsAr[ni]);
+					if (g_errorBuffer->hasError())
+					{
+						throw std::runtime_error( "error matching on segments");
+					}
+					if (!checkSegmentsResult( segmentsResult, singleResult, nofSegmentsAr[ni]))
+					{
+						throw std::runtime_error( "test on segments failed");
+					}
+				}
 			}
 		}
+		testOversizedMatch( pt.get());
 		std::cerr << "OK" << std::endl;
 		delete g_errorBuffer;
 		return 0;
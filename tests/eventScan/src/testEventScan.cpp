@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Microbenchmark and verification of the kernels for searching events in the trigger table
+#include "strus/base/stdint.h"
+#include "eventScan.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
+
+enum {NofDistinctEvents=64};
+
+static unsigned int getUintValue( const char* arg)
+{
+	char* end = 0;
+	unsigned long rt = std::strtoul( arg, &end, 10);
+	if (!end || *end || !*arg) throw std::runtime_error( "positive integer value expected as argument");
+	return rt;
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		std::srand( 123);
+		if (argc > 2)
+		{
+			std::cerr << "usage: " << argv[0] << " [<nofelements>]" << std::endl;
+			std::cerr << "<nofelements> = number of elements scanned per kernel and bucket size" << std::endl;
+			return 1;
+		}
+		std::size_t nofElements = (argc > 1) ? getUintValue( argv[1]) : 10000000;
+
+		std::cerr << "best implementation: " << strus::eventScanImplementationName( strus::bestEventScanImplementation()) << std::endl;
+		std::size_t bucketSize = 16;
+		for (; bucketSize <= (1<<20); bucketSize *= 4)
+		{
+			std::vector<uint32_t> eventar;
+			eventar.reserve( bucketSize);
+			std::size_t ei = 0;
+			for (; ei < bucketSize; ++ei)
+			{
+				eventar.push_back( RANDINT( 1, NofDistinctEvents+1));
+			}
+			std::vector<uint32_t> expected( bucketSize);
+			std::vector<uint32_t> result( bucketSize);
+			uint32_t event = RANDINT( 1, NofDistinctEvents+1);
+			std::size_t nofExpected = strus::getEventScanFunction( strus::EventScanScalar)( &expected[0], event, &eventar[0], bucketSize);
+
+			std::size_t nofIterations = nofElements / bucketSize + 1;
+			std::cerr << "bucket size " << bucketSize << ":";
+			unsigned int ii = 0;
+			for (; ii < strus::NofEventScanImplementations; ++ii)
+			{
+				strus::EventScanImplementation impl = (strus::EventScanImplementation)ii;
+				strus::EventScanFunction func = strus::getEventScanFunction( impl);
+				if (!func) continue;
+
+				std::size_t checksum = 0;
+				std::clock_t start = std::clock();
+				std::size_t ti = 0;
+				for (; ti < nofIterations; ++ti)
+				{
+					checksum += func( &result[0], event, &eventar[0], bucketSize);
+				}
+				double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+
+				if (checksum != nofExpected * nofIterations
+				||  0!=std::memcmp( &expected[0], &result[0], nofExpected * sizeof(uint32_t)))
+				{
+					throw std::runtime_error( std::string("result of event scan implementation '") + strus::eventScanImplementationName( impl) + "' differs from the expected");
+				}
+				double nsPerElement = duration * 1.0E9 / ((double)nofIterations * bucketSize);
+				std::cerr << " " << strus::eventScanImplementationName( impl) << " " << std::fixed << std::setprecision(3) << nsPerElement << " ns";
+			}
+			std::cerr << std::endl;
+		}
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::runtime_error& err)
+	{
+		std::cerr << "error in event scan test: " << err.what() << std::endl;
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "out of memory in event scan test" << std::endl;
+	}
+	return -1;
+}
+
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Test of the literal path of the lexer: the detection of the patterns that are literal alternations and
+///	the literal trie matching them, if hyperscan does not provide literal databases
+#include "strus/base/stdint.h"
+#include "literalTrie.hpp"
+#include "serialization.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
+
+static unsigned int getUintValue( const char* arg)
+{
+	char* end = 0;
+	unsigned long rt = std::strtoul( arg, &end, 10);
+	if (!end || *end || !*arg) throw std::runtime_error( "positive integer value expected as argument");
+	return rt;
+}
+
+struct LiteralAlternativesTest
+{
+	const char* expression;
+	bool caseless;
+	const char* literals[4];	///< expected literals or {0} if the expression is not a literal alternation
+};
+
+static void testParseLiteralAlternatives()
+{
+	static const LiteralAlternativesTest tests[] = {
+		{"abc", false, {"abc",0}},
+		{"abc|de|f", false, {"abc","de","f",0}},
+		{"a\\.b\\|c", false, {"a.b|c",0}},
+		{"Hello World", true, {"Hello World",0}},
+		{"\xC3\xA4pfel", false, {"\xC3\xA4pfel",0}},
+		{"\xC3\xA4pfel", true, {0}},
+		{"a.b", false, {0}},
+		{"ab|", false, {0}},
+		{"a||b", false, {0}},
+		{"\\d+", false, {0}},
+		{"[ab]", false, {0}},
+		{"(ab)", false, {0}},
+		{"ab*", false, {0}},
+		{0, false, {0}}
+	};
+	std::size_t ti = 0;
+	for (; tests[ti].expression; ++ti)
+	{
+		const LiteralAlternativesTest& test = tests[ ti];
+		std::vector<std::string> expected;
+		for (std::size_t li = 0; test.literals[ li]; ++li)
+		{
+			expected.push_back( test.literals[ li]);
+		}
+		std::vector<std::string> literals;
+		bool isLiteral = strus::parseLiteralAlternatives( literals, test.expression, test.caseless);
+		if (isLiteral != !expected.empty() || (isLiteral && literals != expected))
+		{
+			std::cerr << "expression '" << test.expression << "' " << (isLiteral ? "parsed" : "not parsed") << " as literal alternation" << std::endl;
+			throw std::runtime_error( "parse of literal alternations failed");
+		}
+	}
+}
+
+/// \brief Match event as tuple of start, end and pattern identifier, the order of events of the same start reported by hyperscan
+struct Match
+{
+	unsigned long long from;
+	unsigned long long to;
+	unsigned int id;
+
+	Match( unsigned long long from_, unsigned long long to_, unsigned int id_)
+		:from(from_),to(to_),id(id_){}
+
+	bool operator<( const Match& o) const
+	{
+		if (from != o.from) return from < o.from;
+		if (to != o.to) return to < o.to;
+		return id < o.id;
+	}
+	bool operator==( const Match& o) const
+	{
+		return from == o.from && to == o.to && id == o.id;
+	}
+};
+
+static int collectMatch( unsigned int id, unsigned long long from, unsigned long long to, unsigned int, void* context)
+{
+	std::vector<Match>* matches = (std::vector<Match>*)context;
+	matches->push_back( Match( from, to, id));
+	return 0;
+}
+
+static std::string randomString( const char* alphabet, std::size_t size)
+{
+	std::size_t alphabetsize = std::strlen( alphabet);
+	std::string rt;
+	std::size_t ci = 0;
+	for (; ci < size; ++ci)
+	{
+		rt.push_back( alphabet[ RANDINT( 0, alphabetsize)]);
+	}
+	return rt;
+}
+
+static bool equalChar( unsigned char aa, unsigned char bb, bool caseless)
+{
+	if (caseless)
+	{
+		if (aa >= 'A' && aa <= 'Z') aa = aa - 'A' + 'a';
+		if (bb >= 'A' && bb <= 'Z') bb = bb - 'A' + 'a';
+	}
+	return aa == bb;
+}
+
+/// \brief Matches of a list of literals found by comparing each literal at every position of the source
+static std::vector<Match> naiveSearch( const std::vector<std::string>& literals, const std::vector<unsigned int>& ids, const std::string& src, bool caseless)
+{
+	std::vector<Match> rt;
+	std::size_t pos = 0;
+	for (; pos < src.size(); ++pos)
+	{
+		std::size_t li = 0, le = literals.size();
+		for (; li != le; ++li)
+		{
+			const std::string& literal = literals[ li];
+			if (literal.size() > src.size() - pos) continue;
+			std::size_t ci = 0, ce = literal.size();
+			for (; ci != ce && equalChar( src[ pos+ci], literal[ ci], caseless); ++ci){}
+			if (ci == ce)
+			{
+				rt.push_back( Match( pos, pos + literal.size(), ids[ li]));
+			}
+		}
+	}
+	std::sort( rt.begin(), rt.end());
+	rt.erase( std::unique( rt.begin(), rt.end()), rt.end());
+	return rt;
+}
+
+static void checkMatches( const std::vector<Match>& result, const std::vector<Match>& expected, unsigned int round, const char* name)
+{
+	if (result != expected)
+	{
+		std::cerr << "round " << round << ": " << name << " has " << result.size() << " matches, expected " << expected.size() << std::endl;
+		throw std::runtime_error( std::string("matches of literal trie differ: ") + name);
+	}
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		if (argc > 2)
+		{
+			std::cerr << "usage: " << argv[0] << " [<nofrounds>]" << std::endl;
+			std::cerr << "<nofrounds> = number of random sets of literals to check" << std::endl;
+			return 1;
+		}
+		unsigned int nofRounds = (argc > 1) ? getUintValue( argv[1]) : 100;
+		testParseLiteralAlternatives();
+
+		std::size_t nofMatches = 0;
+		unsigned int round = 0;
+		for (; round < nofRounds; ++round)
+		{
+			std::srand( round+1);
+			// A small alphabet, so that there are many literals that are prefixes of others and many overlapping matches:
+			const char* alphabet = (round % 2 == 0) ? "abcAB" : "abcdefghijklmnopqrstuvwxyz.\xC3\xA4";
+			bool caseless = RANDINT( 0, 2) == 1;
+			std::vector<std::string> literals;
+			std::vector<unsigned int> ids;
+			strus::LiteralTrie trie;
+			unsigned int li = 0, le = RANDINT( 1, 300);
+			for (; li < le; ++li)
+			{
+				std::string literal = randomString( alphabet, RANDINT( 1, 8));
+				unsigned int id = RANDINT( 1, le+1);
+				literals.push_back( literal);
+				ids.push_back( id);
+				trie.add( literal, id, caseless);
+			}
+			std::string src = randomString( alphabet, RANDINT( 0, 2000));
+			std::vector<Match> expected = naiveSearch( literals, ids, src, caseless);
+
+			std::vector<Match> matches;
+			if (!trie.scan( src.c_str(), src.size(), &collectMatch, &matches))
+			{
+				throw std::runtime_error( "scan of literal trie terminated");
+			}
+			checkMatches( matches, expected, round, "trie");
+
+			strus::ImageWriter out;
+			trie.storeImage( out);
+			std::string image = out.content();
+			strus::ImageReader in( image.c_str(), image.size());
+			strus::LiteralTrie loaded;
+			loaded.loadImage( in, le);
+			if (!in.eof()) throw std::runtime_error( "literal trie image not read completely");
+			matches.clear();
+			loaded.scan( src.c_str(), src.size(), &collectMatch, &matches);
+			checkMatches( matches, expected, round, "image");
+			nofMatches += expected.size();
+		}
+		std::cerr << "checked " << nofRounds << " sets of literals with " << nofMatches << " matches" << std::endl;
+		std::cerr << "OK" << std::endl;
+		return 0;
+	}
+	catch (const std::runtime_error& err)
+	{
+		std::cerr << "error in literal trie test: " << err.what() << std::endl;
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "out of memory in literal trie test" << std::endl;
+	}
+	return -1;
+}
+
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Regression benchmark of the lexer on a document with many overlapping lexems on different levels
+#include "strus/base/stdint.h"
+#include "strus/lib/pattern.hpp"
+#include "strus/lib/error.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "strus/patternLexerInterface.hpp"
+#include "strus/patternLexerInstanceInterface.hpp"
+#include "strus/patternLexerContextInterface.hpp"
+#include "strus/patternLexerStreamContextInterface.hpp"
+#include "strus/patternLexerSegmentContextInterface.hpp"
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/base/local_ptr.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
+
+strus::ErrorBufferInterface* g_errorBuffer = 0;
+
+struct PatternDef
+{
+	unsigned int id;
+	const char* expression;
+	unsigned int level;
+};
+
+/// \brief Patterns producing many events overlapping each other, most of them superseded by the ones with a higher level
+static const PatternDef g_patterns[] =
+{
+	{1, "\\w", 0},
+	{2, "\\w+", 1},
+	{3, "[a-z]+\\b", 2},
+	{4, "\\w+(\\s\\w+){1,3}\\b", 3},
+	{5, "\\w+(\\s\\w+){7}\\b", 4},
+	{6, "ab|xyz|qu", 2},	// literal alternation, compiled into a separate literal database in block mode
+	{0, 0, 0}
+};
+
+static unsigned int getUintValue( const char* arg)
+{
+	char* end = 0;
+	unsigned long rt = std::strtoul( arg, &end, 10);
+	if (!end || *end || !*arg) throw std::runtime_error( "positive integer value expected as argument");
+	return rt;
+}
+
+static std::string createDocument( unsigned int nofWords)
+{
+	std::string rt;
+	unsigned int wi = 0;
+	for (; wi != nofWords; ++wi)
+	{
+		if (wi) rt.push_back( ' ');
+		unsigned int ci = 0, ce = RANDINT( 2, 11);
+		for (; ci != ce; ++ci)
+		{
+			rt.push_back( 'a' + RANDINT( 0, 26));
+		}
+	}
+	return rt;
+}
+
+static strus::PatternLexerInstanceInterface* createLexer( const strus::PatternLexerInterface* lexer, const char* mode)
+{
+	strus::local_ptr<strus::PatternLexerInstanceInterface> rt( lexer->createInstance());
+	if (!rt.get()) throw std::runtime_error("failed to create regular expression term matcher instance");
+	if (mode) rt->defineOption( mode, 0);
+	std::size_t pi = 0;
+	for (; g_patterns[pi].expression; ++pi)
+	{
+		rt->defineLexem( g_patterns[pi].id, g_patterns[pi].expression, 0/*resultIndex*/, g_patterns[pi].level, strus::analyzer::BindContent);
+	}
+	if (!rt->compile())
+	{
+		throw std::runtime_error("error building term match automaton");
+	}
+	return rt.release();
+}
+
+static void compareResults( const std::vector<strus::analyzer::PatternLexem>& result, const std::vector<strus::analyzer::PatternLexem>& expected, const char* name)
+{
+	if (result.size() != expected.size())
+	{
+		throw std::runtime_error( std::string("results of ") + name + " differ in size");
+	}
+	std::vector<strus::analyzer::PatternLexem>::const_iterator ri = result.begin(), re = result.end(), xi = expected.begin();
+	for (; ri != re; ++ri,++xi)
+	{
+		if (ri->id() != xi->id() || ri->ordpos() != xi->ordpos() || ri->origpos().ofs() != xi->origpos().ofs() || ri->origsize() != xi->origsize())
+		{
+			throw std::runtime_error( std::string("results of ") + name + " differ");
+		}
+	}
+}
+
+int main( int argc, const char** argv)
+{
+	try
+	{
+		g_errorBuffer = strus::createErrorBuffer_standard( 0, 1, NULL/*debug trace interface*/);
+		if (!g_errorBuffer)
+		{
+			std::cerr << "construction of error buffer failed" << std::endl;
+			return -1;
+		}
+		if (argc > 2)
+		{
+			std::cerr << "usage: " << argv[0] << " [<nofwords>]" << std::endl;
+			std::cerr << "<nofwords> = number of words of the document to scan" << std::endl;
+			delete g_errorBuffer;
+			return 1;
+		}
+		unsigned int nofWords = (argc > 1) ? getUintValue( argv[1]) : 100000;
+		std::srand( 123);
+		std::string doc = createDocument( nofWords);
+
+		strus::local_ptr<strus::PatternLexerInterface> pt( strus::createPatternLexer_std( g_errorBuffer));
+		if (!pt.get()) throw std::runtime_error("failed to create regular expression term matcher");
+
+		// Scan the document as a whole:
+		strus::local_ptr<strus::PatternLexerInstanceInterface> ptinst( createLexer( pt.get(), 0));
+		strus::local_ptr<strus::PatternLexerContextInterface> ctx( ptinst->createContext());
+		if (!ctx.get()) throw std::runtime_error("failed to create regular expression term matcher context");
+		std::clock_t start = std::clock();
+		std::vector<strus::analyzer::PatternLexem> result = ctx->match( doc.c_str(), doc.size());
+		double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+		if (g_errorBuffer->hasError()) throw std::runtime_error( "error matching document");
+		if (result.empty()) throw std::runtime_error( "no lexems found in document");
+		std::cerr << "scanned " << doc.size() << " bytes with " << result.size() << " lexems in " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+
+		// Scan the document with the database compiled for the platform of the host:
+		strus::local_ptr<strus::PatternLexerInstanceInterface> pthostinst( createLexer( pt.get(), "HOST"));
+		strus::local_ptr<strus::PatternLexerContextInterface> hostctx( pthostinst->createContext());
+		if (!hostctx.get()) throw std::runtime_error("failed to create regular expression term matcher context");
+		start = std::clock();
+		std::vector<strus::analyzer::PatternLexem> hostresult = hostctx->match( doc.c_str(), doc.size());
+		duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+		if (g_errorBuffer->hasError()) throw std::runtime_error( "error matching document with database compiled for the host");
+		std::cerr << "scanned " << doc.size() << " bytes with database compiled for the host in " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+		compareResults( hostresult, result, "database compiled for the host");
+
+		// Scan the document in streaming mode, where the superseding of lexems is done chunk by chunk:
+		strus::local_ptr<strus::PatternLexerInstanceInterface> ptstreaminst( createLexer( pt.get(), "STREAM"));
+		strus::local_ptr<strus::PatternLexerStreamContextInterface> streamctx( strus::createPatternLexerStreamContext_std( ptstreaminst.get(), g_errorBuffer));
+		if (!streamctx.get()) throw std::runtime_error("failed to create regular expression term matcher stream context");
+		std::vector<strus::analyzer::PatternLexem> streamresult;
+		std::size_t chunksize = 4096;
+		std::size_t pos = 0;
+		start = std::clock();
+		for (; pos < doc.size(); pos += chunksize)
+		{
+			std::vector<strus::analyzer::PatternLexem> part = streamctx->putInput( doc.c_str() + pos, std::min( chunksize, doc.size() - pos));
+			streamresult.insert( streamresult.end(), part.begin(), part.end());
+		}
+		std::vector<strus::analyzer::PatternLexem> rest = streamctx->close();
+		streamresult.insert( streamresult.end(), rest.begin(), rest.end());
+		duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+		if (g_errorBuffer->hasError()) throw std::runtime_error( "error matching document in streaming mode");
+		std::cerr << "scanned " << doc.size() << " bytes in streaming mode in " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+		compareResults( streamresult, result, "streaming mode");
+
+		// Scan the document as one segment:
+		strus::local_ptr<strus::PatternLexerInstanceInterface> ptsegmentinst( createLexer( pt.get(), "VECTORED"));
+		strus::local_ptr<strus::PatternLexerSegmentContextInterface> segmentctx( strus::createPatternLexerSegmentContext_std( ptsegmentinst.get(), g_errorBuffer));
+		if (!segmentctx.get()) throw std::runtime_error("failed to create regular expression term matcher segment context");
+		strus::PatternLexerSegmentContextInterface::Segment segment( 0, doc.c_str(), doc.size());
+		std::vector<strus::analyzer::PatternLexem> segmentresult = segmentctx->matchSegments( &segment, 1);
+		if (g_errorBuffer->hasError()) throw std::runtime_error( "error matching document as segment");
+		compareResults( segmentresult, result, "segments");
+
+		std::cerr << "OK" << std::endl;
+		delete g_errorBuffer;
+		return 0;
+	}
+	catch (const std::runtime_error& err)
+	{
+		if (g_errorBuffer->hasError())
+		{
+			std::cerr << "error in overlap lexem match test: " << g_errorBuffer->fetchError() << " (" << err.what() << ")" << std::endl;
+		}
+		else
+		{
+			std::cerr << "error in overlap lexem match test: " << err.what() << std::endl;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "out of memory in overlap lexem match test" << std::endl;
+	}
+	delete g_errorBuffer;
+	return -1;
+}
+
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2018 Patrick P. Frey
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+/// \brief Fuzz test of the pattern matcher image, checking that an instance loaded from an image produces the same results
+///	as the compiled one and that corrupt images, including the tables of the pattern matcher preceding the program table, are
+///	rejected on load or processed without an access out of range.
+/// \note Meant to be run with the array accesses bound checked (build without STRUS_PATTERN_UNCHECKED_ARRAYS).
+#include "strus/base/stdint.h"
+#include "strus/lib/pattern.hpp"
+#include "strus/lib/error.hpp"
+#include "strus/errorBufferInterface.hpp"
+#include "strus/patternMatcherInterface.hpp"
+#include "strus/patternMatcherInstanceInterface.hpp"
+#include "strus/patternMatcherContextInterface.hpp"
+#include "strus/analyzer/patternLexem.hpp"
+#include "strus/analyzer/patternMatcherResult.hpp"
+#include "strus/base/local_ptr.hpp"
+#include <stdexcept>
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
+
+strus::ErrorBufferInterface* g_errorBuffer = 0;
+
+static unsigned int getUintValue( const char* arg)
+{
+	char* end = 0;
+	unsigned long rt = std::strtoul( arg, &end, 10);
+	if (!end || *end || !*arg) throw std::runtime_error( "positive integer value expected as argument");
+	return rt;
+}
+
+static std::string readImageFile( const char* filename)
+{
+	std::ifstream in( filename, std::ios::in | std::ios::binary);
+	if (!in) throw std::runtime_error( std::string("failed to read image file ") + filename);
+	return std::string( (std::istreambuf_iterator<char>( in)), std::istreambuf_iterator<char>());
+}
+
+static void writeImageFile( const char* filename, const std::string& content)
+{
+	std::ofstream out( filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out) throw std::runtime_error( std::string("failed to write image file ") + filename);
+	out.write( content.c_str(), content.size());
+	if (!out) throw std::runtime_error( std::string("failed to write image file ") + filename);
+}
+
+/// \brief Create random patterns with variables, references to other patterns, format strings and duplicate pattern names
+static void createRandomRules( strus::PatternMatcherInstanceInterface* ptinst, unsigned int nofTerms, unsigned int nofPatterns)
+{
+	static const strus::PatternMatcherInstanceInterface::JoinOperation joinops[] = {
+		strus::PatternMatcherInstanceInterface::OpSequence,
+		strus::PatternMatcherInstanceInterface::OpSequenceStruct,
+		strus::PatternMatcherInstanceInterface::OpWithin,
+		strus::PatternMatcherInstanceInterface::OpAny};
+	static const char* formatstrings[] = {"", "", "{A0}", "{A1} {A0}"};
+	unsigned int nofNamedPatterns = 0;
+	unsigned int pi = 0;
+	for (; pi < nofPatterns; ++pi)
+	{
+		unsigned int ai = 0, ae = RANDINT( 2, 5);
+		for (; ai < ae; ++ai)
+		{
+			if (nofNamedPatterns && RANDINT( 0, 4) == 0)
+			{
+				char patternname[ 32];
+				std::snprintf( patternname, sizeof(patternname), "p%u", (unsigned int)RANDINT( 0, nofNamedPatterns));
+				ptinst->pushPattern( patternname);
+			}
+			else
+			{
+				ptinst->pushTerm( RANDINT( 1, nofTerms+1));
+			}
+			if (RANDINT( 0, 3) == 0)
+			{
+				char variablename[ 32];
+				std::snprintf( variablename, sizeof(variablename), "A%u", ai);
+				ptinst->attachVariable( variablename);
+			}
+		}
+		ptinst->pushExpression( joinops[ RANDINT( 0, 4)], ae, RANDINT( 2, 10), 0/*cardinality*/);
+		// Patterns with a name used more than once are never referenced, to avoid cycles:
+		char patternname[ 32];
+		if (RANDINT( 0, 4) == 0)
+		{
+			std::snprintf( patternname, sizeof(patternname), "q%u", (unsigned int)RANDINT( 0, 20));
+		}
+		else
+		{
+			std::snprintf( patternname, sizeof(patternname), "p%u", nofNamedPatterns++);
+		}
+		ptinst->definePattern( patternname, formatstrings[ RANDINT( 0, 4)], RANDINT( 0, 4) != 0);
+	}
+}
+
+static std::vector<strus::analyzer::PatternLexem> createRandomDocument( unsigned int nofTerms, unsigned int size)
+{
+	std::vector<strus::analyzer::PatternLexem> rt;
+	unsigned int di = 0;
+	for (; di < size; ++di)
+	{
+		rt.push_back( strus::analyzer::PatternLexem( RANDINT( 1, nofTerms+1), di+1, strus::analyzer::Position( 0/*segpos*/, di*10), 5));
+	}
+	return rt;
+}
+
+static std::vector<strus::analyzer::PatternMatcherResult> matchDocument( const strus::PatternMatcherInstanceInterface* ptinst, const std::vector<strus::analyzer::PatternLexem>& doc)
+{
+	strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+	if (!mt.get()) return std::vector<strus::analyzer::PatternMatcherResult>();
+	std::vector<strus::analyzer::PatternLexem>::const_iterator di = doc.begin(), de = doc.end();
+	for (; di != de; ++di)
+	{
+		mt->putInput( *di);
+	}
+	return mt->fetchResults();
+}
+
+static bool itemEqual( const strus::analyzer::PatternMatcherResultItem& aa, const strus::analyzer::PatternMatcherResultItem& bb)
+{
+	return 0==std::strcmp( aa.name(), bb.name())
+		&& 0==std::strcmp( aa.value() ? aa.value() : "", bb.value() ? bb.value() : "")
+		&& aa.ordpos() == bb.ordpos() && aa.ordend() == bb.ordend();
+}
+
+static bool resultsEqual( const std::vector<strus::analyzer::PatternMatcherResult>& result, const std::vector<strus::analyzer::PatternMatcherResult>& expected)
+{
+	if (result.size() != expected.size()) return false;
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator ri = result.begin(), re = result.end();
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator xi = expected.begin();
+	for (; ri != re; ++ri,++xi)
+	{
+		if (!itemEqual( *ri, *xi) || ri->items().size() != xi->items().size()) return false;
+		std::size_t ii = 0, ie = ri->items().size();
+		for (; ii != ie; ++ii)
+		{
+			if (!itemEqual( ri->items()[ ii], xi->items()[ ii])) return false;
+		}
+	}
+	return true;
+}
+
+static bool isAccessOutOfRange( const char* errmsg)
+{
+	return std::strstr( errmsg, "array bound") || std::strstr( errmsg, "illegal list access");
+}
+
+int main( int argc, const char** argv)
+{
+	const char* imagefile = "patternMatcherImage.img";
+	const char* corruptimagefile = "patternMatcherImage_corrupt.img";
+	try
+	{
+		if (argc > 2)
+		{
+			std::cerr << "usage: " << argv[0] << " [<nofrounds>]" << std::endl;
+			std::cerr << "<nofrounds> = number of random pattern matcher instances to check" << std::endl;
+			return 1;
+		}
+		unsigned int nofRounds = (argc > 1) ? getUintValue( argv[1]) : 10;
+		g_errorBuffer = strus::createErrorBuffer_standard( 0, 1, NULL/*debug trace interface*/);
+		if (!g_errorBuffer)
+		{
+			std::cerr << "construction of error buffer failed" << std::endl;
+			return -1;
+		}
+		strus::local_ptr<strus::PatternMatcherInterface> pt( strus::createPatternMatcher_std( g_errorBuffer));
+		if (!pt.get()) throw std::runtime_error("failed to create pattern matcher");
+
+		unsigned int nofCorruptImagesDetected = 0;
+		unsigned int nofCorruptImages = 0;
+		unsigned int round = 0;
+		for (; round < nofRounds; ++round)
+		{
+			std::srand( round+1);
+			unsigned int nofTerms = RANDINT( 20, 100);
+			strus::local_ptr<strus::PatternMatcherInstanceInterface> ptinst( pt->createInstance());
+			if (!ptinst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+			if (RANDINT( 0, 2) == 0)
+			{
+				ptinst->defineOption( "shards", RANDINT( 2, 5));
+			}
+			if (RANDINT( 0, 2) == 0)
+			{
+				ptinst->defineOption( "triggerHashIndex", 1);
+			}
+			createRandomRules( ptinst.get(), nofTerms, RANDINT( 20, 300));
+			ptinst->compile();
+			if (g_errorBuffer->hasError())
+			{
+				throw std::runtime_error( "error creating automaton for evaluating rules");
+			}
+			if (!strus::storePatternMatcherImage_std( ptinst.get(), imagefile, g_errorBuffer))
+			{
+				throw std::runtime_error( "failed to store pattern matcher image");
+			}
+			std::string image = readImageFile( imagefile);
+			std::vector<strus::analyzer::PatternLexem> doc = createRandomDocument( nofTerms, RANDINT( 100, 1000));
+			std::vector<strus::analyzer::PatternMatcherResult> expected = matchDocument( ptinst.get(), doc);
+			{
+				strus::local_ptr<strus::PatternMatcherInstanceInterface> loaded( strus::loadPatternMatcherImage_std( imagefile, g_errorBuffer));
+				if (!loaded.get()) throw std::runtime_error( "failed to load pattern matcher image");
+				if (!resultsEqual( matchDocument( loaded.get(), doc), expected))
+				{
+					throw std::runtime_error( "results of the instance loaded from an image differ from the ones of the compiled instance");
+				}
+				if (g_errorBuffer->hasError())
+				{
+					throw std::runtime_error( "error matching with the instance loaded from an image");
+				}
+			}
+			// Corrupt images must be rejected on load or be processed without an access out of range.
+			// Half of the corruptions hit the tables of the pattern matcher (names, variables, format strings) at the start of the image:
+			unsigned int ci = 0;
+			for (; ci < 40; ++ci)
+			{
+				std::string corrupt = image;
+				unsigned int fi = 0, fe = RANDINT( 1, 4);
+				for (; fi < fe; ++fi)
+				{
+					std::size_t range = (RANDINT( 0, 2) == 0 && corrupt.size() > 512) ? 512 : corrupt.size();
+					corrupt[ RANDINT( 0, range)] ^= (char)(1 << RANDINT( 0, 8));
+				}
+				if (RANDINT( 0, 10) == 0)
+				{
+					corrupt.resize( RANDINT( 0, corrupt.size()));
+				}
+				writeImageFile( corruptimagefile, corrupt);
+				++nofCorruptImages;
+				strus::local_ptr<strus::PatternMatcherInstanceInterface> loaded( strus::loadPatternMatcherImage_std( corruptimagefile, g_errorBuffer));
+				if (!loaded.get())
+				{
+					const char* errmsg = g_errorBuffer->fetchError();
+					if (isAccessOutOfRange( errmsg))
+					{
+						std::cerr << "round " << round << ": access out of range loading a corrupt image: " << errmsg << std::endl;
+						throw std::runtime_error( "access out of range with a corrupt image");
+					}
+					++nofCorruptImagesDetected;
+					continue;
+				}
+				// Other errors detected while matching with the corrupt image (e.g. an illegal variable) are accepted:
+				matchDocument( loaded.get(), doc);
+				if (g_errorBuffer->hasError())
+				{
+					const char* errmsg = g_errorBuffer->fetchError();
+					if (isAccessOutOfRange( errmsg))
+					{
+						std::cerr << "round " << round << ": access out of range with a corrupt image not rejected on load: " << errmsg << std::endl;
+						throw std::runtime_error( "access out of range with a corrupt image");
+					}
+				}
+			}
+			std::cerr << "round " << round << ": image of " << image.size() << " bytes, " << expected.size() << " results" << std::endl;
+		}
+		std::remove( imagefile);
+		std::remove( corruptimagefile);
+		std::cerr << "corrupt images rejected on load: " << nofCorruptImagesDetected << " of " << nofCorruptImages << std::endl;
+		std::cerr << "OK" << std::endl;
+		delete g_errorBuffer;
+		return 0;
+	}
+	catch (const std::runtime_error& err)
+	{
+		if (g_errorBuffer && g_errorBuffer->hasError())
+		{
+			std::cerr << "error in pattern matcher image test: "
+					<< g_errorBuffer->fetchError() << " (" << err.what()
+					<< ")" << std::endl;
+		}
+		else
+		{
+			std::cerr << "error in pattern matcher image test: " << err.what() << std::endl;
+		}
+	}
+	catch (const std::bad_alloc&)
+	{
+		std::cerr << "out of memory in pattern matcher image test" << std::endl;
+	}
+	std::remove( imagefile);
+	std::remove( corruptimagefile);
+	delete g_errorBuffer;
+	return -1;
+}
@@ -13,6 +13,8 @@
 #include "strus/patternMatcherInterface.hpp"
 #include "strus/patternMatcherInstanceInterface.hpp"
 #include "strus/patternMatcherContextInterface.hpp"
+#include "strus/patternMatcherResumeInterface.hpp"
+#include "strus/patternMatcherCheckpointInterface.hpp"
 #include "strus/base/local_ptr.hpp"
 #include "strus/base/thread.hpp"
 #include "testUtils.hpp"
@@ -27,13 +29,17 @@
 #include <memory>
 #include <limits>
 #include <ctime>
+#include <sys/time.h>
 #include <cmath>
 #include <cstring>
 #include <iomanip>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
-static void initRand()
+static unsigned int initRand()
 {
 	time_t nowtime;
 	struct tm* now;
@@ -41,7 +47,9 @@ static void initRand()
 	::time( &nowtime);
 	now = ::localtime( &nowtime);
 
-	::srand( ((now->tm_year+1) * (now->tm_mon+100) * (now->tm_mday+1)));
+	unsigned int seed = ((now->tm_year+1) * (now->tm_mon+100) * (now->tm_mday+1));
+	::srand( seed);
+	return seed;
 }
 #define RANDINT(MIN,MAX) ((std::rand()%(MAX-MIN))+MIN)
 
@@ -136,15 +144,19 @@ static std::vector<strus::utils::Document> createRandomDocuments( unsigned int c
 	return rt;
 }
 
-static unsigned int processDocument( const strus::PatternMatcherInstanceInterface* ptinst, const strus::utils::Document& doc, std::map<std::string,double>& globalstats)
+static void putDocumentItems( strus::PatternMatcherContextInterface* mt, const strus::utils::Document& doc, std::size_t startidx, std::size_t endidx)
 {
-	strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
-	std::vector<strus::utils::DocumentItem>::const_iterator di = doc.itemar.begin(), de = doc.itemar.end();
-	unsigned int didx = 0;
-	for (; di != de; ++di,++didx)
+	std::size_t didx = startidx;
+	for (; didx < endidx; ++didx)
 	{
-		mt->putInput( strus::analyzer::PatternLexem( di->termid, di->pos, strus::analyzer::Position(0/*segpos*/, didx), 1));
+		const strus::utils::DocumentItem& item = doc.itemar[ didx];
+		mt->putInput( strus::analyzer::PatternLexem( item.termid, item.pos, strus::analyzer::Position(0/*segpos*/, didx), 1));
 	}
+}
+
+static unsigned int processDocument( strus::PatternMatcherContextInterface* mt, const strus::utils::Document& doc, std::map<std::string,double>& globalstats)
+{
+	putDocumentItems( mt, doc, 0, doc.itemar.size());
 	if (g_errorBuffer->hasError())
 	{
 		throw std::runtime_error("error matching rules");
@@ -174,6 +186,12 @@ static void printUsage( int argc, const char* argv[])
 {
 	std::cerr << "usage: " << argv[0] << " [<options>] <features> <nofdocs> <docsize> <nofpatterns> [<joinop>]" << std::endl;
 	std::cerr << "<options>= -h print this usage, -o do optimize automaton, -t <N> number of threads" << std::endl;
+	std::cerr << "           -H use hash index for triggers, -b benchmark bucket against hash index for triggers" << std::endl;
+	std::cerr << "           -x exclusive, eliminate results covered by other results" << std::endl;
+	std::cerr << "           -r benchmark one context reset for every document against a new context per document" << std::endl;
+	std::cerr << "           -p <N> compare the automaton optimized with <N> threads against the one optimized in one thread" << std::endl;
+	std::cerr << "           -c benchmark matching the second half of every document again resumed from a checkpoint against matching the whole document" << std::endl;
+	std::cerr << "           -s <N> compare matching with the programs partitioned into <N> shards matched in parallel against matching without" << std::endl;
 	std::cerr << "<features>= number of distinct features" << std::endl;
 	std::cerr << "<nofdocs> = number of documents to insert" << std::endl;
 	std::cerr << "<docsize> = size of a document" << std::endl;
@@ -190,8 +208,29 @@ static unsigned int processDocuments( const strus::PatternMatcherInstanceInterfa
 #ifdef STRUS_LOWLEVEL_DEBUG
 		std::cout << "document " << di->id << ":" << std::endl;
 #endif
-		unsigned int nofmatches = processDocument( ptinst, *di, stats);
+		strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+		if (!mt.get()) throw std::runtime_error("failed to create pattern matcher context");
+		unsigned int nofmatches = processDocument( mt.get(), *di, stats);
+		totalNofmatches += nofmatches;
+		if (g_errorBuffer->hasError())
+		{
+			throw std::runtime_error("error matching rule");
+		}
+	}
+	return totalNofmatches;
+}
+
+static unsigned int processDocumentsReusingContext( const strus::PatternMatcherInstanceInterface* ptinst, const std::vector<strus::utils::Document>& docs, std::map<std::string,double>& stats)
+{
+	unsigned int totalNofmatches = 0;
+	strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+	if (!mt.get()) throw std::runtime_error("failed to create pattern matcher context");
+	std::vector<strus::utils::Document>::const_iterator di = docs.begin(), de = docs.end();
+	for (; di != de; ++di)
+	{
+		unsigned int nofmatches = processDocument( mt.get(), *di, stats);
 		totalNofmatches += nofmatches;
+		mt->reset();
 		if (g_errorBuffer->hasError())
 		{
 			throw std::runtime_error("error matching rule");
@@ -200,6 +239,127 @@ static unsigned int processDocuments( const strus::PatternMatcherInstanceInterfa
 	return totalNofmatches;
 }
 
+static void compareResults( const std::vector<strus::analyzer::PatternMatcherResult>& results, const std::vector<strus::analyzer::PatternMatcherResult>& cmpresults, const char* cmpname)
+{
+	if (cmpresults.size() != results.size())
+	{
+		throw std::runtime_error( std::string("results of ") + cmpname + " differ in size");
+	}
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator
+		xi = results.begin(), xe = results.end(), yi = cmpresults.begin();
+	for (; xi != xe; ++xi,++yi)
+	{
+		if (0!=std::strcmp( xi->name(), yi->name()) || xi->ordpos() != yi->ordpos() || xi->ordend() != yi->ordend())
+		{
+			throw std::runtime_error( std::string("results of ") + cmpname + " differ");
+		}
+	}
+}
+
+/// \brief Match every document as a whole, then match its second half again resumed from a checkpoint created in the middle
+/// \return the accumulated time for matching the second halfs resumed from the checkpoints in seconds
+static double processDocumentsResumingCheckpoint( const strus::PatternMatcherInstanceInterface* ptinst, const std::vector<strus::utils::Document>& docs, std::map<std::string,double>& stats)
+{
+	double duration = 0.0;
+	std::vector<strus::utils::Document>::const_iterator di = docs.begin(), de = docs.end();
+	for (; di != de; ++di)
+	{
+		strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+		if (!mt.get()) throw std::runtime_error("failed to create pattern matcher context");
+		strus::PatternMatcherResumeInterface* resumable = dynamic_cast<strus::PatternMatcherResumeInterface*>( mt.get());
+		if (!resumable) throw std::runtime_error("pattern matcher context does not implement the resume interface");
+
+		// Split the document at a position boundary, the terms fed after resuming must not have a position before the checkpoint:
+		std::size_t splitidx = di->itemar.size() / 2;
+		while (splitidx > 0 && splitidx < di->itemar.size() && di->itemar[ splitidx].pos == di->itemar[ splitidx-1].pos) ++splitidx;
+
+		putDocumentItems( mt.get(), *di, 0, splitidx);
+		strus::local_ptr<strus::PatternMatcherCheckpointInterface> checkpoint( resumable->createCheckpoint());
+		if (!checkpoint.get()) throw std::runtime_error("failed to create checkpoint");
+		putDocumentItems( mt.get(), *di, splitidx, di->itemar.size());
+		std::vector<strus::analyzer::PatternMatcherResult> results = mt->fetchResults();
+
+		std::clock_t start = std::clock();
+		resumable->resume( checkpoint.get());
+		putDocumentItems( mt.get(), *di, splitidx, di->itemar.size());
+		std::vector<strus::analyzer::PatternMatcherResult> resumedResults = mt->fetchResults();
+		duration += (double)(std::clock() - start) / CLOCKS_PER_SEC;
+		if (g_errorBuffer->hasError())
+		{
+			throw std::runtime_error("error matching rules resumed from checkpoint");
+		}
+		compareResults( results, resumedResults, "matching resumed from checkpoint");
+
+		strus::analyzer::PatternMatcherStatistics docstats = mt->getStatistics();
+		std::vector<strus::analyzer::PatternMatcherStatistics::Item>::const_iterator
+			li = docstats.items().begin(), le = docstats.items().end();
+		for (; li != le; ++li)
+		{
+			stats[ li->name()] += li->value();
+		}
+	}
+	return duration;
+}
+
+/// \brief Get the elapsed real time in seconds, the CPU time measured by std::clock would add up the time of all threads
+static double getWallClockTime()
+{
+	struct timeval tv;
+	::gettimeofday( &tv, 0);
+	return (double)tv.tv_sec + (double)tv.tv_usec / 1000000.0;
+}
+
+/// \brief Match every document with the programs partitioned into shards and without, and compare the results
+/// \param[out] duration accumulated real time for matching the documents without shards in seconds
+/// \param[out] shardDuration accumulated real time for matching the documents with shards in seconds
+/// \return the total number of matches
+static unsigned int processDocumentsComparingShards( const strus::PatternMatcherInstanceInterface* ptinst, const strus::PatternMatcherInstanceInterface* shardinst, const std::vector<strus::utils::Document>& docs, std::map<std::string,double>& stats, double& duration, double& shardDuration)
+{
+	unsigned int totalNofmatches = 0;
+	duration = 0.0;
+	shardDuration = 0.0;
+	std::vector<strus::utils::Document>::const_iterator di = docs.begin(), de = docs.end();
+	for (; di != de; ++di)
+	{
+		strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+		strus::local_ptr<strus::PatternMatcherContextInterface> shardmt( shardinst->createContext());
+		if (!mt.get() || !shardmt.get()) throw std::runtime_error("failed to create pattern matcher context");
+
+		double start = getWallClockTime();
+		putDocumentItems( mt.get(), *di, 0, di->itemar.size());
+		std::vector<strus::analyzer::PatternMatcherResult> results = mt->fetchResults();
+		duration += getWallClockTime() - start;
+
+		start = getWallClockTime();
+		putDocumentItems( shardmt.get(), *di, 0, di->itemar.size());
+		std::vector<strus::analyzer::PatternMatcherResult> shardResults = shardmt->fetchResults();
+		shardDuration += getWallClockTime() - start;
+		if (g_errorBuffer->hasError())
+		{
+			throw std::runtime_error("error matching rules");
+		}
+		// ... the results with shards are merged into the same order as the ones without:
+		compareResults( results, shardResults, "matching with shards");
+		totalNofmatches += results.size();
+
+		strus::analyzer::PatternMatcherStatistics docstats = mt->getStatistics();
+		std::vector<strus::analyzer::PatternMatcherStatistics::Item>::const_iterator
+			li = docstats.items().begin(), le = docstats.items().end();
+		for (; li != le; ++li)
+		{
+			stats[ li->name()] += li->value();
+		}
+	}
+	return totalNofmatches;
+}
+
+static std::string readImageFile( const char* filename)
+{
+	std::ifstream in( filename, std::ios::in | std::ios::binary);
+	if (!in) throw std::runtime_error( std::string("failed to read image file ") + filename);
+	return std::string( (std::istreambuf_iterator<char>( in)), std::istreambuf_iterator<char>());
+}
+
 class Globals
 {
 public:
@@ -268,6 +428,13 @@ int main( int argc, const char** argv)
 		}
 		unsigned int nofThreads = 0;
 		bool doOpimize = false;
+		bool doUseTriggerHashIndex = false;
+		bool doBenchmarkTriggerIndex = false;
+		bool doExclusive = false;
+		bool doBenchmarkReset = false;
+		bool doBenchmarkCheckpoint = false;
+		unsigned int nofCompileThreads = 0;
+		unsigned int nofShards = 0;
 		int argidx = 1;
 		for (; argidx < argc && argv[argidx][0] == '-'; ++argidx)
 		{
@@ -284,6 +451,34 @@ int main( int argc, const char** argv)
 			{
 				nofThreads = strus::utils::getUintValue( argv[++argidx]);
 			}
+			else if (std::strcmp( argv[argidx], "-H") == 0)
+			{
+				doUseTriggerHashIndex = true;
+			}
+			else if (std::strcmp( argv[argidx], "-b") == 0)
+			{
+				doBenchmarkTriggerIndex = true;
+			}
+			else if (std::strcmp( argv[argidx], "-x") == 0)
+			{
+				doExclusive = true;
+			}
+			else if (std::strcmp( argv[argidx], "-r") == 0)
+			{
+				doBenchmarkReset = true;
+			}
+			else if (std::strcmp( argv[argidx], "-c") == 0)
+			{
+				doBenchmarkCheckpoint = true;
+			}
+			else if (std::strcmp( argv[argidx], "-p") == 0)
+			{
+				nofCompileThreads = strus::utils::getUintValue( argv[++argidx]);
+			}
+			else if (std::strcmp( argv[argidx], "-s") == 0)
+			{
+				nofShards = strus::utils::getUintValue( argv[++argidx]);
+			}
 		}
 		if (argc - argidx < 4)
 		{
@@ -297,7 +492,7 @@ int main( int argc, const char** argv)
 			printUsage( argc, argv);
 			return 1;
 		}
-		initRand();
+		unsigned int randSeed = initRand();
 		g_errorBuffer = strus::createErrorBuffer_standard( 0, 1+nofThreads, NULL/*debug trace interface*/);
 		if (!g_errorBuffer)
 		{
@@ -314,17 +509,186 @@ int main( int argc, const char** argv)
 		if (!pt.get()) throw std::runtime_error("failed to create pattern matcher");
 		strus::local_ptr<strus::PatternMatcherInstanceInterface> ptinst( pt->createInstance());
 		if (!ptinst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+		if (doUseTriggerHashIndex)
+		{
+			ptinst->defineOption( "triggerHashIndex", 1);
+		}
+		if (doExclusive)
+		{
+			ptinst->defineOption( "exclusive", 1);
+		}
 		createRules( ptinst.get(), joinop, nofFeatures, nofPatterns);
+		std::clock_t compileStart = std::clock();
 		if (doOpimize)
 		{
 			ptinst->compile();
 		}
+		double compileDuration = (double)(std::clock() - compileStart) / CLOCKS_PER_SEC;
 		if (g_errorBuffer->hasError())
 		{
 			throw std::runtime_error( "error creating automaton for evaluating rules");
 		}
+		if (nofCompileThreads && doOpimize)
+		{
+			// Create the same automaton optimized with multiple threads and compare the images of both:
+			strus::local_ptr<strus::PatternMatcherInstanceInterface> parinst( pt->createInstance());
+			if (!parinst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+			parinst->defineOption( "compileThreads", nofCompileThreads);
+			if (doUseTriggerHashIndex)
+			{
+				parinst->defineOption( "triggerHashIndex", 1);
+			}
+			if (doExclusive)
+			{
+				parinst->defineOption( "exclusive", 1);
+			}
+			::srand( randSeed);
+			createRules( parinst.get(), joinop, nofFeatures, nofPatterns);
+			compileStart = std::clock();
+			parinst->compile();
+			double parCompileDuration = (double)(std::clock() - compileStart) / CLOCKS_PER_SEC;
+			if (g_errorBuffer->hasError())
+			{
+				throw std::runtime_error( "error creating automaton optimized with multiple threads");
+			}
+			const char* imagefile = "matcher.img";
+			const char* parimagefile = "matcher_par.img";
+			if (!strus::storePatternMatcherImage_std( ptinst.get(), imagefile, g_errorBuffer)
+			||  !strus::storePatternMatcherImage_std( parinst.get(), parimagefile, g_errorBuffer))
+			{
+				throw std::runtime_error( "failed to store pattern matcher image");
+			}
+			bool imagesEqual = (readImageFile( imagefile) == readImageFile( parimagefile));
+			std::remove( imagefile);
+			std::remove( parimagefile);
+			std::cerr << "optimization in one thread: " << std::fixed << std::setprecision(3) << compileDuration << " seconds (CPU)" << std::endl;
+			std::cerr << "optimization in " << nofCompileThreads << " threads: " << std::fixed << std::setprecision(3) << parCompileDuration << " seconds (CPU)" << std::endl;
+			if (!imagesEqual)
+			{
+				throw std::runtime_error( "automaton optimized with multiple threads differs from the one optimized in one thread");
+			}
+		}
 		Globals globals( ptinst.get());
-		if (nofThreads)
+		if (doBenchmarkTriggerIndex)
+		{
+			// Create the same automaton with the alternative trigger index and compare both on the same documents:
+			strus::local_ptr<strus::PatternMatcherInstanceInterface> altinst( pt->createInstance());
+			if (!altinst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+			altinst->defineOption( "triggerHashIndex", doUseTriggerHashIndex ? 0:1);
+			if (doExclusive)
+			{
+				altinst->defineOption( "exclusive", 1);
+			}
+			::srand( randSeed);
+			createRules( altinst.get(), joinop, nofFeatures, nofPatterns);
+			if (doOpimize)
+			{
+				altinst->compile();
+			}
+			if (g_errorBuffer->hasError())
+			{
+				throw std::runtime_error( "error creating automaton for evaluating rules");
+			}
+			std::vector<strus::utils::Document> docs = createRandomDocuments( nofDocuments, documentSize, nofFeatures);
+			std::cerr << "starting benchmark of trigger index ..." << std::endl;
+
+			std::map<std::string,double> altstats;
+			std::clock_t start = std::clock();
+			globals.totalNofMatches = processDocuments( ptinst.get(), docs, globals.stats);
+			double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+			start = std::clock();
+			unsigned int altNofMatches = processDocuments( altinst.get(), docs, altstats);
+			double altduration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+			globals.totalNofDocs = docs.size();
+
+			const char* name = doUseTriggerHashIndex ? "hash":"bucket";
+			const char* altname = doUseTriggerHashIndex ? "bucket":"hash";
+			std::cerr << "trigger index " << name << ": " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+			std::cerr << "trigger index " << altname << ": " << std::fixed << std::setprecision(3) << altduration << " seconds" << std::endl;
+			if (altNofMatches != globals.totalNofMatches)
+			{
+				throw std::runtime_error( "number of matches differ for different trigger index implementations");
+			}
+		}
+		else if (doBenchmarkReset)
+		{
+			// Process the same documents with a new context per document and with one context reset after each document:
+			std::vector<strus::utils::Document> docs = createRandomDocuments( nofDocuments, documentSize, nofFeatures);
+			std::cerr << "starting benchmark of context reset ..." << std::endl;
+
+			std::map<std::string,double> resetstats;
+			std::clock_t start = std::clock();
+			globals.totalNofMatches = processDocuments( ptinst.get(), docs, globals.stats);
+			double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+			start = std::clock();
+			unsigned int resetNofMatches = processDocumentsReusingContext( ptinst.get(), docs, resetstats);
+			double resetduration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+			globals.totalNofDocs = docs.size();
+
+			std::cerr << "new context per document: " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+			std::cerr << "context reset per document: " << std::fixed << std::setprecision(3) << resetduration << " seconds" << std::endl;
+			if (resetNofMatches != globals.totalNofMatches)
+			{
+				throw std::runtime_error( "number of matches differ for a new context and a context reset per document");
+			}
+			if (resetstats != globals.stats)
+			{
+				throw std::runtime_error( "statistics differ for a new context and a context reset per document");
+			}
+		}
+		else if (doBenchmarkCheckpoint)
+		{
+			// Process the documents as a whole and compare the results with the ones of the second half matched again resumed from a checkpoint:
+			std::vector<strus::utils::Document> docs = createRandomDocuments( nofDocuments, documentSize, nofFeatures);
+			std::cerr << "starting benchmark of resuming from checkpoints ..." << std::endl;
+
+			std::map<std::string,double> resumestats;
+			std::clock_t start = std::clock();
+			globals.totalNofMatches = processDocuments( ptinst.get(), docs, globals.stats);
+			double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
+			double resumeduration = processDocumentsResumingCheckpoint( ptinst.get(), docs, resumestats);
+			globals.totalNofDocs = docs.size();
+
+			std::cerr << "matching whole documents: " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+			std::cerr << "matching second halfs resumed from checkpoint: " << std::fixed << std::setprecision(3) << resumeduration << " seconds" << std::endl;
+			if (resumestats != globals.stats)
+			{
+				throw std::runtime_error( "statistics differ for whole documents and documents resumed from checkpoint");
+			}
+		}
+		else if (nofShards)
+		{
+			// Create the same automaton with the programs partitioned into shards and compare both on the same documents:
+			strus::local_ptr<strus::PatternMatcherInstanceInterface> shardinst( pt->createInstance());
+			if (!shardinst.get()) throw std::runtime_error("failed to create pattern matcher instance");
+			shardinst->defineOption( "shards", nofShards);
+			if (doUseTriggerHashIndex)
+			{
+				shardinst->defineOption( "triggerHashIndex", 1);
+			}
+			if (doExclusive)
+			{
+				shardinst->defineOption( "exclusive", 1);
+			}
+			::srand( randSeed);
+			createRules( shardinst.get(), joinop, nofFeatures, nofPatterns);
+			shardinst->compile();
+			if (g_errorBuffer->hasError())
+			{
+				throw std::runtime_error( "error creating automaton with shards");
+			}
+			std::vector<strus::utils::Document> docs = createRandomDocuments( nofDocuments, documentSize, nofFeatures);
+			std::cerr << "starting benchmark of matching with " << nofShards << " shards ..." << std::endl;
+
+			double duration = 0.0;
+			double shardDuration = 0.0;
+			globals.totalNofMatches = processDocumentsComparingShards( ptinst.get(), shardinst.get(), docs, globals.stats, duration, shardDuration);
+			globals.totalNofDocs = docs.size();
+
+			std::cerr << "matching without shards: " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
+			std::cerr << "matching with " << nofShards << " shards: " << std::fixed << std::setprecision(3) << shardDuration << " seconds" << std::endl;
+		}
+		else if (nofThreads)
 		{
 			std::cerr << "starting " << nofThreads << " threads for rule evaluation ..." << std::endl;
 
@@ -359,8 +723,11 @@ int main( int argc, const char** argv)
 			std::cerr << "starting rule evaluation ..." << std::endl;
 
 			std::map<std::string,double> stats;
+			std::clock_t start = std::clock();
 			globals.totalNofMatches = processDocuments( ptinst.get(), docs, globals.stats);
+			double duration = (double)(std::clock() - start) / CLOCKS_PER_SEC;
 			globals.totalNofDocs = docs.size();
+			std::cerr << "rule evaluation" << (doExclusive ? " (exclusive)":"") << ": " << std::fixed << std::setprecision(3) << duration << " seconds" << std::endl;
 		}
 		if (g_errorBuffer->hasError())
 		{
@@ -12,6 +12,7 @@
 #include "strus/patternMatcherInterface.hpp"
 #include "strus/patternMatcherInstanceInterface.hpp"
 #include "strus/patternMatcherContextInterface.hpp"
+#include "strus/patternMatcherBatchInputInterface.hpp"
 #include "strus/analyzer/patternLexem.hpp"
 #include "strus/base/local_ptr.hpp"
 #include "testUtils.hpp"
@@ -30,6 +31,7 @@
 #include <cmath>
 #include <cstring>
 #include <iomanip>
+#include <algorithm>
 
 #undef STRUS_LOWLEVEL_DEBUG
 
@@ -176,6 +178,50 @@ static std::vector<strus::analyzer::PatternMatcherResult>
 	return results;
 }
 
+static std::vector<strus::analyzer::PatternMatcherResult>
+	processDocumentBatch( strus::PatternMatcherInstanceInterface* ptinst, const Document& doc)
+{
+	strus::local_ptr<strus::PatternMatcherContextInterface> mt( ptinst->createContext());
+	strus::PatternMatcherBatchInputInterface* batchinput = dynamic_cast<strus::PatternMatcherBatchInputInterface*>( mt.get());
+	if (!batchinput) throw std::runtime_error("pattern matcher context does not implement the batch input interface");
+
+	std::vector<strus::analyzer::PatternLexem> lexems;
+	std::vector<DocumentItem>::const_iterator di = doc.itemar.begin(), de = doc.itemar.end();
+	unsigned int didx = 0;
+	for (; di != de; ++di,++didx)
+	{
+		lexems.push_back( strus::analyzer::PatternLexem( di->termid, di->pos, strus::analyzer::Position( 0/*origseg*/, didx), 1));
+	}
+	// Feed the lexems in batches of different size:
+	std::size_t li = 0, batchsize = 1;
+	while (li < lexems.size())
+	{
+		std::size_t nn = std::min( batchsize, lexems.size() - li);
+		batchinput->putInputBatch( &lexems[ li], nn);
+		if (g_errorBuffer->hasError()) throw std::runtime_error("error matching rules");
+		li += nn;
+		batchsize = batchsize * 3 + 1;
+	}
+	return mt->fetchResults();
+}
+
+static void compareResults( const std::vector<strus::analyzer::PatternMatcherResult>& results, const std::vector<strus::analyzer::PatternMatcherResult>& cmpresults, const char* cmpname)
+{
+	if (cmpresults.size() != results.size())
+	{
+		throw std::runtime_error( std::string("results of ") + cmpname + " differ in size");
+	}
+	std::vector<strus::analyzer::PatternMatcherResult>::const_iterator
+		xi = results.begin(), xe = results.end(), yi = cmpresults.begin();
+	for (; xi != xe; ++xi,++yi)
+	{
+		if (0!=std::strcmp( xi->name(), yi->name()) || xi->ordpos() != yi->ordpos() || xi->ordend() != yi->ordend())
+		{
+			throw std::runtime_error( std::string("results of ") + cmpname + " differ");
+		}
+	}
+}
+
 typedef strus::PatternMatcherInstanceInterface PT;
 static const Pattern testPatterns[32] =
 {
@@ -255,6 +301,22 @@ int main( int argc, const char** argv)
 		std::vector<strus::analyzer::PatternMatcherResult> 
 			results = processDocument( ptinst.get(), doc);
 
+		// Evaluate results with the automaton loaded from an image and compare them:
+		const char* imagefile = "matcher.img";
+		if (!strus::storePatternMatcherImage_std( ptinst.get(), imagefile, g_errorBuffer))
+		{
+			throw std::runtime_error( "failed to store pattern matcher image");
+		}
+		strus::local_ptr<strus::PatternMatcherInstanceInterface> imginst( strus::loadPatternMatcherImage_std( imagefile, g_errorBuffer));
+		if (!imginst.get()) throw std::runtime_error("failed to load pattern matcher image");
+		std::vector<strus::analyzer::PatternMatcherResult>
+			imgresults = processDocument( imginst.get(), doc);
+		std::remove( imagefile);
+		compareResults( results, imgresults, "automaton loaded from image");
+
+		// Evaluate results with the input fed in batches and compare them:
+		compareResults( results, processDocumentBatch( ptinst.get(), doc), "input fed in batches");
+
 		// Verify results:
 		std::vector<strus::analyzer::PatternMatcherResult>::const_iterator
 			ri = results.begin(), re = results.end();